@@ -0,0 +1,57 @@
+#include "bench.h"
+#include "p2pa_common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+// Passes over every sector, the first one to warm the caches up
+#define BENCH_PASSES 4
+
+double _bench_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int bench_sampling(const job_parameters_t *job, terrain_file_t *tf, clutter_file_t *cf, int sectors, double *rate)
+{
+    int n = (int)c_ceil(job->radius / (job->xres * KM_M));
+    int angles_count = (int)(360.0 / job->ares);
+
+    double *profile_h = malloc(2 * n * sizeof(double));
+    if (profile_h == NULL)
+    {
+        fprintf(stderr, "bench_sampling: malloc() profile_h\n");
+        return EXIT_FAILURE;
+    }
+    double *profile_Ct = profile_h + n;
+
+    for (int s = 0; s < sectors; s++)
+    {
+        int first = s * angles_count / sectors;
+        int last = (s + 1) * angles_count / sectors;
+
+        double elapsed = 0.0;
+        for (int pass = 0; pass < BENCH_PASSES; pass++)
+        {
+            double start = _bench_now();
+            for (int ai = first; ai < last; ai++)
+            {
+                double angle = ai * job->ares;
+                double x2 = job->txx + job->radius * c_cos(angle * PI / 180.0);
+                double y2 = job->txy + job->radius * c_sin(angle * PI / 180.0);
+                tf_profile_func(tf, job->txx, job->txy, x2, y2, n, profile_h);
+                cf_profile_func(cf, job->txx, job->txy, x2, y2, n, profile_Ct);
+            }
+            if (pass > 0)
+                elapsed += _bench_now() - start;
+        }
+
+        rate[s] = (double)(BENCH_PASSES - 1) * (last - first) * n / elapsed;
+    }
+
+    free(profile_h);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,24 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "jobfile.h"
+#include "terrain_file.h"
+#include "clutter_file.h"
+
+/**
+ * @brief Measure profile sampling throughput per azimuth sector of a point-to-area job.
+ *
+ * The rays of the job are sampled as p2a does, terrain and clutter, on one thread,
+ * without calculating losses. Sector s covers azimuths from s * 360 / sectors degrees.
+ *
+ * @param job Job parameters, of a point-to-area calculation.
+ * @param tf Terrain to sample.
+ * @param cf Clutter to sample.
+ * @param sectors Number of azimuth sectors.
+ * @param rate Set to the samples per second of each sector.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int bench_sampling(const job_parameters_t *job, terrain_file_t *tf, clutter_file_t *cf, int sectors, double *rate);
+
+#endif
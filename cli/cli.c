@@ -10,6 +10,9 @@
 #include "outfile.h"
 #include "p2a.h"
 #include "p2p.h"
+#include "pool.h"
+#include "rfunpack.h"
+#include "bench.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -20,88 +23,347 @@
 #define DEFAULT_STREET_WIDTH 27.0
 #define PARSED_TF_EXT ".tf"
 #define PARSED_TF_EXT_LEN 3
+#define CLUTTER_EXT ".cf"
 #define WRITE_BINARY "wb"
+#define UNPACK_OPTION "--unpack"
+#define UNPACK_MIN_ARGS 4
+#define MIB (1024 * 1024)
+#define BENCH_LAYOUT_OPTION "--bench-layout"
+#define BENCH_LAYOUT_ARGS 3
+#define BENCH_SECTORS 8
+
+// Terrain and clutter data of the previous job, kept open for the next one if it names the same files
+typedef struct
+{
+    char terrain_paths[MAX_TERRAIN_FILES][MAX_VALUE_LENGTH];
+    grid_sample_type_t terrain_type;
+    tf_pyramid_t terrain_pyramid;
+    grid_layout_t layout;
+    bool windowed;         // the grids hold only the window
+    grid_window_t window;  // area of interest the grids were opened for
+    int tile_cache;        // tiles of a mosaic kept mapped
+    terrain_file_t terrain_files[MAX_TERRAIN_FILES];
+    int terrain_file_count;
+
+    char clutter_paths[MAX_CLUTTER_FILES][MAX_VALUE_LENGTH];
+    clutter_file_t clutter_files[MAX_CLUTTER_FILES];
+    int clutter_file_count;
+} data_files_t;
 
+int run_job(const char *path, data_files_t *data, pool_t *pool);
+int run_unpack(const int argc, const char *argv[]);
+int run_bench_layout(const int argc, const char *argv[]);
 int validate_job_parameters(job_parameters_t *job_parameters);
-int open_terrain_files(terrain_file_t *tfs, char paths[MAX_TERRAIN_FILES][MAX_VALUE_LENGTH], int *tf_count);
-int open_clutter_files(clutter_file_t *tfs, char paths[MAX_CLUTTER_FILES][MAX_VALUE_LENGTH], int *tf_count);
+int load_data_files(job_parameters_t *job_parameters, data_files_t *data);
+void free_data_files(data_files_t *data);
+void job_window(const job_parameters_t *job_parameters, grid_window_t *window);
+int store_parsed_terrain(const char *path, grid_sample_type_t type, char **tf_path);
+void free_paths(char **paths, int count);
+int open_terrain_files(terrain_file_t *tfs, char paths[MAX_TERRAIN_FILES][MAX_VALUE_LENGTH], grid_sample_type_t type,
+                       const grid_window_t *window, int tile_cache, int *tf_count);
+int open_clutter_files(clutter_file_t *tfs, char paths[MAX_CLUTTER_FILES][MAX_VALUE_LENGTH], const grid_window_t *window,
+                       int tile_cache, int *tf_count);
 
 int main(const int argc, const char *argv[])
 {
     if (argc < MIN_ARGS)
     {
-        fprintf(stderr, "Usage: %s <job_file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <job_file> [<job_file> ...]\n", argv[0]);
+        fprintf(stderr, "       %s %s <compressed.rf> <plain.rf> [<threads>]\n", argv[0], UNPACK_OPTION);
+        fprintf(stderr, "       %s %s <job_file>\n", argv[0], BENCH_LAYOUT_OPTION);
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], UNPACK_OPTION) == 0)
+        return run_unpack(argc, argv);
+
+    if (strcmp(argv[1], BENCH_LAYOUT_OPTION) == 0)
+        return run_bench_layout(argc, argv);
+
+    // Jobs run one after another, sharing the worker threads and, where
+    // the paths match, the terrain and clutter data of the previous job
+    pool_t pool;
+    if (pool_create(&pool, 0) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "main: pool_create()\n");
+        return EXIT_FAILURE;
+    }
+
+    data_files_t data;
+    memset(&data, 0, sizeof(data_files_t));
+
+    int status = EXIT_SUCCESS;
+    for (int i = 1; i < argc; i++)
+    {
+        if (run_job(argv[i], &data, &pool) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "main: run_job() %s\n", argv[i]);
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    pool_free(&pool);
+    free_data_files(&data);
+
+    return status;
+}
+
+int run_unpack(const int argc, const char *argv[])
+{
+    if (argc < UNPACK_MIN_ARGS)
+    {
+        fprintf(stderr, "Usage: %s %s <compressed.rf> <plain.rf> [<threads>]\n", argv[0], UNPACK_OPTION);
+        return EXIT_FAILURE;
+    }
+
+    int threads = (argc > UNPACK_MIN_ARGS) ? atoi(argv[UNPACK_MIN_ARGS]) : 1;
+    if (threads < 1)
+        threads = 1;
+
+    pool_t pool;
+    if (pool_create(&pool, threads) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "run_unpack: pool_create()\n");
+        return EXIT_FAILURE;
+    }
+
+    int status = rf_unpack(argv[2], argv[3], &pool, threads);
+    if (status != EXIT_SUCCESS)
+        fprintf(stderr, "run_unpack: rf_unpack() %s\n", argv[2]);
+
+    pool_free(&pool);
+    return status;
+}
+
+// Profile sampling throughput of a point-to-area job with the grids in rows and in tiles
+int run_bench_layout(const int argc, const char *argv[])
+{
+    if (argc < BENCH_LAYOUT_ARGS)
+    {
+        fprintf(stderr, "Usage: %s %s <job_file>\n", argv[0], BENCH_LAYOUT_OPTION);
         return EXIT_FAILURE;
     }
 
-    // Calculation parameters and defaults
     c1812_parameters_t parameters;
     parameters.ws = DEFAULT_STREET_WIDTH;
     parameters.Ct = NULL;
 
     job_parameters_t job_parameters;
-    if (jobfile_read(&job_parameters, &parameters, argv[1]) != EXIT_SUCCESS)
+    if (jobfile_read(&job_parameters, &parameters, argv[2]) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "main: jobfile_read()\n");
+        fprintf(stderr, "run_bench_layout: jobfile_read()\n");
         return EXIT_FAILURE;
     }
 
     if (validate_job_parameters(&job_parameters) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "main: validate_job_parameters()\n");
+        fprintf(stderr, "run_bench_layout: validate_job_parameters()\n");
         return EXIT_FAILURE;
     }
 
-    int terrain_file_count;
-    terrain_file_t terrain_files[MAX_TERRAIN_FILES];
-    if (open_terrain_files(terrain_files, job_parameters.terrain, &terrain_file_count) != EXIT_SUCCESS)
+    const grid_layout_t layouts[] = {GRID_LAYOUT_ROWS, GRID_LAYOUT_TILES};
+    double rate[2][BENCH_SECTORS];
+
+    data_files_t data;
+    memset(&data, 0, sizeof(data_files_t));
+
+    for (int l = 0; l < 2; l++)
     {
-        fprintf(stderr, "main: open_terrain_files()\n");
+        job_parameters.data_layout = layouts[l];
+        if (load_data_files(&job_parameters, &data) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "run_bench_layout: load_data_files()\n");
+            free_data_files(&data);
+            return EXIT_FAILURE;
+        }
+
+        if (bench_sampling(&job_parameters, &data.terrain_files[0], &data.clutter_files[0], BENCH_SECTORS, rate[l]) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "run_bench_layout: bench_sampling()\n");
+            free_data_files(&data);
+            return EXIT_FAILURE;
+        }
+    }
+
+    free_data_files(&data);
+
+    printf("azimuth [deg]   rows [Msamples/s]   tiles [Msamples/s]\n");
+    for (int s = 0; s < BENCH_SECTORS; s++)
+        printf("%5.0f - %5.0f   %17.1f   %18.1f\n", s * 360.0 / BENCH_SECTORS, (s + 1) * 360.0 / BENCH_SECTORS,
+               rate[0][s] / 1e6, rate[1][s] / 1e6);
+
+    return EXIT_SUCCESS;
+}
+
+int run_job(const char *path, data_files_t *data, pool_t *pool)
+{
+    // Calculation parameters and defaults
+    c1812_parameters_t parameters;
+    parameters.ws = DEFAULT_STREET_WIDTH;
+    parameters.Ct = NULL;
+
+    job_parameters_t job_parameters;
+    if (jobfile_read(&job_parameters, &parameters, path) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "run_job: jobfile_read()\n");
         return EXIT_FAILURE;
     }
 
-    int clutter_file_count;
-    clutter_file_t clutter_files[MAX_CLUTTER_FILES];
-    if (open_clutter_files(clutter_files, job_parameters.clutter, &clutter_file_count) != EXIT_SUCCESS)
+    if (validate_job_parameters(&job_parameters) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "run_job: validate_job_parameters()\n");
+        return EXIT_FAILURE;
+    }
+
+    if (load_data_files(&job_parameters, data) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "main: open_clutter_files()\n");
+        fprintf(stderr, "run_job: load_data_files()\n");
         return EXIT_FAILURE;
     }
 
-    if (terrain_file_count == 0)
+    if (data->terrain_file_count == 0)
     {
-        fprintf(stderr, "main: no terrain data files specified\n");
+        fprintf(stderr, "run_job: no terrain data files specified\n");
         return EXIT_FAILURE;
     }
 
     if (!c_isnan(job_parameters.rxx) && !c_isnan(job_parameters.rxy))
     {
         // Point-to-point calculation
-        if (p2p(&job_parameters, &parameters, terrain_files, clutter_files) != EXIT_SUCCESS)
+        if (p2p(&job_parameters, &parameters, data->terrain_files, data->clutter_files) != EXIT_SUCCESS)
         {
-            fprintf(stderr, "main: p2p()\n");
+            fprintf(stderr, "run_job: p2p()\n");
             return EXIT_FAILURE;
         }
     }
     else
     {
+        // The pool only grows, a job asking for fewer threads leaves the rest idle
+        if (job_parameters.threads > pool->size)
+        {
+            pool_free(pool);
+            if (pool_create(pool, job_parameters.threads) != EXIT_SUCCESS)
+            {
+                fprintf(stderr, "run_job: pool_create()\n");
+                return EXIT_FAILURE;
+            }
+        }
+
         // Point-to-area calculation
-        if (p2a(&job_parameters, &parameters, terrain_files, clutter_files) != EXIT_SUCCESS)
+        if (p2a(&job_parameters, &parameters, data->terrain_files, data->clutter_files, pool) != EXIT_SUCCESS)
         {
-            fprintf(stderr, "main: p2a()\n");
+            fprintf(stderr, "run_job: p2a()\n");
             return EXIT_FAILURE;
         }
     }
 
-    for (int i = 0; i < terrain_file_count; i++)
-        tf_free(&terrain_files[i]);
+    return EXIT_SUCCESS;
+}
 
-    for (int i = 0; i < clutter_file_count; i++)
-        cf_free(&clutter_files[i]);
+int load_data_files(job_parameters_t *job_parameters, data_files_t *data)
+{
+    // Grids opened for an earlier window are kept while it covers the job
+    grid_window_t window;
+    job_window(job_parameters, &window);
+    bool window_covered = !job_parameters->data_window ||
+                          (data->windowed && window.x_min >= data->window.x_min && window.x_max <= data->window.x_max &&
+                           window.y_min >= data->window.y_min && window.y_max <= data->window.y_max);
+
+    if (memcmp(data->terrain_paths, job_parameters->terrain, sizeof(data->terrain_paths)) != 0 ||
+        data->terrain_type != job_parameters->terrain_type ||
+        data->terrain_pyramid != job_parameters->terrain_pyramid ||
+        data->layout != job_parameters->data_layout ||
+        data->windowed != (job_parameters->data_window != 0) || !window_covered ||
+        data->tile_cache != job_parameters->data_tile_cache ||
+        memcmp(data->clutter_paths, job_parameters->clutter, sizeof(data->clutter_paths)) != 0)
+    {
+        free_data_files(data);
+
+        const grid_window_t *open_window = job_parameters->data_window ? &window : NULL;
+        if (open_terrain_files(data->terrain_files, job_parameters->terrain, job_parameters->terrain_type, open_window,
+                               job_parameters->data_tile_cache, &data->terrain_file_count) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "load_data_files: open_terrain_files()\n");
+            return EXIT_FAILURE;
+        }
+
+        if (open_clutter_files(data->clutter_files, job_parameters->clutter, open_window, job_parameters->data_tile_cache,
+                               &data->clutter_file_count) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "load_data_files: open_clutter_files()\n");
+            return EXIT_FAILURE;
+        }
+
+        if (job_parameters->data_layout == GRID_LAYOUT_TILES)
+        {
+            // Mosaic tiles are sampled as they are stored
+            for (int i = 0; i < data->terrain_file_count; i++)
+            {
+                if (data->terrain_files[i].mosaic == NULL && tf_tile(&data->terrain_files[i]) != EXIT_SUCCESS)
+                {
+                    fprintf(stderr, "load_data_files: tf_tile()\n");
+                    return EXIT_FAILURE;
+                }
+            }
+
+            for (int i = 0; i < data->clutter_file_count; i++)
+            {
+                if (data->clutter_files[i].mosaic == NULL && cf_tile(&data->clutter_files[i]) != EXIT_SUCCESS)
+                {
+                    fprintf(stderr, "load_data_files: cf_tile()\n");
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        // Levels are built from the tiled heights, the levels themselves stay row by row
+        for (int i = 0; i < data->terrain_file_count; i++)
+        {
+            if (data->terrain_files[i].mosaic == NULL &&
+                tf_build_pyramid(&data->terrain_files[i], job_parameters->terrain_pyramid) != EXIT_SUCCESS)
+            {
+                fprintf(stderr, "load_data_files: tf_build_pyramid()\n");
+                return EXIT_FAILURE;
+            }
+        }
+
+        memcpy(data->terrain_paths, job_parameters->terrain, sizeof(data->terrain_paths));
+        data->terrain_type = job_parameters->terrain_type;
+        data->terrain_pyramid = job_parameters->terrain_pyramid;
+        data->layout = job_parameters->data_layout;
+        data->windowed = job_parameters->data_window != 0;
+        data->window = window;
+        data->tile_cache = job_parameters->data_tile_cache;
+        memcpy(data->clutter_paths, job_parameters->clutter, sizeof(data->clutter_paths));
+    }
+
+    // Coefficients built by earlier jobs on the same terrain are kept while the budget stays the same
+    for (int i = 0; i < data->terrain_file_count; i++)
+    {
+        data->terrain_files[i].pyramid_near = job_parameters->terrain_pyramid_near;
+        if (data->terrain_files[i].mosaic == NULL &&
+            tf_coefficients_enable(&data->terrain_files[i], (size_t)job_parameters->terrain_coefficients * MIB) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "load_data_files: tf_coefficients_enable()\n");
+            return EXIT_FAILURE;
+        }
+    }
 
     return EXIT_SUCCESS;
 }
 
+void free_data_files(data_files_t *data)
+{
+    for (int i = 0; i < data->terrain_file_count; i++)
+        tf_free(&data->terrain_files[i]);
+
+    for (int i = 0; i < data->clutter_file_count; i++)
+        cf_free(&data->clutter_files[i]);
+
+    memset(data, 0, sizeof(data_files_t));
+}
+
 int validate_job_parameters(job_parameters_t *job_parameters)
 {
     if (c_isnan(job_parameters->txx) || c_isnan(job_parameters->txy))
@@ -152,89 +414,179 @@ int validate_job_parameters(job_parameters_t *job_parameters)
         return EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
-}
-
-int open_terrain_files(terrain_file_t *tfs, char paths[MAX_TERRAIN_FILES][MAX_VALUE_LENGTH], int *tf_count)
-{
-    for (int i = 0; i < MAX_TERRAIN_FILES; i++)
+    // A version 1 RF file holds only the f64 losses
+    if (strlen(job_parameters->out) > 0 && job_parameters->out_version == 1)
     {
-        // Should not happen
-        if (paths[i] == NULL)
+        if (job_parameters->out_terrain || job_parameters->out_clutter)
         {
-            fprintf(stderr, "open_terrain_files: filenames[%d] == NULL\n", i);
+            fprintf(stderr, "validate_job_parameters: out_rf_terrain and out_rf_clutter need out_rf_version 2\n");
             return EXIT_FAILURE;
         }
 
-        int len = strlen(paths[i]);
-        if (len == 0) // First empty filename marks the end of the list
+        if (job_parameters->out_compression)
         {
-            *tf_count = i;
-            return EXIT_SUCCESS;
+            fprintf(stderr, "validate_job_parameters: out_rf_compression needs out_rf_version 2\n");
+            return EXIT_FAILURE;
         }
 
-        // If data[i] ends in .df, then it's an already processed file
-        // that can be opened directly
-        if (strcmp(paths[i] + len - PARSED_TF_EXT_LEN, PARSED_TF_EXT) == 0)
+        if (job_parameters->result_type != RESULT_STORE_F64)
         {
-            if (tf_open(&tfs[i], paths[i]) != EXIT_SUCCESS)
-            {
-                fprintf(stderr, "open_terrain_files: tf_open()\n");
-                return EXIT_FAILURE;
-            }
+            fprintf(stderr, "validate_job_parameters: result_type other than f64 needs out_rf_version 2\n");
+            return EXIT_FAILURE;
         }
-        else // Otherwise, it's a text file that needs to be parsed
-        {
-            if (tf_parse(&tfs[i], paths[i]) != EXIT_SUCCESS)
-            {
-                fprintf(stderr, "open_terrain_files: tf_parse()\n");
-                return EXIT_FAILURE;
-            }
+    }
 
-            // The parsed file is stored for future use
-            char *parsed_tf_path = malloc(len + 1 + PARSED_TF_EXT_LEN + 1);
-            strcpy(parsed_tf_path, paths[i]);
-            strcat(parsed_tf_path, PARSED_TF_EXT);
+    return EXIT_SUCCESS;
+}
 
-            if (tf_store(&tfs[i], parsed_tf_path) != EXIT_SUCCESS)
-            {
-                fprintf(stderr, "open_terrain_files: tf_store()\n");
-                return EXIT_FAILURE;
-            }
+void job_window(const job_parameters_t *job_parameters, grid_window_t *window)
+{
+    if (!c_isnan(job_parameters->rxx) && !c_isnan(job_parameters->rxy))
+    {
+        // Point-to-point, the path between the transmitter and the receiver
+        window->x_min = c_min(job_parameters->txx, job_parameters->rxx);
+        window->x_max = c_max(job_parameters->txx, job_parameters->rxx);
+        window->y_min = c_min(job_parameters->txy, job_parameters->rxy);
+        window->y_max = c_max(job_parameters->txy, job_parameters->rxy);
+    }
+    else
+    {
+        // Point-to-area, the square around the circle of rays
+        window->x_min = job_parameters->txx - job_parameters->radius;
+        window->x_max = job_parameters->txx + job_parameters->radius;
+        window->y_min = job_parameters->txy - job_parameters->radius;
+        window->y_max = job_parameters->txy + job_parameters->radius;
+    }
+}
 
-            free(parsed_tf_path);
-        }
+int store_parsed_terrain(const char *path, grid_sample_type_t type, char **tf_path)
+{
+    terrain_file_t tf;
+    if (tf_parse(&tf, path) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "store_parsed_terrain: tf_parse()\n");
+        return EXIT_FAILURE;
     }
 
-    *tf_count = MAX_TERRAIN_FILES;
+    // The parsed file is stored for future use
+    char *parsed_tf_path = malloc(strlen(path) + PARSED_TF_EXT_LEN + 1);
+    if (parsed_tf_path == NULL)
+    {
+        fprintf(stderr, "store_parsed_terrain: malloc()\n");
+        tf_free(&tf);
+        return EXIT_FAILURE;
+    }
+    strcpy(parsed_tf_path, path);
+    strcat(parsed_tf_path, PARSED_TF_EXT);
+
+    int status = tf_store(&tf, parsed_tf_path, type);
+    tf_free(&tf);
+    if (status != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "store_parsed_terrain: tf_store()\n");
+        free(parsed_tf_path);
+        return EXIT_FAILURE;
+    }
+
+    *tf_path = parsed_tf_path;
     return EXIT_SUCCESS;
 }
 
-int open_clutter_files(clutter_file_t *cfs, char paths[MAX_CLUTTER_FILES][MAX_VALUE_LENGTH], int *cf_count)
+void free_paths(char **paths, int count)
 {
-    for (int i = 0; i < MAX_CLUTTER_FILES; i++)
+    for (int i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+}
+
+int open_terrain_files(terrain_file_t *tfs, char paths[MAX_TERRAIN_FILES][MAX_VALUE_LENGTH], grid_sample_type_t type,
+                       const grid_window_t *window, int tile_cache, int *tf_count)
+{
+    // Several files, directories and manifests make a mosaic
+    char **tiles = NULL;
+    int tile_count = 0;
+    bool mosaic = false;
+    for (int i = 0; i < MAX_TERRAIN_FILES && strlen(paths[i]) > 0; i++) // First empty filename marks the end of the list
     {
-        // Should not happen
-        if (paths[i] == NULL)
+        mosaic = mosaic || i > 0 || grid_mosaic_is_list(paths[i]);
+        if (grid_mosaic_list(paths[i], PARSED_TF_EXT, &tiles, &tile_count) != EXIT_SUCCESS)
         {
-            fprintf(stderr, "open_clutter_files: filenames[%d] == NULL\n", i);
+            fprintf(stderr, "open_terrain_files: grid_mosaic_list() %s\n", paths[i]);
+            free_paths(tiles, tile_count);
             return EXIT_FAILURE;
         }
+    }
+
+    *tf_count = 0;
+    if (tile_count == 0)
+    {
+        free_paths(tiles, tile_count);
+        return EXIT_SUCCESS;
+    }
 
-        int len = strlen(paths[i]);
-        if (len == 0) // First empty filename marks the end of the list
+    // Text files are parsed, and the job works on the stored samples, as every later job opening the .tf will
+    for (int t = 0; t < tile_count; t++)
+    {
+        int len = strlen(tiles[t]);
+        if (len < PARSED_TF_EXT_LEN || strcmp(tiles[t] + len - PARSED_TF_EXT_LEN, PARSED_TF_EXT) != 0)
         {
-            *cf_count = i;
-            return EXIT_SUCCESS;
+            char *parsed_tf_path;
+            if (store_parsed_terrain(tiles[t], type, &parsed_tf_path) != EXIT_SUCCESS)
+            {
+                fprintf(stderr, "open_terrain_files: store_parsed_terrain() %s\n", tiles[t]);
+                free_paths(tiles, tile_count);
+                return EXIT_FAILURE;
+            }
+            free(tiles[t]);
+            tiles[t] = parsed_tf_path;
         }
+    }
+
+    int status = mosaic ? tf_open_mosaic(&tfs[0], tiles, tile_count, tile_cache) : tf_open(&tfs[0], tiles[0], window);
+    free_paths(tiles, tile_count);
+    if (status != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "open_terrain_files: %s\n", mosaic ? "tf_open_mosaic()" : "tf_open()");
+        return EXIT_FAILURE;
+    }
 
-        if (cf_open(&cfs[i], paths[i]) != EXIT_SUCCESS)
+    *tf_count = 1;
+    return EXIT_SUCCESS;
+}
+
+int open_clutter_files(clutter_file_t *cfs, char paths[MAX_CLUTTER_FILES][MAX_VALUE_LENGTH], const grid_window_t *window,
+                       int tile_cache, int *cf_count)
+{
+    // Several files, directories and manifests make a mosaic
+    char **tiles = NULL;
+    int tile_count = 0;
+    bool mosaic = false;
+    for (int i = 0; i < MAX_CLUTTER_FILES && strlen(paths[i]) > 0; i++) // First empty filename marks the end of the list
+    {
+        mosaic = mosaic || i > 0 || grid_mosaic_is_list(paths[i]);
+        if (grid_mosaic_list(paths[i], CLUTTER_EXT, &tiles, &tile_count) != EXIT_SUCCESS)
         {
-            fprintf(stderr, "open_clutter_files: cf_open()\n");
+            fprintf(stderr, "open_clutter_files: grid_mosaic_list() %s\n", paths[i]);
+            free_paths(tiles, tile_count);
             return EXIT_FAILURE;
         }
     }
 
-    *cf_count = MAX_CLUTTER_FILES;
+    *cf_count = 0;
+    if (tile_count == 0)
+    {
+        free_paths(tiles, tile_count);
+        return EXIT_SUCCESS;
+    }
+
+    int status = mosaic ? cf_open_mosaic(&cfs[0], tiles, tile_count, tile_cache) : cf_open(&cfs[0], tiles[0], window);
+    free_paths(tiles, tile_count);
+    if (status != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "open_clutter_files: %s\n", mosaic ? "cf_open_mosaic()" : "cf_open()");
+        return EXIT_FAILURE;
+    }
+
+    *cf_count = 1;
     return EXIT_SUCCESS;
 }
\ No newline at end of file
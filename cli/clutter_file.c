@@ -1,184 +1,337 @@
 #include "clutter_file.h"
-#include "nneighbor.h"
+#include "grid_axis.h"
 #include "c1812/custom_math.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Samples a line walk looks ahead to prefetch the cell it will need
+#define PREFETCH_AHEAD 16
+
+// Ticks around a window for the bilinear cells on its edges
+#define WINDOW_MARGIN 1
+
+// Ticks between a point sampled from a mosaic tile and its far edges, none for a bilinear cell
+#define MOSAIC_MARGIN 0
 
 void cf_zero(clutter_file_t *ctfile)
 {
 	ctfile->y_size = 0;
 	ctfile->x_size = 0;
+	ctfile->stride = 0;
+	ctfile->tiles_x = 0;
+	ctfile->layout = GRID_LAYOUT_ROWS;
 	ctfile->y = NULL;
 	ctfile->x = NULL;
+	grid_axis_init(&ctfile->y_axis, NULL, 0);
+	grid_axis_init(&ctfile->x_axis, NULL, 0);
 	ctfile->Ct = NULL;
+	ctfile->mosaic = NULL;
+	memset(&ctfile->file, 0, sizeof(grid_file_t));
 }
 
-int cf_open(clutter_file_t *cf, const char *path)
+int cf_open(clutter_file_t *cf, const char *path, const grid_window_t *window)
 {
 	cf_zero(cf);
 
-	FILE *fp = fopen(path, "rb");
-	if (fp == NULL)
+	if (grid_file_map_window(&cf->file, path, GRID_FILE_MAGIC_CLUTTER, GRID_SAMPLE_U8, window, WINDOW_MARGIN) != EXIT_SUCCESS)
 	{
-		fprintf(stderr, "ctfile_open: fopen(%s) failed\n", path);
+		fprintf(stderr, "ctfile_open: grid_file_map_window(%s) failed\n", path);
 		return EXIT_FAILURE;
 	}
 
-	if (fread(&cf->y_size, sizeof(int), 1, fp) != 1)
+	if (cf->file.type != GRID_SAMPLE_U8)
 	{
-		fprintf(stderr, "ctfile_open: fread(y_size) failed\n");
-		fclose(fp);
+		fprintf(stderr, "ctfile_open: %s does not hold 8-bit samples\n", path);
+		grid_file_unmap(&cf->file);
 		return EXIT_FAILURE;
 	}
 
-	if (fread(&cf->x_size, sizeof(int), 1, fp) != 1)
-	{
-		fprintf(stderr, "ctfile_open: fread(x_size) failed\n");
-		fclose(fp);
-		return EXIT_FAILURE;
-	}
+	cf->y_size = cf->file.y_size;
+	cf->x_size = cf->file.x_size;
+	cf->stride = cf->file.stride;
+	cf->y = cf->file.y;
+	cf->x = cf->file.x;
+	cf->Ct = cf->file.grid;
+	grid_axis_init(&cf->y_axis, cf->y, cf->y_size);
+	grid_axis_init(&cf->x_axis, cf->x, cf->x_size);
 
-	cf->y = malloc(cf->y_size * sizeof(double));
-	if (cf->y == NULL)
-	{
-		fprintf(stderr, "ctfile_open: malloc(y) failed\n");
-		fclose(fp);
-		return EXIT_FAILURE;
-	}
+	return EXIT_SUCCESS;
+}
 
-	if (fread(cf->y, sizeof(double), cf->y_size, fp) != cf->y_size)
-	{
-		fprintf(stderr, "ctfile_open: fread(y) failed\n");
-		free(cf->y);
-		fclose(fp);
-		return EXIT_FAILURE;
-	}
+int _cf_mosaic_open(void *grid, const char *path)
+{
+	return cf_open(grid, path, NULL);
+}
+
+void _cf_mosaic_free(void *grid)
+{
+	cf_free(grid);
+}
+
+grid_file_t *_cf_mosaic_file(void *grid)
+{
+	return &((clutter_file_t *)grid)->file;
+}
+
+double _cf_mosaic_sample(void *grid, double x, double y, double x_tolerance, double y_tolerance)
+{
+	clutter_file_t *cf = grid;
+	int xi = grid_axis_nearest(&cf->x_axis, cf->x, cf->x_size, x);
+	int yi = grid_axis_nearest(&cf->y_axis, cf->y, cf->y_size, y);
+	if (!(c_abs(cf->x[xi] - x) <= x_tolerance && c_abs(cf->y[yi] - y) <= y_tolerance))
+		return NAN;
+
+	return (double)CF_CT(cf, yi, xi);
+}
 
-	cf->x = malloc(cf->x_size * sizeof(double));
-	if (cf->x == NULL)
+static const grid_mosaic_kind_t _cf_mosaic_kind = {
+	GRID_FILE_MAGIC_CLUTTER, GRID_SAMPLE_U8, MOSAIC_MARGIN, sizeof(clutter_file_t),
+	_cf_mosaic_open, _cf_mosaic_free, _cf_mosaic_file, _cf_mosaic_sample,
+};
+
+int cf_open_mosaic(clutter_file_t *cf, char **paths, int count, int capacity)
+{
+	cf_zero(cf);
+
+	cf->mosaic = malloc(sizeof(grid_mosaic_t));
+	if (cf->mosaic == NULL)
 	{
-		fprintf(stderr, "ctfile_open: malloc(x) failed\n");
-		free(cf->y);
-		fclose(fp);
+		fprintf(stderr, "cf_open_mosaic: malloc() mosaic\n");
 		return EXIT_FAILURE;
 	}
 
-	if (fread(cf->x, sizeof(double), cf->x_size, fp) != cf->x_size)
+	if (grid_mosaic_create(cf->mosaic, &_cf_mosaic_kind, paths, count, capacity) != EXIT_SUCCESS)
 	{
-		fprintf(stderr, "ctfile_open: fread(x) failed\n");
-		free(cf->y);
-		free(cf->x);
-		fclose(fp);
+		fprintf(stderr, "cf_open_mosaic: grid_mosaic_create()\n");
+		free(cf->mosaic);
+		cf->mosaic = NULL;
 		return EXIT_FAILURE;
 	}
 
-	cf->Ct = malloc(cf->y_size * sizeof(uint8_t *));
-	if (cf->Ct == NULL)
+	return EXIT_SUCCESS;
+}
+
+int cf_tile(clutter_file_t *cf)
+{
+	void *tiles;
+	if (grid_layout_tile(cf->Ct, cf->y_size, cf->x_size, cf->stride, sizeof(uint8_t), &tiles, &cf->tiles_x) != EXIT_SUCCESS)
 	{
-		fprintf(stderr, "ctfile_open: malloc(Ct) failed\n");
-		free(cf->y);
-		free(cf->x);
-		fclose(fp);
+		fprintf(stderr, "cf_tile: grid_layout_tile()\n");
 		return EXIT_FAILURE;
 	}
 
-	for (int y = 0; y < cf->y_size; y++)
-	{
-		cf->Ct[y] = malloc(cf->x_size * sizeof(uint8_t));
-		if (cf->Ct[y] == NULL)
-		{
-			fprintf(stderr, "ctfile_open: malloc(Ct[y]) failed\n");
-			for (int i = 0; i < y; i++)
-				free(cf->Ct[i]);
-			free(cf->Ct);
-			free(cf->y);
-			free(cf->x);
-			fclose(fp);
-			return EXIT_FAILURE;
-		}
+	cf->Ct = tiles;
+	cf->layout = GRID_LAYOUT_TILES;
 
-		if (fread(cf->Ct[y], sizeof(uint8_t), cf->x_size, fp) != cf->x_size)
-		{
-			fprintf(stderr, "ctfile_open: fread(Ct[y]) failed\n");
-			for (int i = 0; i <= y; i++)
-				free(cf->Ct[i]);
-			free(cf->Ct);
-			free(cf->y);
-			free(cf->x);
-			fclose(fp);
-			return EXIT_FAILURE;
-		}
-	}
-
-	fclose(fp);
 	return EXIT_SUCCESS;
 }
 
 void cf_free(clutter_file_t *cf)
 {
-	for (int y = 0; y < cf->y_size; y++)
-		free(cf->Ct[y]);
-	free(cf->Ct);
-	free(cf->y);
-	free(cf->x);
+	if (cf->mosaic != NULL)
+	{
+		grid_mosaic_free(cf->mosaic);
+		free(cf->mosaic);
+	}
+
+	if (cf->layout == GRID_LAYOUT_TILES)
+		free(cf->Ct);
+	grid_file_unmap(&cf->file);
 	cf_zero(cf);
 }
 
 double cf_get_nn(clutter_file_t *cf, const double x, const double y)
 {
-	int closest_x_index;
-	double closest_x = nneighbor(cf->x, cf->x_size, x, &closest_x_index);
-
-	int closest_y_index;
-	double closest_y = nneighbor(cf->y, cf->y_size, y, &closest_y_index);
+	int closest_x_index = grid_axis_nearest(&cf->x_axis, cf->x, cf->x_size, x);
+	int closest_y_index = grid_axis_nearest(&cf->y_axis, cf->y, cf->y_size, y);
 
-	return (double) cf->Ct[closest_y_index][closest_x_index];
+	return (double) CF_CT(cf, closest_y_index, closest_x_index);
 }
 
-double cf_get_bilinear(clutter_file_t *cf, const double x, const double y)
+// A bilinear cell, between ticks xi, xi + 1 and yi, yi + 1
+typedef struct
+{
+	int xi;
+	int yi;
+	bool inside; // the cell lies inside the grid
+	double x1, x2;
+	double y1, y2;
+	double Ct11, Ct12, Ct21, Ct22;
+} _cf_cell_t;
+
+void _cf_cell_load(clutter_file_t *cf, int xi, int yi, _cf_cell_t *cell)
 {
-	int x1_index;
-	double x1 = nneighbor(cf->x, cf->x_size, x, &x1_index);
-	if (x1 > x)
+	cell->xi = xi;
+	cell->yi = yi;
+	cell->inside = xi >= 0 && xi + 1 < cf->x_size && yi >= 0 && yi + 1 < cf->y_size;
+	if (!cell->inside)
+		return;
+
+	cell->x1 = cf->x[xi];
+	cell->x2 = cf->x[xi + 1];
+	cell->y1 = cf->y[yi];
+	cell->y2 = cf->y[yi + 1];
+
+	// Find the clutter heights at the corners of the rectangle
+	size_t index;
+	int pitch;
+	if (grid_layout_block(cf->layout, cf->stride, cf->tiles_x, yi, xi, 2, &index, &pitch))
 	{
-		x1_index--;
-		if (x1_index < 0)
-			return 0;
-		x1 = cf->x[x1_index];
+		cell->Ct11 = (double)cf->Ct[index];
+		cell->Ct12 = (double)cf->Ct[index + 1];
+		cell->Ct21 = (double)cf->Ct[index + pitch];
+		cell->Ct22 = (double)cf->Ct[index + pitch + 1];
 	}
+	else
+	{
+		cell->Ct11 = (double)CF_CT(cf, yi, xi);
+		cell->Ct12 = (double)CF_CT(cf, yi, xi + 1);
+		cell->Ct21 = (double)CF_CT(cf, yi + 1, xi);
+		cell->Ct22 = (double)CF_CT(cf, yi + 1, xi + 1);
+	}
+}
 
-	int x2_index = x1_index + 1;
-	if (x2_index >= cf->x_size)
+double _cf_cell_bilinear(const _cf_cell_t *cell, const double x, const double y)
+{
+	if (!cell->inside)
 		return 0;
-	double x2 = cf->x[x2_index];
 
-	int y1_index;
-	double y1 = nneighbor(cf->y, cf->y_size, y, &y1_index);
-	if (y1 > y)
+	// Find the heights at the edges of the rectangle
+	double Ct1 = cell->Ct11 + (cell->Ct12 - cell->Ct11) * (x - cell->x1) / (cell->x2 - cell->x1);
+	double Ct2 = cell->Ct21 + (cell->Ct22 - cell->Ct21) * (x - cell->x1) / (cell->x2 - cell->x1);
+
+	// Find the height at the point
+	return Ct1 + (Ct2 - Ct1) * (y - cell->y1) / (cell->y2 - cell->y1);
+}
+
+double cf_get_bilinear(clutter_file_t *cf, const double x, const double y)
+{
+	_cf_cell_t cell;
+	_cf_cell_load(cf, grid_axis_floor(&cf->x_axis, cf->x, cf->x_size, x),
+				  grid_axis_floor(&cf->y_axis, cf->y, cf->y_size, y), &cell);
+
+	return _cf_cell_bilinear(&cell, x, y);
+}
+
+// Start loading the corners of cell xi, yi into the cache
+void _cf_prefetch(clutter_file_t *cf, int xi, int yi)
+{
+#if defined(__GNUC__)
+	if (xi < 0 || xi + 1 >= cf->x_size || yi < 0 || yi + 1 >= cf->y_size)
+		return;
+
+	__builtin_prefetch(&CF_CT(cf, yi, xi));
+	__builtin_prefetch(&CF_CT(cf, yi + 1, xi));
+#endif
+}
+
+// Points first .. last - 1 of cf_sample_line() from this grid alone
+void _cf_sample_range(clutter_file_t *cf, const double x1, const double y1, const double x2, const double y2, int n,
+					  int first, int last, double *Ct)
+{
+	_cf_cell_t cell;
+	cell.xi = cell.yi = -1;
+	cell.inside = false;
+
+	for (int i = first; i < last; i++)
 	{
-		y1_index--;
-		if (y1_index < 0)
-			return 0;
-		y1 = cf->y[y1_index];
+		double t = (n > 1) ? i / (n - 1.0) : 0.0;
+		double x = x1 + (x2 - x1) * t;
+		double y = y1 + (y2 - y1) * t;
+
+		int xi = grid_axis_step(&cf->x_axis, cf->x, cf->x_size, cell.xi, x);
+		int yi = grid_axis_step(&cf->y_axis, cf->y, cf->y_size, cell.yi, y);
+		if (xi != cell.xi || yi != cell.yi)
+		{
+			_cf_cell_load(cf, xi, yi, &cell);
+
+			if (i + PREFETCH_AHEAD < n)
+			{
+				double ahead = (i + PREFETCH_AHEAD) / (n - 1.0);
+				_cf_prefetch(cf, grid_axis_floor(&cf->x_axis, cf->x, cf->x_size, x1 + (x2 - x1) * ahead),
+							 grid_axis_floor(&cf->y_axis, cf->y, cf->y_size, y1 + (y2 - y1) * ahead));
+			}
+		}
+
+		Ct[i] = _cf_cell_bilinear(&cell, x, y);
 	}
+}
 
-	int y2_index = y1_index + 1;
-	if (y2_index >= cf->y_size)
+// Bilinear interpolation at x, y from the corners gathered across the tiles of a mosaic, 0 outside them
+double _cf_mosaic_bilinear(grid_mosaic_t *m, const double x, const double y)
+{
+	_cf_cell_t cell;
+	double xs[2], ys[2], Ct[2][2]; // Ct[row][column]
+	if (grid_mosaic_gather(m, x, y, 0, 2, xs, ys, &Ct[0][0]) != EXIT_SUCCESS)
 		return 0;
-	double y2 = cf->y[y2_index];
 
-	// Find the clutter heights at the corners of the rectangle
-	double Ct11 = (double)cf->Ct[y1_index][x1_index];
-	double Ct12 = (double)cf->Ct[y1_index][x2_index];
-	double Ct21 = (double)cf->Ct[y2_index][x1_index];
-	double Ct22 = (double)cf->Ct[y2_index][x2_index];
+	cell.inside = !c_isnan(Ct[0][0]) && !c_isnan(Ct[0][1]) && !c_isnan(Ct[1][0]) && !c_isnan(Ct[1][1]);
+	cell.x1 = xs[0];
+	cell.x2 = xs[1];
+	cell.y1 = ys[0];
+	cell.y2 = ys[1];
+	cell.Ct11 = Ct[0][0];
+	cell.Ct12 = Ct[0][1];
+	cell.Ct21 = Ct[1][0];
+	cell.Ct22 = Ct[1][1];
 
-	// Find the heights at the edges of the rectangle
-	double Ct1 = Ct11 + (Ct12 - Ct11) * (x - x1) / (x2 - x1);
-	double Ct2 = Ct21 + (Ct22 - Ct21) * (x - x1) / (x2 - x1);
+	return _cf_cell_bilinear(&cell, x, y);
+}
 
-	// Find the height at the point
-	double Ct = Ct1 + (Ct2 - Ct1) * (y - y1) / (y2 - y1);
+// cf_sample_line() of a mosaic, one run of points inside the same tile at a time
+void _cf_mosaic_sample_line(clutter_file_t *cf, const double x1, const double y1, const double x2, const double y2,
+							int n, double *Ct)
+{
+	grid_mosaic_t *m = cf->mosaic;
 
-	return Ct;
-}
\ No newline at end of file
+	int i = 0;
+	while (i < n)
+	{
+		double t = (n > 1) ? i / (n - 1.0) : 0.0;
+		double x = x1 + (x2 - x1) * t;
+		double y = y1 + (y2 - y1) * t;
+
+		// A point on the far edge of every tile holding it, or between tiles, takes its
+		// corners from all the tiles around it
+		int tile = grid_mosaic_find(m, x, y);
+		if (tile < 0 || !grid_mosaic_inside(m, tile, x, y))
+		{
+			Ct[i++] = _cf_mosaic_bilinear(m, x, y);
+			continue;
+		}
+
+		int last = i + 1;
+		while (last < n)
+		{
+			double t_last = (n > 1) ? last / (n - 1.0) : 0.0;
+			if (!grid_mosaic_inside(m, tile, x1 + (x2 - x1) * t_last, y1 + (y2 - y1) * t_last))
+				break;
+			last++;
+		}
+
+		clutter_file_t *grid = grid_mosaic_acquire(m, tile);
+		if (grid != NULL)
+		{
+			_cf_sample_range(grid, x1, y1, x2, y2, n, i, last, Ct);
+			grid_mosaic_release(m, tile);
+		}
+		else
+		{
+			for (int k = i; k < last; k++)
+				Ct[k] = 0;
+		}
+
+		i = last;
+	}
+}
+
+void cf_sample_line(clutter_file_t *cf, const double x1, const double y1, const double x2, const double y2, int n,
+					double *Ct)
+{
+	if (cf->mosaic != NULL)
+		_cf_mosaic_sample_line(cf, x1, y1, x2, y2, n, Ct);
+	else
+		_cf_sample_range(cf, x1, y1, x2, y2, n, 0, n, Ct);
+}
@@ -2,16 +2,30 @@
 #define CLUTTER_FILE_H
 
 #include <stdint.h>
+#include "grid_file.h"
+#include "grid_axis.h"
+#include "grid_layout.h"
+#include "grid_mosaic.h"
 
 typedef struct
 {
 	int y_size;	   // rows
 	int x_size;	   // columns
+	int stride;	   // values from the start of one row of Ct to the next, GRID_LAYOUT_ROWS
+	int tiles_x;   // tiles along x, GRID_LAYOUT_TILES
 	double *y;	   // y axis ticks
 	double *x;	   // x axis ticks
-	uint8_t **Ct; // grid of height values, Ct[y][x], [centimeters]
+	grid_axis_t y_axis; // lookup of y on the y ticks
+	grid_axis_t x_axis; // lookup of x on the x ticks
+	grid_layout_t layout; // order of the values of Ct
+	uint8_t *Ct;  // grid of height values, [centimeters], allocated in GRID_LAYOUT_TILES
+	grid_file_t file; // mapping y, x and Ct point into
+	grid_mosaic_t *mosaic; // tiles sampled by cf_sample_line() in place of this grid, NULL for a single grid
 } clutter_file_t;
 
+// Clutter height at row yi, column xi
+#define CF_CT(cf, yi, xi) ((cf)->Ct[grid_layout_index((cf)->layout, (cf)->stride, (cf)->tiles_x, yi, xi)])
+
 /**
  * @brief Clear clutter data file.
  *
@@ -22,12 +36,43 @@ void cf_zero(clutter_file_t *cf);
 /**
  * @brief Read clutter data file from disk.
  *
+ * The file is mapped read-only and used in place, version 1 and 2 layouts alike. With a
+ * window only the values around it are mapped, x and y keep the coordinates of the file.
+ *
  * @param cf Pointer to ctfile_t structure
  * @param path Path to clutter data file.
+ * @param window Area of interest, NULL for the whole file.
  *
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
  */
-int cf_open(clutter_file_t *cf, const char *path);
+int cf_open(clutter_file_t *cf, const char *path, const grid_window_t *window);
+
+/**
+ * @brief Open clutter files as the tiles of a mosaic.
+ *
+ * Tiles are mapped when a line is first sampled from them, at most capacity of them at a
+ * time. Where tiles overlap, the first one that holds the cell of a point is sampled; the
+ * corners of a cell split between abutting tiles are gathered across them, so the tiles
+ * must continue each other's evenly spaced ticks. A mosaic is sampled by cf_sample_line()
+ * only.
+ *
+ * @param cf Pointer to ctfile_t structure
+ * @param paths Paths to the clutter files of the tiles.
+ * @param count Number of tiles.
+ * @param capacity Tiles kept mapped at most.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int cf_open_mosaic(clutter_file_t *cf, char **paths, int count, int capacity);
+
+/**
+ * @brief Rearrange the clutter values into GRID_LAYOUT_TILES.
+ *
+ * @param cf Pointer to ctfile_t structure, in GRID_LAYOUT_ROWS.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int cf_tile(clutter_file_t *cf);
 
 /**
  * @brief Deallocate and clear clutter data file.
@@ -58,4 +103,22 @@ double cf_get_nn(clutter_file_t *cf, const double x, const double y);
  */
 double cf_get_bilinear(clutter_file_t *cf, const double x, const double y);
 
+/**
+ * @brief Bilinearly interpolated clutter at n evenly spaced points from x1, y1 to x2, y2.
+ *
+ * Point i lies at fraction i / (n - 1) of the way. The points are walked cell by cell,
+ * with the same results as cf_get_bilinear() at the same points. A mosaic samples each run
+ * of points inside one tile from that tile. Safe to call from several threads at once.
+ *
+ * @param cf The ctfile_t structure to sample.
+ * @param x1 The x coordinate of the first point.
+ * @param y1 The y coordinate of the first point.
+ * @param x2 The x coordinate of the last point.
+ * @param y2 The y coordinate of the last point.
+ * @param n Number of points.
+ * @param Ct Set to the n clutter values, 0 outside the grid.
+ */
+void cf_sample_line(clutter_file_t *cf, const double x1, const double y1, const double x2, const double y2, int n,
+					double *Ct);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "grid_axis.h"
+#include "c1812/custom_math.h"
+
+// Largest deviation of a tick from origin + i * step, relative to step, of an evenly spaced axis
+#define UNIFORM_TOLERANCE 1e-3
+
+void grid_axis_init(grid_axis_t *axis, const double *ticks, int size)
+{
+    axis->origin = (size > 0) ? ticks[0] : 0.0;
+    axis->step = 0.0;
+    axis->inv_step = 0.0;
+
+    if (size < 2)
+        return;
+
+    double step = (ticks[size - 1] - ticks[0]) / (size - 1);
+    if (!(step > 0))
+        return;
+
+    for (int i = 1; i < size; i++)
+    {
+        if (c_abs(ticks[i] - (axis->origin + i * step)) > UNIFORM_TOLERANCE * step)
+            return;
+    }
+
+    axis->step = step;
+    axis->inv_step = 1 / step;
+}
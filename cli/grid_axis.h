@@ -0,0 +1,120 @@
+#ifndef GRID_AXIS_H
+#define GRID_AXIS_H
+
+#include "nneighbor.h"
+
+/*
+ * Lookup of coordinates on the ticks of a grid axis. Evenly spaced ticks, as in
+ * almost every raster, are indexed arithmetically, other axes are searched
+ */
+typedef struct
+{
+    double origin;   // first tick
+    double step;     // distance between ticks, 0 when they are not evenly spaced
+    double inv_step; // 1 / step
+} grid_axis_t;
+
+/**
+ * @brief Detect whether the ticks of an axis are evenly spaced.
+ *
+ * @param axis Pointer to the axis structure.
+ * @param ticks Ascending axis ticks.
+ * @param size Number of ticks.
+ */
+void grid_axis_init(grid_axis_t *axis, const double *ticks, int size);
+
+/**
+ * @brief Index of the last tick at or below v.
+ *
+ * @param axis Axis set up by grid_axis_init() for the same ticks.
+ * @param ticks Ascending axis ticks.
+ * @param size Number of ticks.
+ * @param v Coordinate.
+ *
+ * @return Tick index, -1 when v is below the first tick.
+ */
+static inline int grid_axis_floor(const grid_axis_t *axis, const double *ticks, int size, double v)
+{
+    if (axis->step > 0)
+    {
+        if (!(v >= ticks[0]))
+            return -1;
+        if (v >= ticks[size - 1])
+            return size - 1;
+
+        // Ticks stray from origin + i * step by far less than a step, one correction is enough
+        int i = (int)((v - axis->origin) * axis->inv_step);
+        if (i > size - 2)
+            i = size - 2;
+        if (ticks[i] > v)
+            i--;
+        else if (ticks[i + 1] <= v)
+            i++;
+        return i;
+    }
+
+    int i;
+    if (nneighbor(ticks, size, v, &i) > v)
+        i--;
+    return i;
+}
+
+/**
+ * @brief grid_axis_floor() of v, given the floor index of a nearby coordinate.
+ *
+ * Consecutive samples along a line stay in the same cell or move to a neighbouring
+ * one, which is checked against the ticks without any index arithmetic.
+ *
+ * @param axis Axis set up by grid_axis_init() for the same ticks.
+ * @param ticks Ascending axis ticks.
+ * @param size Number of ticks.
+ * @param i Floor index of the previous coordinate.
+ * @param v Coordinate.
+ *
+ * @return Tick index, -1 when v is below the first tick.
+ */
+static inline int grid_axis_step(const grid_axis_t *axis, const double *ticks, int size, int i, double v)
+{
+    if (i >= 0 && i + 1 < size && ticks[i] <= v)
+    {
+        if (v < ticks[i + 1])
+            return i;
+        if (i + 2 < size && v < ticks[i + 2])
+            return i + 1;
+    }
+    else if (i >= 1 && i < size && ticks[i - 1] <= v && v < ticks[i])
+    {
+        return i - 1;
+    }
+
+    return grid_axis_floor(axis, ticks, size, v);
+}
+
+/**
+ * @brief Index of the tick nearest to v, the upper one of two equally near ticks.
+ *
+ * @param axis Axis set up by grid_axis_init() for the same ticks.
+ * @param ticks Ascending axis ticks.
+ * @param size Number of ticks.
+ * @param v Coordinate.
+ *
+ * @return Tick index.
+ */
+static inline int grid_axis_nearest(const grid_axis_t *axis, const double *ticks, int size, double v)
+{
+    if (axis->step > 0)
+    {
+        int i = grid_axis_floor(axis, ticks, size, v);
+        if (i < 0)
+            return 0;
+        if (i >= size - 1)
+            return size - 1;
+        return (v - ticks[i] >= ticks[i + 1] - v) ? i + 1 : i;
+    }
+
+    int i;
+    nneighbor(ticks, size, v, &i);
+    return i;
+}
+
+#endif
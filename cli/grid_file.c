@@ -0,0 +1,402 @@
+#include "grid_file.h"
+#include "grid_axis.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "c1812/custom_math.h"
+
+#define WRITE_BINARY "wb"
+
+// Version 2 header layout, see grid_file.h
+#define V2_VERSION_OFFSET 8
+#define V2_BYTE_ORDER_OFFSET 12
+#define V2_Y_SIZE_OFFSET 16
+#define V2_X_SIZE_OFFSET 20
+#define V2_STRIDE_OFFSET 24
+#define V2_TYPE_OFFSET 28
+#define V2_GRID_OFFSET_OFFSET 32
+#define V2_AXES_OFFSET 40
+#define V3_SCALE_OFFSET 40
+#define V3_OFFSET_OFFSET 48
+#define V3_NODATA_OFFSET 56
+#define V3_AXES_OFFSET 64
+
+#define TYPE_NAME_F64 "f64"
+#define TYPE_NAME_F32 "f32"
+#define TYPE_NAME_I16 "i16"
+#define TYPE_NAME_U8 "u8"
+
+// Version 1 header, y_size and x_size
+#define V1_AXES_OFFSET (2 * sizeof(int))
+
+size_t grid_file_sample_size(grid_sample_type_t type)
+{
+    switch (type)
+    {
+    case GRID_SAMPLE_F32:
+        return sizeof(float);
+    case GRID_SAMPLE_I16:
+        return sizeof(int16_t);
+    case GRID_SAMPLE_U8:
+        return sizeof(uint8_t);
+    default:
+        return sizeof(double);
+    }
+}
+
+int grid_file_parse_type(const char *name, grid_sample_type_t *type)
+{
+    if (strcmp(name, TYPE_NAME_F64) == 0)
+        *type = GRID_SAMPLE_F64;
+    else if (strcmp(name, TYPE_NAME_F32) == 0)
+        *type = GRID_SAMPLE_F32;
+    else if (strcmp(name, TYPE_NAME_I16) == 0)
+        *type = GRID_SAMPLE_I16;
+    else if (strcmp(name, TYPE_NAME_U8) == 0)
+        *type = GRID_SAMPLE_U8;
+    else
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+// Check that the layout of a grid file fits its size and fill in gf
+int _grid_file_layout(grid_file_t *gf, const unsigned char *data, size_t size, const char *magic,
+                      grid_sample_type_t default_type)
+{
+    size_t axes_offset;
+    uint64_t grid_offset;
+
+    gf->type = default_type;
+    gf->scale = 1.0;
+    gf->offset = 0.0;
+    gf->nodata = NAN;
+
+    if (size >= V3_AXES_OFFSET && memcmp(data, magic, GRID_FILE_MAGIC_SIZE) == 0)
+    {
+        uint32_t version, byte_order, type;
+        memcpy(&version, data + V2_VERSION_OFFSET, sizeof(uint32_t));
+        memcpy(&byte_order, data + V2_BYTE_ORDER_OFFSET, sizeof(uint32_t));
+        if ((version != GRID_FILE_VERSION_2 && version != GRID_FILE_VERSION_3) || byte_order != GRID_FILE_BYTE_ORDER_MARK)
+        {
+            fprintf(stderr, "_grid_file_layout: version %u, byte order mark %08x\n", version, byte_order);
+            return EXIT_FAILURE;
+        }
+
+        int32_t y_size, x_size, stride;
+        memcpy(&y_size, data + V2_Y_SIZE_OFFSET, sizeof(int32_t));
+        memcpy(&x_size, data + V2_X_SIZE_OFFSET, sizeof(int32_t));
+        memcpy(&stride, data + V2_STRIDE_OFFSET, sizeof(int32_t));
+        memcpy(&type, data + V2_TYPE_OFFSET, sizeof(uint32_t));
+        memcpy(&grid_offset, data + V2_GRID_OFFSET_OFFSET, sizeof(uint64_t));
+        gf->y_size = y_size;
+        gf->x_size = x_size;
+        gf->stride = stride;
+        axes_offset = V2_AXES_OFFSET;
+
+        if (version == GRID_FILE_VERSION_3)
+        {
+            if (type > GRID_SAMPLE_U8)
+            {
+                fprintf(stderr, "_grid_file_layout: sample type %u\n", type);
+                return EXIT_FAILURE;
+            }
+
+            gf->type = type;
+            memcpy(&gf->scale, data + V3_SCALE_OFFSET, sizeof(double));
+            memcpy(&gf->offset, data + V3_OFFSET_OFFSET, sizeof(double));
+            memcpy(&gf->nodata, data + V3_NODATA_OFFSET, sizeof(double));
+            axes_offset = V3_AXES_OFFSET;
+        }
+    }
+    else if (size >= V1_AXES_OFFSET)
+    {
+        memcpy(&gf->y_size, data, sizeof(int));
+        memcpy(&gf->x_size, data + sizeof(int), sizeof(int));
+        gf->stride = gf->x_size;
+        axes_offset = V1_AXES_OFFSET;
+        grid_offset = axes_offset + ((size_t)gf->y_size + gf->x_size) * sizeof(double);
+    }
+    else
+    {
+        fprintf(stderr, "_grid_file_layout: file too short\n");
+        return EXIT_FAILURE;
+    }
+
+    if (gf->y_size < 1 || gf->x_size < 1 || gf->stride < gf->x_size ||
+        axes_offset + ((size_t)gf->y_size + gf->x_size) * sizeof(double) > grid_offset ||
+        grid_offset + (size_t)gf->y_size * gf->stride * grid_file_sample_size(gf->type) > size)
+    {
+        fprintf(stderr, "_grid_file_layout: %d x %d grid does not fit the file\n", gf->y_size, gf->x_size);
+        return EXIT_FAILURE;
+    }
+
+    gf->y = (double *)(data + axes_offset);
+    gf->x = gf->y + gf->y_size;
+    gf->grid = (unsigned char *)data + grid_offset;
+    return EXIT_SUCCESS;
+}
+
+int grid_file_map(grid_file_t *gf, const char *path, const char *magic, grid_sample_type_t default_type)
+{
+    memset(gf, 0, sizeof(grid_file_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "grid_file_map: open(%s)\n", path);
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        fprintf(stderr, "grid_file_map: fstat(%s)\n", path);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    // Shared read-only pages, every process working on the same file uses the page cache copy
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "grid_file_map: mmap(%s)\n", path);
+        return EXIT_FAILURE;
+    }
+
+    if (_grid_file_layout(gf, map, st.st_size, magic, default_type) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "grid_file_map: _grid_file_layout(%s)\n", path);
+        munmap(map, st.st_size);
+        return EXIT_FAILURE;
+    }
+
+    gf->map = map;
+    gf->map_size = st.st_size;
+    return EXIT_SUCCESS;
+}
+
+// Bytes from the start of the file to the grid, read from its first bytes
+int _grid_file_header_size(const unsigned char *head, size_t head_size, const char *magic, uint64_t *header_size)
+{
+    if (head_size >= V3_AXES_OFFSET && memcmp(head, magic, GRID_FILE_MAGIC_SIZE) == 0)
+    {
+        memcpy(header_size, head + V2_GRID_OFFSET_OFFSET, sizeof(uint64_t));
+        return EXIT_SUCCESS;
+    }
+
+    if (head_size >= V1_AXES_OFFSET)
+    {
+        int y_size, x_size;
+        memcpy(&y_size, head, sizeof(int));
+        memcpy(&x_size, head + sizeof(int), sizeof(int));
+        if (y_size >= 1 && x_size >= 1)
+        {
+            *header_size = V1_AXES_OFFSET + ((uint64_t)y_size + x_size) * sizeof(double);
+            return EXIT_SUCCESS;
+        }
+    }
+
+    fprintf(stderr, "_grid_file_header_size: not a grid file\n");
+    return EXIT_FAILURE;
+}
+
+// First tick and number of ticks of an axis around v_min .. v_max, margin more on each side
+void _grid_file_window_range(const double *ticks, int size, double v_min, double v_max, int margin, int *first,
+                             int *count)
+{
+    grid_axis_t axis;
+    grid_axis_init(&axis, ticks, size);
+
+    int low = grid_axis_floor(&axis, ticks, size, v_min) - margin;
+    int high = grid_axis_floor(&axis, ticks, size, v_max) + 1 + margin;
+    if (low < 0)
+        low = 0;
+    if (high > size - 1)
+        high = size - 1;
+
+    *first = low;
+    *count = high - low + 1;
+}
+
+int grid_file_map_window(grid_file_t *gf, const char *path, const char *magic, grid_sample_type_t default_type,
+                         const grid_window_t *window, int margin)
+{
+    if (window == NULL)
+        return grid_file_map(gf, path, magic, default_type);
+
+    memset(gf, 0, sizeof(grid_file_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "grid_file_map_window: open(%s)\n", path);
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    unsigned char head[V3_AXES_OFFSET];
+    ssize_t head_size;
+    uint64_t header_size;
+    if (fstat(fd, &st) != 0 || (head_size = pread(fd, head, sizeof(head), 0)) < 0 ||
+        _grid_file_header_size(head, head_size, magic, &header_size) != EXIT_SUCCESS ||
+        header_size == 0 || header_size > (uint64_t)st.st_size)
+    {
+        fprintf(stderr, "grid_file_map_window: header of %s\n", path);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    // The header with the axes, then the rows of the window
+    void *map = mmap(NULL, header_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "grid_file_map_window: mmap(%s) header\n", path);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    if (_grid_file_layout(gf, map, st.st_size, magic, default_type) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "grid_file_map_window: _grid_file_layout(%s)\n", path);
+        munmap(map, header_size);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    int y_count, x_count;
+    _grid_file_window_range(gf->y, gf->y_size, window->y_min, window->y_max, margin, &gf->y_first, &y_count);
+    _grid_file_window_range(gf->x, gf->x_size, window->x_min, window->x_max, margin, &gf->x_first, &x_count);
+
+    size_t sample_size = grid_file_sample_size(gf->type);
+    size_t row_size = (size_t)gf->stride * sample_size;
+    size_t grid_offset = gf->grid - (unsigned char *)map;
+    size_t start = grid_offset + (size_t)gf->y_first * row_size + (size_t)gf->x_first * sample_size;
+    size_t end = start + (size_t)(y_count - 1) * row_size + (size_t)x_count * sample_size;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t map_start = start / page_size * page_size;
+
+    void *rows_map = mmap(NULL, end - map_start, PROT_READ, MAP_SHARED, fd, map_start);
+    close(fd);
+    if (rows_map == MAP_FAILED)
+    {
+        fprintf(stderr, "grid_file_map_window: mmap(%s) rows\n", path);
+        munmap(map, header_size);
+        return EXIT_FAILURE;
+    }
+
+    gf->map = map;
+    gf->map_size = header_size;
+    gf->rows_map = rows_map;
+    gf->rows_map_size = end - map_start;
+    gf->y += gf->y_first;
+    gf->x += gf->x_first;
+    gf->y_size = y_count;
+    gf->x_size = x_count;
+    gf->grid = (unsigned char *)rows_map + (start - map_start);
+    return EXIT_SUCCESS;
+}
+
+int grid_file_write(const char *path, const char *magic, const grid_file_t *gf, const void *grid, int stride)
+{
+    int y_size = gf->y_size;
+    int x_size = gf->x_size;
+    size_t sample_size = grid_file_sample_size(gf->type);
+
+    // Rows padded to whole cache lines
+    size_t row_size = (x_size * sample_size + GRID_FILE_ROW_ALIGNMENT - 1) / GRID_FILE_ROW_ALIGNMENT * GRID_FILE_ROW_ALIGNMENT;
+    int32_t file_stride = row_size / sample_size;
+
+    size_t axes_end = V3_AXES_OFFSET + ((size_t)y_size + x_size) * sizeof(double);
+    uint64_t grid_offset = (axes_end + GRID_FILE_PAGE_SIZE - 1) / GRID_FILE_PAGE_SIZE * GRID_FILE_PAGE_SIZE;
+
+    unsigned char *header = calloc(grid_offset, 1);
+    unsigned char *row = calloc(row_size, 1);
+    if (header == NULL || row == NULL)
+    {
+        fprintf(stderr, "grid_file_write: calloc()\n");
+        free(header);
+        free(row);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t version = GRID_FILE_VERSION_3;
+    uint32_t byte_order = GRID_FILE_BYTE_ORDER_MARK;
+    uint32_t type = gf->type;
+    int32_t file_y_size = y_size;
+    int32_t file_x_size = x_size;
+    memcpy(header, magic, GRID_FILE_MAGIC_SIZE);
+    memcpy(header + V2_VERSION_OFFSET, &version, sizeof(uint32_t));
+    memcpy(header + V2_BYTE_ORDER_OFFSET, &byte_order, sizeof(uint32_t));
+    memcpy(header + V2_Y_SIZE_OFFSET, &file_y_size, sizeof(int32_t));
+    memcpy(header + V2_X_SIZE_OFFSET, &file_x_size, sizeof(int32_t));
+    memcpy(header + V2_STRIDE_OFFSET, &file_stride, sizeof(int32_t));
+    memcpy(header + V2_TYPE_OFFSET, &type, sizeof(uint32_t));
+    memcpy(header + V2_GRID_OFFSET_OFFSET, &grid_offset, sizeof(uint64_t));
+    memcpy(header + V3_SCALE_OFFSET, &gf->scale, sizeof(double));
+    memcpy(header + V3_OFFSET_OFFSET, &gf->offset, sizeof(double));
+    memcpy(header + V3_NODATA_OFFSET, &gf->nodata, sizeof(double));
+    memcpy(header + V3_AXES_OFFSET, gf->y, y_size * sizeof(double));
+    memcpy(header + V3_AXES_OFFSET + y_size * sizeof(double), gf->x, x_size * sizeof(double));
+
+    FILE *fp = fopen(path, WRITE_BINARY);
+    if (fp == NULL)
+    {
+        fprintf(stderr, "grid_file_write: fopen(%s)\n", path);
+        free(header);
+        free(row);
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    if (fwrite(header, grid_offset, 1, fp) != 1)
+    {
+        fprintf(stderr, "grid_file_write: fwrite() header\n");
+        status = EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < y_size && status == EXIT_SUCCESS; i++)
+    {
+        memcpy(row, (const unsigned char *)grid + (size_t)i * stride * sample_size, x_size * sample_size);
+        if (fwrite(row, row_size, 1, fp) != 1)
+        {
+            fprintf(stderr, "grid_file_write: fwrite() row %d\n", i);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(header);
+    free(row);
+
+    if (fclose(fp) && status == EXIT_SUCCESS)
+    {
+        fprintf(stderr, "grid_file_write: fclose()\n");
+        status = EXIT_FAILURE;
+    }
+
+    return status;
+}
+
+void grid_file_advise(const grid_file_t *gf)
+{
+    if (gf->rows_map != NULL)
+        madvise(gf->rows_map, gf->rows_map_size, MADV_WILLNEED);
+    else if (gf->map != NULL)
+        madvise(gf->map, gf->map_size, MADV_WILLNEED);
+}
+
+void grid_file_unmap(grid_file_t *gf)
+{
+    if (gf->map != NULL)
+        munmap(gf->map, gf->map_size);
+    if (gf->rows_map != NULL)
+        munmap(gf->rows_map, gf->rows_map_size);
+    memset(gf, 0, sizeof(grid_file_t));
+}
@@ -0,0 +1,162 @@
+#ifndef GRID_FILE_H
+#define GRID_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Terrain (.tf) and clutter (.cf) grids on disk, in native byte order.
+ *
+ * Version 1:
+ *
+ *   int y_size, x_size; double y[y_size], x[x_size];
+ *   then y_size rows of x_size samples
+ *
+ * Version 3, with the grid page-aligned and its rows cache-line aligned, so that a
+ * mapping of the file can be used in place:
+ *
+ *   offset  type      field
+ *        0  char[8]   magic, GRID_FILE_MAGIC_TERRAIN or GRID_FILE_MAGIC_CLUTTER
+ *        8  uint32    version, 3
+ *       12  uint32    byte order mark, GRID_FILE_BYTE_ORDER_MARK as written by the producer
+ *       16  int32     y_size
+ *       20  int32     x_size
+ *       24  int32     stride, samples from the start of one row to the next
+ *       28  uint32    sample type, grid_sample_type_t
+ *       32  uint64    grid offset, a multiple of GRID_FILE_PAGE_SIZE
+ *       40  double    scale, offset: value = offset + sample * scale for GRID_SAMPLE_I16
+ *       56  double    nodata, the sample standing for a missing value
+ *       64  double    y[y_size], x[x_size]
+ *           zero padding up to the grid offset
+ *
+ *   then y_size rows of stride samples, the first x_size of them used
+ *
+ * Version 2 is version 3 without scale, offset and nodata, y starting at offset 40,
+ * and sample type 0 for the default type of the file kind.
+ */
+
+typedef enum
+{
+    GRID_SAMPLE_F64, // doubles
+    GRID_SAMPLE_F32, // floats
+    GRID_SAMPLE_I16, // offset + sample * scale
+    GRID_SAMPLE_U8,  // bytes
+} grid_sample_type_t;
+
+#define GRID_FILE_MAGIC_TERRAIN "C1812TF"
+#define GRID_FILE_MAGIC_CLUTTER "C1812CF"
+#define GRID_FILE_MAGIC_SIZE 8
+#define GRID_FILE_VERSION_2 2
+#define GRID_FILE_VERSION_3 3
+#define GRID_FILE_I16_NODATA INT16_MIN
+#define GRID_FILE_BYTE_ORDER_MARK 0x01020304
+#define GRID_FILE_PAGE_SIZE 4096
+#define GRID_FILE_ROW_ALIGNMENT 64
+
+// Area of interest of a grid, in axis coordinates
+typedef struct
+{
+    double x_min, x_max;
+    double y_min, y_max;
+} grid_window_t;
+
+// A grid file mapped into memory, the axes and the grid point into the mapping
+typedef struct
+{
+    void *map; // NULL when nothing is mapped
+    size_t map_size;
+    void *rows_map; // rows of a window mapped apart from the header in map, NULL when map holds the whole file
+    size_t rows_map_size;
+    int y_first; // row of the file at row 0 of the grid
+    int x_first; // column of the file at column 0 of the grid
+
+    int y_size; // rows
+    int x_size; // columns
+    int stride; // samples from the start of one row to the next
+    double *y;  // y axis ticks
+    double *x;  // x axis ticks
+    grid_sample_type_t type;
+    double scale;  // value step between GRID_SAMPLE_I16 samples
+    double offset; // value of GRID_SAMPLE_I16 sample 0
+    double nodata; // sample standing for a missing value
+    unsigned char *grid;
+} grid_file_t;
+
+/**
+ * @brief Map a grid file of any version read-only.
+ *
+ * @param gf Pointer to the grid file structure.
+ * @param path Path to the grid file.
+ * @param magic Magic of a version 2 or 3 file of the expected kind.
+ * @param default_type Sample type of version 1 and 2 files.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int grid_file_map(grid_file_t *gf, const char *path, const char *magic, grid_sample_type_t default_type);
+
+/**
+ * @brief Map the part of a grid file of any version around an area of interest read-only.
+ *
+ * Only the header and the rows of the window are mapped; sizes, axes and grid describe the
+ * window, with the stride of the file, so coordinates keep their meaning. The window holds
+ * the ticks around the area and margin more on every side, as far as the grid reaches.
+ *
+ * @param gf Pointer to the grid file structure.
+ * @param path Path to the grid file.
+ * @param magic Magic of a version 2 or 3 file of the expected kind.
+ * @param default_type Sample type of version 1 and 2 files.
+ * @param window Area of interest, NULL for the whole grid.
+ * @param margin Ticks kept beyond the area on every side.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int grid_file_map_window(grid_file_t *gf, const char *path, const char *magic, grid_sample_type_t default_type,
+                         const grid_window_t *window, int margin);
+
+/**
+ * @brief Ask for the mapped samples of a grid file to be read ahead of their use.
+ *
+ * @param gf Pointer to the grid file structure.
+ */
+void grid_file_advise(const grid_file_t *gf);
+
+/**
+ * @brief Write a version 3 grid file.
+ *
+ * @param path Path to the grid file.
+ * @param magic Magic of the file kind.
+ * @param gf Sizes, axes, sample type, scale, offset and nodata of the grid.
+ * @param grid Samples of gf->type, row after row.
+ * @param stride Samples from the start of one row of grid to the next.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int grid_file_write(const char *path, const char *magic, const grid_file_t *gf, const void *grid, int stride);
+
+/**
+ * @brief Size of one sample of the given type.
+ *
+ * @param type Sample type.
+ *
+ * @return Size in bytes.
+ */
+size_t grid_file_sample_size(grid_sample_type_t type);
+
+/**
+ * @brief Parse a sample type name: f64, f32, i16 or u8.
+ *
+ * @param name Type name.
+ * @param type Set to the parsed type.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE for an unknown name.
+ */
+int grid_file_parse_type(const char *name, grid_sample_type_t *type);
+
+/**
+ * @brief Unmap a grid file mapped by grid_file_map() or grid_file_map_window(), if any.
+ *
+ * @param gf Pointer to the grid file structure.
+ */
+void grid_file_unmap(grid_file_t *gf);
+
+#endif
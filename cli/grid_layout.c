@@ -0,0 +1,50 @@
+#include "grid_layout.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LAYOUT_NAME_ROWS "rows"
+#define LAYOUT_NAME_TILES "tiles"
+
+int grid_layout_tile(const void *rows, int y_size, int x_size, int stride, size_t sample_size, void **tiles,
+                     int *tiles_x)
+{
+    int tx_count = (x_size + GRID_TILE - 1) / GRID_TILE;
+    int ty_count = (y_size + GRID_TILE - 1) / GRID_TILE;
+
+    unsigned char *tiled = calloc((size_t)tx_count * ty_count * GRID_TILE * GRID_TILE, sample_size);
+    if (tiled == NULL)
+    {
+        fprintf(stderr, "grid_layout_tile: calloc() tiles\n");
+        return EXIT_FAILURE;
+    }
+
+    // One run of up to GRID_TILE samples per tile row
+    const unsigned char *source = rows;
+    for (int yi = 0; yi < y_size; yi++)
+    {
+        for (int xi = 0; xi < x_size; xi += GRID_TILE)
+        {
+            int run = (x_size - xi < GRID_TILE) ? x_size - xi : GRID_TILE;
+            memcpy(tiled + grid_layout_index(GRID_LAYOUT_TILES, 0, tx_count, yi, xi) * sample_size,
+                   source + ((size_t)yi * stride + xi) * sample_size, run * sample_size);
+        }
+    }
+
+    *tiles = tiled;
+    *tiles_x = tx_count;
+    return EXIT_SUCCESS;
+}
+
+int grid_layout_parse(const char *name, grid_layout_t *layout)
+{
+    if (strcmp(name, LAYOUT_NAME_ROWS) == 0)
+        *layout = GRID_LAYOUT_ROWS;
+    else if (strcmp(name, LAYOUT_NAME_TILES) == 0)
+        *layout = GRID_LAYOUT_TILES;
+    else
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
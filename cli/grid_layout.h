@@ -0,0 +1,107 @@
+#ifndef GRID_LAYOUT_H
+#define GRID_LAYOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Samples along each side of a tile, 1 << GRID_TILE_SHIFT
+#define GRID_TILE_SHIFT 5
+#define GRID_TILE (1 << GRID_TILE_SHIFT)
+
+/*
+ * Order of the samples of a grid in memory. Rows keep the file layout; tiles store
+ * GRID_TILE x GRID_TILE blocks one after another, each block row by row, so that a
+ * ray in any direction touches about as many cache lines and pages as an east-west one
+ */
+typedef enum
+{
+    GRID_LAYOUT_ROWS,  // row y starting at sample y * stride
+    GRID_LAYOUT_TILES, // tile (y / GRID_TILE, x / GRID_TILE) after the tiles before it, tiles_x tiles per tile row
+} grid_layout_t;
+
+/**
+ * @brief Index of the sample at row yi, column xi.
+ *
+ * @param layout Layout of the grid.
+ * @param stride Samples from one row to the next, GRID_LAYOUT_ROWS only.
+ * @param tiles_x Tiles along x, GRID_LAYOUT_TILES only.
+ * @param yi Row.
+ * @param xi Column.
+ *
+ * @return Sample index.
+ */
+static inline size_t grid_layout_index(grid_layout_t layout, int stride, int tiles_x, int yi, int xi)
+{
+    if (layout == GRID_LAYOUT_TILES)
+    {
+        size_t tile = (size_t)(yi >> GRID_TILE_SHIFT) * tiles_x + (xi >> GRID_TILE_SHIFT);
+        return (tile << (2 * GRID_TILE_SHIFT)) + ((yi & (GRID_TILE - 1)) << GRID_TILE_SHIFT) + (xi & (GRID_TILE - 1));
+    }
+
+    return (size_t)yi * stride + xi;
+}
+
+/**
+ * @brief Locate a square block of samples that can be addressed with a fixed row pitch.
+ *
+ * Sample (yi + r, xi + c) of the block is at index + r * pitch + c. In GRID_LAYOUT_TILES
+ * that holds only for blocks within one tile.
+ *
+ * @param layout Layout of the grid.
+ * @param stride Samples from one row to the next, GRID_LAYOUT_ROWS only.
+ * @param tiles_x Tiles along x, GRID_LAYOUT_TILES only.
+ * @param yi First row of the block.
+ * @param xi First column of the block.
+ * @param size Rows and columns of the block.
+ * @param index Set to the index of the first sample of the block.
+ * @param pitch Set to the samples from one row of the block to the next.
+ *
+ * @return true if the block can be addressed so, false if it straddles tiles.
+ */
+static inline bool grid_layout_block(grid_layout_t layout, int stride, int tiles_x, int yi, int xi, int size,
+                                     size_t *index, int *pitch)
+{
+    if (layout == GRID_LAYOUT_TILES)
+    {
+        if ((yi & (GRID_TILE - 1)) > GRID_TILE - size || (xi & (GRID_TILE - 1)) > GRID_TILE - size)
+            return false;
+        *pitch = GRID_TILE;
+    }
+    else
+    {
+        *pitch = stride;
+    }
+
+    *index = grid_layout_index(layout, stride, tiles_x, yi, xi);
+    return true;
+}
+
+/**
+ * @brief Copy a grid stored row by row into GRID_LAYOUT_TILES.
+ *
+ * Samples of the partial tiles along the far edges that lie outside the grid are zero.
+ *
+ * @param rows First sample of row 0.
+ * @param y_size Rows.
+ * @param x_size Columns.
+ * @param stride Samples from the start of one row to the next.
+ * @param sample_size Size of one sample in bytes.
+ * @param tiles Set to the allocated tiled copy, to be freed by the caller.
+ * @param tiles_x Set to the number of tiles along x.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int grid_layout_tile(const void *rows, int y_size, int x_size, int stride, size_t sample_size, void **tiles,
+                     int *tiles_x);
+
+/**
+ * @brief Parse a layout name: rows or tiles.
+ *
+ * @param name Layout name.
+ * @param layout Set to the parsed layout.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE for an unknown name.
+ */
+int grid_layout_parse(const char *name, grid_layout_t *layout);
+
+#endif
@@ -0,0 +1,530 @@
+#include "grid_mosaic.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "c1812/custom_math.h"
+
+#define READ "r"
+#define MAX_PATH_LENGTH 4096
+#define COMMENT_CHAR '#'
+#define PATH_SEPARATOR '/'
+
+// Bins along each axis of the spatial index, at most about
+#define MAX_BINS 1024
+
+// Distance between a tick of one tile and the same tick of another, at most [tick spacings]
+#define TICK_TOLERANCE 1e-3
+
+int _grid_mosaic_add(char ***paths, int *count, char *path)
+{
+    if (path == NULL)
+    {
+        fprintf(stderr, "_grid_mosaic_add: no path\n");
+        return EXIT_FAILURE;
+    }
+
+    char **grown = realloc(*paths, (*count + 1) * sizeof(char *));
+    if (grown == NULL)
+    {
+        fprintf(stderr, "_grid_mosaic_add: realloc()\n");
+        free(path);
+        return EXIT_FAILURE;
+    }
+
+    grown[*count] = path;
+    *paths = grown;
+    (*count)++;
+    return EXIT_SUCCESS;
+}
+
+// directory/name, allocated
+char *_grid_mosaic_join(const char *directory, size_t directory_length, const char *name)
+{
+    char *path = malloc(directory_length + 1 + strlen(name) + 1);
+    if (path == NULL)
+        return NULL;
+
+    memcpy(path, directory, directory_length);
+    path[directory_length] = PATH_SEPARATOR;
+    strcpy(path + directory_length + 1, name);
+    return path;
+}
+
+bool _grid_mosaic_ends_with(const char *s, const char *suffix)
+{
+    size_t len = strlen(s), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(s + len - suffix_len, suffix) == 0;
+}
+
+int _grid_mosaic_list_directory(const char *path, const char *extension, char ***paths, int *count)
+{
+    struct dirent **entries;
+    int entry_count = scandir(path, &entries, NULL, alphasort);
+    if (entry_count < 0)
+    {
+        fprintf(stderr, "_grid_mosaic_list_directory: scandir(%s)\n", path);
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < entry_count; i++)
+    {
+        if (status == EXIT_SUCCESS && _grid_mosaic_ends_with(entries[i]->d_name, extension))
+        {
+            struct stat st;
+            char *tile_path = _grid_mosaic_join(path, strlen(path), entries[i]->d_name);
+            if (tile_path != NULL && stat(tile_path, &st) == 0 && !S_ISREG(st.st_mode))
+                free(tile_path);
+            else
+                status = _grid_mosaic_add(paths, count, tile_path);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+
+    return status;
+}
+
+int _grid_mosaic_list_manifest(const char *path, char ***paths, int *count)
+{
+    FILE *fp = fopen(path, READ);
+    if (fp == NULL)
+    {
+        fprintf(stderr, "_grid_mosaic_list_manifest: fopen(%s)\n", path);
+        return EXIT_FAILURE;
+    }
+
+    // Relative paths start at the manifest's directory
+    const char *slash = strrchr(path, PATH_SEPARATOR);
+    size_t directory_length = (slash != NULL) ? (size_t)(slash - path) : 0;
+
+    char line[MAX_PATH_LENGTH];
+    int status = EXIT_SUCCESS;
+    while (status == EXIT_SUCCESS && fgets(line, sizeof(line), fp) != NULL)
+    {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t'))
+            line[--len] = '\0';
+        if (len == 0 || line[0] == COMMENT_CHAR)
+            continue;
+
+        char *tile_path;
+        if (line[0] == PATH_SEPARATOR || slash == NULL)
+            tile_path = strdup(line);
+        else
+            tile_path = _grid_mosaic_join(path, directory_length, line);
+        status = _grid_mosaic_add(paths, count, tile_path);
+    }
+
+    fclose(fp);
+    return status;
+}
+
+bool grid_mosaic_is_list(const char *path)
+{
+    struct stat st;
+    return _grid_mosaic_ends_with(path, GRID_MOSAIC_MANIFEST_EXT) || (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+int grid_mosaic_list(const char *path, const char *extension, char ***paths, int *count)
+{
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+        return _grid_mosaic_list_directory(path, extension, paths, count);
+
+    if (_grid_mosaic_ends_with(path, GRID_MOSAIC_MANIFEST_EXT))
+        return _grid_mosaic_list_manifest(path, paths, count);
+
+    return _grid_mosaic_add(paths, count, strdup(path));
+}
+
+// Read the extent of a tile from its header
+int _grid_mosaic_extent(const grid_mosaic_kind_t *kind, grid_mosaic_tile_t *tile)
+{
+    grid_file_t gf;
+    if (grid_file_map(&gf, tile->path, kind->magic, kind->default_type) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "_grid_mosaic_extent: grid_file_map(%s)\n", tile->path);
+        return EXIT_FAILURE;
+    }
+
+    int low_x = (kind->margin < gf.x_size) ? kind->margin : gf.x_size - 1;
+    int low_y = (kind->margin < gf.y_size) ? kind->margin : gf.y_size - 1;
+    tile->x_min = gf.x[0];
+    tile->x_max = gf.x[gf.x_size - 1];
+    tile->y_min = gf.y[0];
+    tile->y_max = gf.y[gf.y_size - 1];
+    tile->x_low = gf.x[low_x];
+    tile->x_high = gf.x[gf.x_size - 1 - low_x];
+    tile->y_low = gf.y[low_y];
+    tile->y_high = gf.y[gf.y_size - 1 - low_y];
+    tile->x_step = (gf.x_size > 1) ? (tile->x_max - tile->x_min) / (gf.x_size - 1) : 0.0;
+    tile->y_step = (gf.y_size > 1) ? (tile->y_max - tile->y_min) / (gf.y_size - 1) : 0.0;
+
+    grid_file_unmap(&gf);
+    return EXIT_SUCCESS;
+}
+
+// Bin of coordinate v, clamped to the bins
+int _grid_mosaic_bin(double v, double origin, double size, int bins)
+{
+    int b = (int)c_floor((v - origin) / size);
+    return (b < 0) ? 0 : (b >= bins) ? bins - 1 : b;
+}
+
+int _grid_mosaic_index(grid_mosaic_t *m)
+{
+    double x_min = m->tiles[0].x_min, x_max = m->tiles[0].x_max;
+    double y_min = m->tiles[0].y_min, y_max = m->tiles[0].y_max;
+    double width = 0.0, height = 0.0;
+    m->min_side = INFINITY;
+    for (int t = 0; t < m->tile_count; t++)
+    {
+        const grid_mosaic_tile_t *tile = &m->tiles[t];
+        x_min = c_min(x_min, tile->x_min);
+        x_max = c_max(x_max, tile->x_max);
+        y_min = c_min(y_min, tile->y_min);
+        y_max = c_max(y_max, tile->y_max);
+        width += tile->x_max - tile->x_min;
+        height += tile->y_max - tile->y_min;
+        m->min_side = c_min(m->min_side, c_min(tile->x_max - tile->x_min, tile->y_max - tile->y_min));
+    }
+
+    // Bins the size of an average tile, so that a point's bin lists few tiles
+    m->x_origin = x_min;
+    m->y_origin = y_min;
+    m->bin_width = c_max(width / m->tile_count, (x_max - x_min) / MAX_BINS);
+    m->bin_height = c_max(height / m->tile_count, (y_max - y_min) / MAX_BINS);
+    if (!(m->bin_width > 0))
+        m->bin_width = 1.0;
+    if (!(m->bin_height > 0))
+        m->bin_height = 1.0;
+    m->bins_x = (int)c_floor((x_max - x_min) / m->bin_width) + 1;
+    m->bins_y = (int)c_floor((y_max - y_min) / m->bin_height) + 1;
+
+    int bins = m->bins_x * m->bins_y;
+    m->bin_start = calloc(bins + 1, sizeof(int));
+    if (m->bin_start == NULL)
+    {
+        fprintf(stderr, "_grid_mosaic_index: calloc() bin_start\n");
+        return EXIT_FAILURE;
+    }
+
+    // Count the tiles of every bin, then list them in tile order
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int *fill = NULL;
+        if (pass == 1)
+        {
+            for (int b = 0; b < bins; b++)
+                m->bin_start[b + 1] += m->bin_start[b];
+
+            m->bin_tiles = malloc(m->bin_start[bins] * sizeof(int));
+            fill = malloc(bins * sizeof(int));
+            if (m->bin_tiles == NULL || fill == NULL)
+            {
+                fprintf(stderr, "_grid_mosaic_index: malloc() bin_tiles\n");
+                free(fill);
+                return EXIT_FAILURE;
+            }
+            memcpy(fill, m->bin_start, bins * sizeof(int));
+        }
+
+        for (int t = 0; t < m->tile_count; t++)
+        {
+            const grid_mosaic_tile_t *tile = &m->tiles[t];
+            // A tick past the edges, for the points between abutting tiles
+            int bx1 = _grid_mosaic_bin(tile->x_min - tile->x_step, m->x_origin, m->bin_width, m->bins_x);
+            int bx2 = _grid_mosaic_bin(tile->x_max + tile->x_step, m->x_origin, m->bin_width, m->bins_x);
+            int by1 = _grid_mosaic_bin(tile->y_min - tile->y_step, m->y_origin, m->bin_height, m->bins_y);
+            int by2 = _grid_mosaic_bin(tile->y_max + tile->y_step, m->y_origin, m->bin_height, m->bins_y);
+            for (int by = by1; by <= by2; by++)
+            {
+                for (int bx = bx1; bx <= bx2; bx++)
+                {
+                    if (pass == 0)
+                        m->bin_start[by * m->bins_x + bx + 1]++;
+                    else
+                        m->bin_tiles[fill[by * m->bins_x + bx]++] = t;
+                }
+            }
+        }
+
+        free(fill);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int grid_mosaic_create(grid_mosaic_t *m, const grid_mosaic_kind_t *kind, char **paths, int count, int capacity)
+{
+    memset(m, 0, sizeof(grid_mosaic_t));
+    m->kind = kind;
+    m->capacity = (capacity > 0) ? capacity : 1;
+
+    if (count < 1)
+    {
+        fprintf(stderr, "grid_mosaic_create: no tiles\n");
+        return EXIT_FAILURE;
+    }
+
+    m->tiles = calloc(count, sizeof(grid_mosaic_tile_t));
+    if (m->tiles == NULL)
+    {
+        fprintf(stderr, "grid_mosaic_create: calloc() tiles\n");
+        return EXIT_FAILURE;
+    }
+    m->tile_count = count;
+
+    pthread_mutex_init(&m->mutex, NULL);
+    pthread_cond_init(&m->loaded_cond, NULL);
+
+    for (int t = 0; t < count; t++)
+    {
+        m->tiles[t].path = strdup(paths[t]);
+        if (m->tiles[t].path == NULL || _grid_mosaic_extent(kind, &m->tiles[t]) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "grid_mosaic_create: tile %s\n", paths[t]);
+            grid_mosaic_free(m);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (_grid_mosaic_index(m) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "grid_mosaic_create: _grid_mosaic_index()\n");
+        grid_mosaic_free(m);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int grid_mosaic_find(const grid_mosaic_t *m, const double x, const double y)
+{
+    int bx = (int)c_floor((x - m->x_origin) / m->bin_width);
+    int by = (int)c_floor((y - m->y_origin) / m->bin_height);
+    if (!(bx >= 0 && bx < m->bins_x && by >= 0 && by < m->bins_y))
+        return -1;
+
+    int b = by * m->bins_x + bx;
+    int holding = -1;
+    for (int k = m->bin_start[b]; k < m->bin_start[b + 1]; k++)
+    {
+        int t = m->bin_tiles[k];
+        if (grid_mosaic_inside(m, t, x, y))
+            return t;
+
+        const grid_mosaic_tile_t *tile = &m->tiles[t];
+        if (holding < 0 && x >= tile->x_min && x <= tile->x_max && y >= tile->y_min && y <= tile->y_max)
+            holding = t;
+    }
+
+    return holding;
+}
+
+// First tile holding x, y within reach tick spacings of its edges, -1 when there is none
+int _grid_mosaic_find_near(const grid_mosaic_t *m, const double x, const double y, double reach)
+{
+    int bx = _grid_mosaic_bin(x, m->x_origin, m->bin_width, m->bins_x);
+    int by = _grid_mosaic_bin(y, m->y_origin, m->bin_height, m->bins_y);
+
+    int b = by * m->bins_x + bx;
+    for (int k = m->bin_start[b]; k < m->bin_start[b + 1]; k++)
+    {
+        int t = m->bin_tiles[k];
+        const grid_mosaic_tile_t *tile = &m->tiles[t];
+        if (x >= tile->x_min - reach * tile->x_step && x <= tile->x_max + reach * tile->x_step &&
+            y >= tile->y_min - reach * tile->y_step && y <= tile->y_max + reach * tile->y_step)
+            return t;
+    }
+
+    return -1;
+}
+
+int grid_mosaic_gather(grid_mosaic_t *m, const double x, const double y, int before, int count, double *xs, double *ys,
+                       double *values)
+{
+    int reference = _grid_mosaic_find_near(m, x, y, 0.5);
+    if (reference < 0 || !(m->tiles[reference].x_step > 0 && m->tiles[reference].y_step > 0))
+        return EXIT_FAILURE;
+
+    // Ticks of the reference tile, continued past its edges
+    const grid_mosaic_tile_t *r = &m->tiles[reference];
+    int xi = (int)c_floor((x - r->x_min) / r->x_step) - before;
+    int yi = (int)c_floor((y - r->y_min) / r->y_step) - before;
+    for (int k = 0; k < count; k++)
+    {
+        xs[k] = r->x_min + (xi + k) * r->x_step;
+        ys[k] = r->y_min + (yi + k) * r->y_step;
+    }
+
+    // Consecutive ticks mostly come from the same tile, which stays acquired until they do not
+    int held = -1;
+    void *grid = NULL;
+    for (int row = 0; row < count; row++)
+    {
+        for (int column = 0; column < count; column++)
+        {
+            double value = NAN;
+            int tile = _grid_mosaic_find_near(m, xs[column], ys[row], TICK_TOLERANCE);
+            if (tile >= 0 && tile != held)
+            {
+                if (held >= 0)
+                    grid_mosaic_release(m, held);
+                grid = grid_mosaic_acquire(m, tile);
+                held = (grid != NULL) ? tile : -1;
+            }
+            if (tile >= 0 && tile == held)
+                value = m->kind->sample(grid, xs[column], ys[row], TICK_TOLERANCE * m->tiles[tile].x_step,
+                                        TICK_TOLERANCE * m->tiles[tile].y_step);
+            values[row * count + column] = value;
+        }
+    }
+    if (held >= 0)
+        grid_mosaic_release(m, held);
+
+    return EXIT_SUCCESS;
+}
+
+// Close least recently used tiles nobody samples until another one fits, mutex held
+void _grid_mosaic_evict(grid_mosaic_t *m)
+{
+    while (m->open_count >= m->capacity)
+    {
+        int lru = -1;
+        for (int t = 0; t < m->tile_count; t++)
+        {
+            const grid_mosaic_tile_t *tile = &m->tiles[t];
+            if (tile->grid != NULL && tile->users == 0 && (lru < 0 || tile->last_used < m->tiles[lru].last_used))
+                lru = t;
+        }
+
+        // Every open tile is in use, the cache grows past its capacity for a while
+        if (lru < 0)
+            return;
+
+        m->kind->free(m->tiles[lru].grid);
+        free(m->tiles[lru].grid);
+        m->tiles[lru].grid = NULL;
+        m->open_count--;
+    }
+}
+
+// grid_mosaic_acquire(), opened set to whether this call opened the tile
+void *_grid_mosaic_acquire(grid_mosaic_t *m, int tile, bool *opened)
+{
+    grid_mosaic_tile_t *t = &m->tiles[tile];
+    *opened = false;
+
+    pthread_mutex_lock(&m->mutex);
+    while (t->loading)
+        pthread_cond_wait(&m->loaded_cond, &m->mutex);
+
+    if (t->grid != NULL)
+    {
+        t->users++;
+        t->last_used = ++m->clock;
+        m->hits++;
+        pthread_mutex_unlock(&m->mutex);
+        return t->grid;
+    }
+
+    _grid_mosaic_evict(m);
+    t->loading = true;
+    m->open_count++;
+    m->misses++;
+    pthread_mutex_unlock(&m->mutex);
+
+    // Other tiles stay available while this one opens
+    void *grid = malloc(m->kind->size);
+    if (grid != NULL && m->kind->open(grid, t->path) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "grid_mosaic_acquire: open(%s)\n", t->path);
+        free(grid);
+        grid = NULL;
+    }
+
+    pthread_mutex_lock(&m->mutex);
+    t->loading = false;
+    t->grid = grid;
+    if (grid != NULL)
+    {
+        t->users++;
+        t->last_used = ++m->clock;
+        *opened = true;
+    }
+    else
+    {
+        m->open_count--;
+    }
+    pthread_cond_broadcast(&m->loaded_cond);
+    pthread_mutex_unlock(&m->mutex);
+
+    return grid;
+}
+
+void *grid_mosaic_acquire(grid_mosaic_t *m, int tile)
+{
+    bool opened;
+    return _grid_mosaic_acquire(m, tile, &opened);
+}
+
+void grid_mosaic_release(grid_mosaic_t *m, int tile)
+{
+    pthread_mutex_lock(&m->mutex);
+    m->tiles[tile].users--;
+    pthread_mutex_unlock(&m->mutex);
+}
+
+void grid_mosaic_prefetch_line(grid_mosaic_t *m, const double x1, const double y1, const double x2, const double y2)
+{
+    // Steps of half the shortest tile side cross every tile on the way
+    double length = c_sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+    int steps = (m->min_side > 0) ? (int)c_ceil(length / (m->min_side / 2)) : 1;
+
+    int last = -1;
+    for (int s = 0; s <= steps; s++)
+    {
+        double t = (steps > 0) ? (double)s / steps : 0.0;
+        int tile = grid_mosaic_find(m, x1 + (x2 - x1) * t, y1 + (y2 - y1) * t);
+        if (tile < 0 || tile == last)
+            continue;
+        last = tile;
+
+        bool opened;
+        void *grid = _grid_mosaic_acquire(m, tile, &opened);
+        if (grid == NULL)
+            continue;
+        if (opened)
+            grid_file_advise(m->kind->file(grid));
+        grid_mosaic_release(m, tile);
+    }
+}
+
+void grid_mosaic_free(grid_mosaic_t *m)
+{
+    if (m->tiles != NULL)
+    {
+        for (int t = 0; t < m->tile_count; t++)
+        {
+            if (m->tiles[t].grid != NULL)
+            {
+                m->kind->free(m->tiles[t].grid);
+                free(m->tiles[t].grid);
+            }
+            free(m->tiles[t].path);
+        }
+        free(m->tiles);
+
+        pthread_mutex_destroy(&m->mutex);
+        pthread_cond_destroy(&m->loaded_cond);
+    }
+
+    free(m->bin_start);
+    free(m->bin_tiles);
+    memset(m, 0, sizeof(grid_mosaic_t));
+}
@@ -0,0 +1,204 @@
+#ifndef GRID_MOSAIC_H
+#define GRID_MOSAIC_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "grid_file.h"
+
+// Extension of a manifest listing the tiles of a mosaic, one path per line
+#define GRID_MOSAIC_MANIFEST_EXT ".mosaic"
+
+/*
+ * What a mosaic is made of, terrain or clutter grids, and how to open them
+ */
+typedef struct
+{
+    const char *magic;               // magic of version 2 and 3 tile files
+    grid_sample_type_t default_type; // sample type of version 1 and 2 tile files
+    int margin;                      // ticks a point keeps from the edges of the tile sampled for it
+    size_t size;                     // size of the structure of an opened tile
+    int (*open)(void *grid, const char *path);
+    void (*free)(void *grid);
+    grid_file_t *(*file)(void *grid); // mapping of an opened tile
+    // Sample of an opened tile at its tick within the tolerances of x, y, NAN when it has none there
+    double (*sample)(void *grid, double x, double y, double x_tolerance, double y_tolerance);
+} grid_mosaic_kind_t;
+
+// A tile of a mosaic, opened while it is in the cache
+typedef struct
+{
+    char *path;
+    double x_min, x_max;   // first and last x tick
+    double y_min, y_max;   // first and last y tick
+    double x_low, x_high;  // x ticks margin away from the edges, points in x_low .. x_high are inside
+    double y_low, y_high;  // y ticks margin away from the edges
+    double x_step, y_step; // average tick spacing, continues the axes past the edges
+    void *grid;            // opened tile, NULL when not in the cache
+    bool loading;          // a thread is opening the tile
+    int users;             // threads sampling the tile, which is not evicted while any is
+    unsigned long last_used; // clock of the last acquisition
+} grid_mosaic_tile_t;
+
+/*
+ * Tiles of a grid too large to open at once. A coarse grid of bins indexes the tiles
+ * by their extent; tiles are opened when first sampled and kept in a cache of at most
+ * capacity tiles, the least recently used unused tile making room for the next one.
+ *
+ * A point is sampled from the first listed tile holding it inside its margin. A point
+ * no tile holds inside its margin, near the edges of abutting tiles or tiles sharing an
+ * edge, is interpolated from ticks gathered by grid_mosaic_gather(), each from the first
+ * listed tile that has it
+ */
+typedef struct
+{
+    const grid_mosaic_kind_t *kind;
+    grid_mosaic_tile_t *tiles; // in the order listed, directory name or manifest order
+    int tile_count;
+
+    // Spatial index, bin (by, bx) lists tiles bin_tiles[bin_start[b] .. bin_start[b + 1] - 1]
+    double x_origin, y_origin;
+    double bin_width, bin_height;
+    int bins_x, bins_y;
+    int *bin_start;
+    int *bin_tiles;
+    double min_side; // shortest side of a tile
+
+    pthread_mutex_t mutex;
+    pthread_cond_t loaded_cond; // signalled when a tile finished loading
+    int capacity;               // tiles kept open
+    int open_count;             // tiles open or loading
+    unsigned long clock;
+    unsigned long hits;
+    unsigned long misses;
+} grid_mosaic_t;
+
+/**
+ * @brief Add the tile files a path names: a grid file, a directory of files with the
+ * given extension, in name order, or a manifest.
+ *
+ * Manifest lines name one file each, relative to the manifest's directory; empty lines
+ * and lines starting with # are skipped.
+ *
+ * @param path Tile file, directory or manifest.
+ * @param extension Extension of the tile files in a directory.
+ * @param paths Array of allocated paths, grown by the files of path.
+ * @param count Number of paths, updated.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int grid_mosaic_list(const char *path, const char *extension, char ***paths, int *count);
+
+/**
+ * @brief Whether a path names a directory or a manifest rather than a single grid.
+ *
+ * @param path Path to check.
+ *
+ * @return true for a directory or a path ending in GRID_MOSAIC_MANIFEST_EXT.
+ */
+bool grid_mosaic_is_list(const char *path);
+
+/**
+ * @brief Index the tiles of a mosaic by their extents, without opening them.
+ *
+ * @param m Pointer to the mosaic structure.
+ * @param kind Kind of the tiles.
+ * @param paths Paths to the tile files, copied.
+ * @param count Number of tiles, at least 1.
+ * @param capacity Tiles kept open at most, at least 1.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int grid_mosaic_create(grid_mosaic_t *m, const grid_mosaic_kind_t *kind, char **paths, int count, int capacity);
+
+/**
+ * @brief Tile to sample at x, y.
+ *
+ * The first listed tile holding x, y inside its margin, or failing that the first
+ * listed tile holding it at all. Only a tile holding x, y inside its margin has the
+ * whole neighbourhood of x, y; check with grid_mosaic_inside().
+ *
+ * @param m Pointer to the mosaic structure.
+ * @param x The x coordinate.
+ * @param y The y coordinate.
+ *
+ * @return Tile index, -1 when no tile holds x, y.
+ */
+int grid_mosaic_find(const grid_mosaic_t *m, const double x, const double y);
+
+/**
+ * @brief Samples of the count x count ticks around x, y, taken across tile edges.
+ *
+ * The ticks continue the axes of the first tile holding x, y, or lying within half a
+ * tick of it, at its average spacing. Each one is sampled from the first tile that has
+ * it, so the tiles must share evenly spaced ticks.
+ *
+ * @param m Pointer to the mosaic structure.
+ * @param x The x coordinate.
+ * @param y The y coordinate.
+ * @param before Ticks before the cell holding x, y, which spans xs[before] .. xs[before + 1].
+ * @param count Ticks along each axis.
+ * @param xs Array of count x ticks.
+ * @param ys Array of count y ticks.
+ * @param values Array of count * count samples, row by row, NAN for ticks no tile has.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE when no tile is near x, y.
+ */
+int grid_mosaic_gather(grid_mosaic_t *m, const double x, const double y, int before, int count, double *xs, double *ys,
+                       double *values);
+
+/**
+ * @brief Whether x, y lies inside the margin of a tile.
+ *
+ * @param m Pointer to the mosaic structure.
+ * @param tile Tile index.
+ * @param x The x coordinate.
+ * @param y The y coordinate.
+ *
+ * @return true when inside.
+ */
+static inline bool grid_mosaic_inside(const grid_mosaic_t *m, int tile, const double x, const double y)
+{
+    const grid_mosaic_tile_t *t = &m->tiles[tile];
+    return x >= t->x_low && x < t->x_high && y >= t->y_low && y < t->y_high;
+}
+
+/**
+ * @brief Open a tile if it is not in the cache and keep it there until released.
+ *
+ * Safe to call from any thread.
+ *
+ * @param m Pointer to the mosaic structure.
+ * @param tile Tile index.
+ *
+ * @return The opened tile, NULL if it could not be opened.
+ */
+void *grid_mosaic_acquire(grid_mosaic_t *m, int tile);
+
+/**
+ * @brief Let a tile acquired by grid_mosaic_acquire() be evicted again.
+ *
+ * @param m Pointer to the mosaic structure.
+ * @param tile Tile index.
+ */
+void grid_mosaic_release(grid_mosaic_t *m, int tile);
+
+/**
+ * @brief Open the tiles along a line and ask for their samples to be read ahead.
+ *
+ * @param m Pointer to the mosaic structure.
+ * @param x1 The x coordinate of the start of the line.
+ * @param y1 The y coordinate of the start of the line.
+ * @param x2 The x coordinate of the end of the line.
+ * @param y2 The y coordinate of the end of the line.
+ */
+void grid_mosaic_prefetch_line(grid_mosaic_t *m, const double x1, const double y1, const double x2, const double y2);
+
+/**
+ * @brief Close every tile and free the mosaic.
+ *
+ * @param m Pointer to the mosaic structure, no tile acquired.
+ */
+void grid_mosaic_free(grid_mosaic_t *m);
+
+#endif
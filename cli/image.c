@@ -52,29 +52,29 @@ int image_create(image_t *image, int width, int height)
 
 	for (int i = 0; i < height; i++)
 	{
-		image->rgb_data[R][i] = malloc(width * sizeof(unsigned int));
+		image->rgb_data[R][i] = calloc(width, sizeof(unsigned int));
 		if (image->rgb_data[R][i] == NULL)
 		{
-			fprintf(stderr, "image_create: malloc() image->rgb_data[R][%d]\n", i);
+			fprintf(stderr, "image_create: calloc() image->rgb_data[R][%d]\n", i);
 			_dealloc_channel_up_to_i(image, R, i);
 			_dealloc_channels(image);
 			return EXIT_FAILURE;
 		}
 
-		image->rgb_data[G][i] = malloc(width * sizeof(unsigned int));
+		image->rgb_data[G][i] = calloc(width, sizeof(unsigned int));
 		if (image->rgb_data[G][i] == NULL)
 		{
-			fprintf(stderr, "image_create: malloc() image->rgb_data[G][%d]\n", i);
+			fprintf(stderr, "image_create: calloc() image->rgb_data[G][%d]\n", i);
 			_dealloc_channel_up_to_i(image, R, height);
 			_dealloc_channel_up_to_i(image, G, i);
 			_dealloc_channels(image);
 			return EXIT_FAILURE;
 		}
 
-		image->rgb_data[B][i] = malloc(width * sizeof(unsigned int));
+		image->rgb_data[B][i] = calloc(width, sizeof(unsigned int));
 		if (image->rgb_data[B][i] == NULL)
 		{
-			fprintf(stderr, "image_create: malloc() image->rgb_data[B][%d]\n", i);
+			fprintf(stderr, "image_create: calloc() image->rgb_data[B][%d]\n", i);
 			_dealloc_channel_up_to_i(image, R, height);
 			_dealloc_channel_up_to_i(image, G, height);
 			_dealloc_channel_up_to_i(image, B, i);
@@ -39,7 +39,14 @@
 #define FIELD_ARES "angular_resolution"
 #define FIELD_RADIUS "radius"
 #define FIELD_THREADS "threads"
+#define FIELD_ANGLE_BLOCK "angle_block"
+#define FIELD_THREAD_STATS "thread_stats"
 #define FIELD_OUT "out_rf"
+#define FIELD_OUT_VERSION "out_rf_version"
+#define FIELD_OUT_TERRAIN "out_rf_terrain"
+#define FIELD_OUT_CLUTTER "out_rf_clutter"
+#define FIELD_OUT_COMPRESSION "out_rf_compression"
+#define FIELD_OUT_BLOCK "out_rf_block"
 #define FIELD_IMG "out_img"
 #define FIELD_IMG_SIZE "out_img_size"
 #define FIELD_IMG_COLORMAP "out_img_colormap"
@@ -50,7 +57,16 @@
 #define FIELD_IMG_DATA_TYPE_LOSS "loss"
 #define FIELD_IMG_DATA_TYPE_TERRAIN "terrain"
 #define FIELD_IMG_DATA_TYPE_CLUTTER "clutter"
+#define FIELD_RESULT_TYPE "result_type"
 #define FIELD_TERRAIN "data_terrain"
+#define FIELD_TERRAIN_TYPE "data_terrain_type"
+#define FIELD_TERRAIN_COEFFICIENTS "data_terrain_coefficients"
+#define FIELD_TERRAIN_PYRAMID "data_terrain_pyramid"
+#define FIELD_TERRAIN_PYRAMID_NEAR "data_terrain_pyramid_near"
+#define FIELD_DATA_LAYOUT "data_layout"
+#define FIELD_DATA_WINDOW "data_window"
+#define FIELD_DATA_TILE_CACHE "data_tile_cache"
+#define FIELD_DATA_PREFETCH "data_prefetch"
 #define FIELD_CLUTTER "data_clutter"
 
 int _jobfile_set_field(job_parameters_t *job_parameters, c1812_parameters_t *parameters, char *field, char *value);
@@ -72,16 +88,33 @@ void jobfile_zero(job_parameters_t *job_parameters)
     job_parameters->xres = NAN;
     job_parameters->ares = NAN;
     job_parameters->threads = 1;
+    job_parameters->angle_block = 0;
+    job_parameters->thread_stats = 0;
 
     job_parameters->img_size = 256;
     job_parameters->img_colormap = COLORMAP_JET;
     job_parameters->img_scale_min = 1.0;
     job_parameters->img_scale_max = 9.0;
     job_parameters->img_data_type = IMG_DATA_TYPE_S_UNITS;
+    job_parameters->result_type = RESULT_STORE_F64;
+
+    job_parameters->out_version = 1;
+    job_parameters->out_terrain = 0;
+    job_parameters->out_clutter = 0;
+    job_parameters->out_compression = 0;
+    job_parameters->out_block = 16;
 
     memset(job_parameters->out, 0, sizeof(job_parameters->out));
     memset(job_parameters->img, 0, sizeof(job_parameters->img));
     memset(job_parameters->terrain, 0, sizeof(job_parameters->terrain));
+    job_parameters->terrain_type = GRID_SAMPLE_F64;
+    job_parameters->terrain_coefficients = 0;
+    job_parameters->terrain_pyramid = TF_PYRAMID_NONE;
+    job_parameters->terrain_pyramid_near = 0.0;
+    job_parameters->data_layout = GRID_LAYOUT_ROWS;
+    job_parameters->data_window = 0;
+    job_parameters->data_tile_cache = 64;
+    job_parameters->data_prefetch = 16;
     memset(job_parameters->clutter, 0, sizeof(job_parameters->clutter));
 }
 
@@ -224,6 +257,10 @@ int _jobfile_set_field(job_parameters_t *job_parameters, c1812_parameters_t *par
         job_parameters->ares = atof(value);
     else if (strcmp(field, FIELD_THREADS) == EQUAL)
         job_parameters->threads = atoi(value);
+    else if (strcmp(field, FIELD_ANGLE_BLOCK) == EQUAL)
+        job_parameters->angle_block = atoi(value);
+    else if (strcmp(field, FIELD_THREAD_STATS) == EQUAL)
+        job_parameters->thread_stats = atoi(value);
     else if (strcmp(field, FIELD_OUT) == EQUAL)
     {
         if (strlen(job_parameters->out) > 0)
@@ -233,6 +270,30 @@ int _jobfile_set_field(job_parameters_t *job_parameters, c1812_parameters_t *par
         }
         strncpy(job_parameters->out, value, MAX_VALUE_LENGTH);
     }
+    else if (strcmp(field, FIELD_OUT_VERSION) == EQUAL)
+    {
+        job_parameters->out_version = atoi(value);
+        if (job_parameters->out_version != 1 && job_parameters->out_version != 2)
+        {
+            fprintf(stderr, "_jobfile_set_field: out_rf_version must be either 1 or 2, not %s\n", value);
+            return EXIT_FAILURE;
+        }
+    }
+    else if (strcmp(field, FIELD_OUT_TERRAIN) == EQUAL)
+        job_parameters->out_terrain = atoi(value);
+    else if (strcmp(field, FIELD_OUT_CLUTTER) == EQUAL)
+        job_parameters->out_clutter = atoi(value);
+    else if (strcmp(field, FIELD_OUT_COMPRESSION) == EQUAL)
+        job_parameters->out_compression = atoi(value);
+    else if (strcmp(field, FIELD_OUT_BLOCK) == EQUAL)
+    {
+        job_parameters->out_block = atoi(value);
+        if (job_parameters->out_block < 1)
+        {
+            fprintf(stderr, "_jobfile_set_field: out_rf_block must be positive, not %s\n", value);
+            return EXIT_FAILURE;
+        }
+    }
     else if (strcmp(field, FIELD_IMG) == EQUAL)
     {
         if (strlen(job_parameters->img) > 0)
@@ -268,6 +329,16 @@ int _jobfile_set_field(job_parameters_t *job_parameters, c1812_parameters_t *par
             return EXIT_FAILURE;
         }
     }
+    else if (strcmp(field, FIELD_RESULT_TYPE) == EQUAL)
+    {
+        for (int i = 0; i < strlen(value); i++)
+            value[i] = tolower(value[i]);
+        if (result_store_parse_type(value, &job_parameters->result_type) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "_jobfile_set_field: result_type must be either 'f64', 'f32' or 'u16', not %s\n", value);
+            return EXIT_FAILURE;
+        }
+    }
     else if (strcmp(field, FIELD_TERRAIN) == EQUAL)
     {
         int i = 0;
@@ -280,6 +351,75 @@ int _jobfile_set_field(job_parameters_t *job_parameters, c1812_parameters_t *par
         }
         strncpy(job_parameters->terrain[i], value, MAX_VALUE_LENGTH);
     }
+    else if (strcmp(field, FIELD_TERRAIN_COEFFICIENTS) == EQUAL)
+    {
+        job_parameters->terrain_coefficients = atoi(value);
+        if (job_parameters->terrain_coefficients < 0)
+        {
+            fprintf(stderr, "_jobfile_set_field: data_terrain_coefficients must not be negative\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if (strcmp(field, FIELD_TERRAIN_PYRAMID) == EQUAL)
+    {
+        for (int i = 0; i < strlen(value); i++)
+            value[i] = tolower(value[i]);
+        if (tf_pyramid_parse(value, &job_parameters->terrain_pyramid) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "_jobfile_set_field: data_terrain_pyramid must be either 'none', 'mean' or 'max', not %s\n", value);
+            return EXIT_FAILURE;
+        }
+    }
+    else if (strcmp(field, FIELD_TERRAIN_PYRAMID_NEAR) == EQUAL)
+    {
+        job_parameters->terrain_pyramid_near = atof(value);
+        if (job_parameters->terrain_pyramid_near < 0)
+        {
+            fprintf(stderr, "_jobfile_set_field: data_terrain_pyramid_near must not be negative\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if (strcmp(field, FIELD_DATA_WINDOW) == EQUAL)
+        job_parameters->data_window = atoi(value);
+    else if (strcmp(field, FIELD_DATA_TILE_CACHE) == EQUAL)
+    {
+        job_parameters->data_tile_cache = atoi(value);
+        if (job_parameters->data_tile_cache < 1)
+        {
+            fprintf(stderr, "_jobfile_set_field: data_tile_cache must be positive\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if (strcmp(field, FIELD_DATA_PREFETCH) == EQUAL)
+    {
+        job_parameters->data_prefetch = atoi(value);
+        if (job_parameters->data_prefetch < 0)
+        {
+            fprintf(stderr, "_jobfile_set_field: data_prefetch must not be negative\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if (strcmp(field, FIELD_DATA_LAYOUT) == EQUAL)
+    {
+        for (int i = 0; i < strlen(value); i++)
+            value[i] = tolower(value[i]);
+        if (grid_layout_parse(value, &job_parameters->data_layout) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "_jobfile_set_field: data_layout must be either 'rows' or 'tiles', not %s\n", value);
+            return EXIT_FAILURE;
+        }
+    }
+    else if (strcmp(field, FIELD_TERRAIN_TYPE) == EQUAL)
+    {
+        for (int i = 0; i < strlen(value); i++)
+            value[i] = tolower(value[i]);
+        if (grid_file_parse_type(value, &job_parameters->terrain_type) != EXIT_SUCCESS ||
+            job_parameters->terrain_type == GRID_SAMPLE_U8)
+        {
+            fprintf(stderr, "_jobfile_set_field: data_terrain_type must be either 'f64', 'f32' or 'i16', not %s\n", value);
+            return EXIT_FAILURE;
+        }
+    }
     else if (strcmp(field, FIELD_CLUTTER) == EQUAL)
     {
         int i = 0;
@@ -3,12 +3,16 @@
 
 #include "c1812/parameters.h"
 #include "colors.h"
+#include "result_store.h"
+#include "grid_file.h"
+#include "grid_layout.h"
+#include "terrain_file.h"
 
 #define MAX_LINE_LENGTH 256
 #define MAX_FIELD_LENGTH 32
 #define MAX_VALUE_LENGTH (MAX_LINE_LENGTH - MAX_FIELD_LENGTH - 1)
-#define MAX_TERRAIN_FILES 1
-#define MAX_CLUTTER_FILES 1
+#define MAX_TERRAIN_FILES 16
+#define MAX_CLUTTER_FILES 16
 
 typedef enum
 {
@@ -35,11 +39,26 @@ typedef struct
     double xres;   // Calculation spatial resolution [m]
     double ares;   // Calculation angular resolution [deg]
     int threads;   // Number of threads to use, default 1
+    int angle_block;  // Number of consecutive angles a thread takes at a time, 0 picks it from the angle and thread counts
+    int thread_stats; // Print the per-thread busy and idle times after a point-to-area calculation, default 0
 
     char terrain[MAX_TERRAIN_FILES][MAX_VALUE_LENGTH]; // Terrain data file paths
+    grid_sample_type_t terrain_type;                   // Sample type of .tf files made from text terrain data, default f64
+    int terrain_coefficients;                          // MiB for precomputed bicubic terrain coefficients, default 0 (none)
+    tf_pyramid_t terrain_pyramid;                      // Coarser terrain levels for widely spaced profile points, default none
+    double terrain_pyramid_near;                       // Distance [m] from the transmitter sampled at full resolution, default 0
+    grid_layout_t data_layout;                         // Memory layout of terrain and clutter grids, default rows
+    int data_window;                                   // Load only the part of the grids the job covers, default 0 (whole grids)
+    int data_tile_cache;                               // Tiles of a terrain or clutter mosaic kept mapped, default 64
+    int data_prefetch;                                 // Azimuths ahead of the calculation to open mosaic tiles for, default 16, 0 for none
     char clutter[MAX_CLUTTER_FILES][MAX_VALUE_LENGTH]; // Clutter data file paths
 
     char out[MAX_VALUE_LENGTH]; // Output RF file path
+    int out_version;            // Output RF file format version, 1 (default) or 2
+    int out_terrain;            // Add a terrain height channel to a version 2 RF file, default 0
+    int out_clutter;            // Add a clutter height channel to a version 2 RF file, default 0
+    int out_compression;        // Compress a version 2 RF file in blocks of rays, default 0
+    int out_block;              // Rays per compressed block, default 16
 
     char img[MAX_VALUE_LENGTH];              // Output image file path
     int img_size;                            // Output image size [px]
@@ -47,6 +66,7 @@ typedef struct
     double img_scale_min;                    // Output image scale minimum
     double img_scale_max;                    // Output image scale maximum
     job_parameters_img_data_t img_data_type; // Output image data type
+    result_store_type_t result_type;         // Sample type of the results, in memory and in a version 2 RF file
 
 } job_parameters_t;
 
@@ -1,8 +1,193 @@
 #include "outfile.h"
+#include "rfcodec.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
-#define WRITE_BINARY "wb"
+// Read access is needed for outfile_map()
+#define WRITE_BINARY "w+b"
+
+// Rays in block b, the last block may be shorter
+int _outfile_block_rays(outfile_t *outfile, int b)
+{
+    int rest = outfile->rays - b * outfile->block_rays;
+    return (rest < outfile->block_rays) ? rest : outfile->block_rays;
+}
+
+// pwrite() leaves the file position alone, so threads do not need to coordinate
+int _outfile_pwrite(outfile_t *outfile, const unsigned char *data, size_t size, off_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fileno(outfile->file), data, size, offset);
+        if (written < 0)
+        {
+            fprintf(stderr, "_outfile_pwrite: pwrite() offset=%lld\n", (long long)offset);
+            return EXIT_FAILURE;
+        }
+
+        data += written;
+        size -= written;
+        offset += written;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int _outfile_init_blocks(outfile_t *outfile, const outfile_header_t *header)
+{
+    if (header->block_rays < 1)
+    {
+        fprintf(stderr, "_outfile_init_blocks: %d rays per block\n", header->block_rays);
+        return EXIT_FAILURE;
+    }
+
+    outfile->compression = header->compression;
+    outfile->rays = header->rays;
+    outfile->block_rays = header->block_rays;
+    outfile->blocks = (header->rays + header->block_rays - 1) / header->block_rays;
+    outfile->end = outfile->header_size;
+
+    outfile->block_data = calloc(outfile->blocks, sizeof(unsigned char *));
+    outfile->block_filled = calloc(outfile->blocks, sizeof(int));
+    outfile->block_offset = calloc(outfile->blocks, sizeof(uint64_t));
+    outfile->block_size = calloc(outfile->blocks, sizeof(uint64_t));
+    if (outfile->block_data == NULL || outfile->block_filled == NULL ||
+        outfile->block_offset == NULL || outfile->block_size == NULL)
+    {
+        fprintf(stderr, "_outfile_init_blocks: calloc()\n");
+        return EXIT_FAILURE;
+    }
+
+    if (pthread_mutex_init(&outfile->mutex, NULL) != 0)
+    {
+        fprintf(stderr, "_outfile_init_blocks: pthread_mutex_init()\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Encode block b and append it to the file
+int _outfile_write_block(outfile_t *outfile, int b)
+{
+    int rays = _outfile_block_rays(outfile, b);
+    size_t raw_size = rays * outfile->ray_size;
+
+    unsigned char *encoded = malloc(rfcodec_bound(raw_size));
+    unsigned char *work = malloc(raw_size);
+    if (encoded == NULL || work == NULL)
+    {
+        fprintf(stderr, "_outfile_write_block: malloc() b=%d\n", b);
+        free(encoded);
+        free(work);
+        return EXIT_FAILURE;
+    }
+
+    size_t size = rfcodec_encode(outfile->type, rays, outfile->channels * outfile->n, outfile->block_data[b],
+                                 encoded, work);
+
+    pthread_mutex_lock(&outfile->mutex);
+    off_t offset = outfile->end;
+    outfile->end += size;
+    outfile->block_offset[b] = offset;
+    outfile->block_size[b] = size;
+    free(outfile->block_data[b]);
+    outfile->block_data[b] = NULL;
+    pthread_mutex_unlock(&outfile->mutex);
+
+    int status = _outfile_pwrite(outfile, encoded, size, offset);
+    free(encoded);
+    free(work);
+    return status;
+}
+
+// Copy a ray into its block, the thread delivering the last ray of a block writes it
+int _outfile_collect_ray(outfile_t *outfile, int index, const unsigned char *ray)
+{
+    int b = index / outfile->block_rays;
+
+    pthread_mutex_lock(&outfile->mutex);
+    if (outfile->block_data[b] == NULL)
+        outfile->block_data[b] = calloc(_outfile_block_rays(outfile, b), outfile->ray_size);
+    unsigned char *block = outfile->block_data[b];
+    pthread_mutex_unlock(&outfile->mutex);
+
+    if (block == NULL)
+    {
+        fprintf(stderr, "_outfile_collect_ray: calloc() b=%d\n", b);
+        return EXIT_FAILURE;
+    }
+
+    memcpy(block + (index % outfile->block_rays) * outfile->ray_size, ray, outfile->ray_size);
+
+    pthread_mutex_lock(&outfile->mutex);
+    bool complete = (++outfile->block_filled[b] == _outfile_block_rays(outfile, b));
+    pthread_mutex_unlock(&outfile->mutex);
+
+    if (complete && _outfile_write_block(outfile, b) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "_outfile_collect_ray: _outfile_write_block() b=%d\n", b);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Write any incomplete blocks, the block index and the trailer
+int _outfile_finish_blocks(outfile_t *outfile)
+{
+    for (int b = 0; b < outfile->blocks; b++)
+    {
+        if (outfile->block_data[b] != NULL && _outfile_write_block(outfile, b) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "_outfile_finish_blocks: _outfile_write_block() b=%d\n", b);
+            return EXIT_FAILURE;
+        }
+    }
+
+    size_t index_size = outfile->blocks * 2 * sizeof(uint64_t);
+    unsigned char *buffer = malloc(index_size + OUTFILE_TRAILER_SIZE);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "_outfile_finish_blocks: malloc() buffer\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int b = 0; b < outfile->blocks; b++)
+    {
+        memcpy(buffer + b * 2 * sizeof(uint64_t), &outfile->block_offset[b], sizeof(uint64_t));
+        memcpy(buffer + (b * 2 + 1) * sizeof(uint64_t), &outfile->block_size[b], sizeof(uint64_t));
+    }
+
+    uint64_t index_offset = outfile->end;
+    uint32_t block_rays = outfile->block_rays;
+    uint32_t blocks = outfile->blocks;
+    unsigned char *trailer = buffer + index_size;
+    memcpy(trailer, &index_offset, sizeof(uint64_t));
+    memcpy(trailer + 8, &block_rays, sizeof(uint32_t));
+    memcpy(trailer + 12, &blocks, sizeof(uint32_t));
+    memcpy(trailer + 16, OUTFILE_INDEX_MAGIC, OUTFILE_MAGIC_SIZE);
+
+    int status = _outfile_pwrite(outfile, buffer, index_size + OUTFILE_TRAILER_SIZE, outfile->end);
+    free(buffer);
+    return status;
+}
+
+void _outfile_free_blocks(outfile_t *outfile)
+{
+    for (int b = 0; b < outfile->blocks; b++)
+        free(outfile->block_data[b]);
+    free(outfile->block_data);
+    free(outfile->block_filled);
+    free(outfile->block_offset);
+    free(outfile->block_size);
+    outfile->block_data = NULL;
+    pthread_mutex_destroy(&outfile->mutex);
+}
 
 int outfile_open(outfile_t *outfile, const char *filename)
 {
@@ -13,12 +198,30 @@ int outfile_open(outfile_t *outfile, const char *filename)
         return EXIT_FAILURE;
     }
 
+    outfile->n = 0;
+    outfile->version = OUTFILE_VERSION_1;
+    outfile->type = RESULT_STORE_F64;
+    outfile->channels = 1;
+    outfile->channel[0].kind = OUTFILE_CHANNEL_LOSS;
+    outfile->channel[0].offset = 0.0;
+    outfile->channel[0].scale = 1.0;
+    outfile->header_size = 0;
+    outfile->ray_size = 0;
+    outfile->compression = OUTFILE_COMPRESSION_NONE;
+    outfile->block_data = NULL;
+    outfile->block_filled = NULL;
+    outfile->block_offset = NULL;
+    outfile->block_size = NULL;
+    outfile->map = NULL;
+    outfile->map_size = 0;
+
     return EXIT_SUCCESS;
 }
 
 int outfile_write_header(outfile_t *outfile, double txx, double txy, double radius, double ares, int n)
 {
     outfile->n = n;
+    outfile->ray_size = n * sizeof(double);
 
     if (fwrite(&txx, sizeof(double), 1, outfile->file) != 1)
     {
@@ -50,6 +253,98 @@ int outfile_write_header(outfile_t *outfile, double txx, double txy, double radi
         return EXIT_FAILURE;
     }
 
+    // Rays written with outfile_write_ray_at() bypass the stream buffer
+    if (fflush(outfile->file))
+    {
+        fprintf(stderr, "outfile_write_header: fflush()\n");
+        return EXIT_FAILURE;
+    }
+
+    outfile->header_size = ftell(outfile->file);
+    return EXIT_SUCCESS;
+}
+
+int outfile_write_header_v2(outfile_t *outfile, const outfile_header_t *header)
+{
+    if (header->channels < 1 || header->channels > OUTFILE_MAX_CHANNELS)
+    {
+        fprintf(stderr, "outfile_write_header_v2: %d channels\n", header->channels);
+        return EXIT_FAILURE;
+    }
+
+    outfile->n = header->n;
+    outfile->version = OUTFILE_VERSION_2;
+    outfile->type = header->type;
+    outfile->channels = header->channels;
+    memcpy(outfile->channel, header->channel, sizeof(outfile->channel));
+    outfile->ray_size = (size_t)header->channels * header->n * result_store_sample_size(header->type);
+
+    // Rays start aligned, so that a mapping of the file can be read in place
+    size_t size = OUTFILE_V2_CHANNEL_OFFSET + header->channels * OUTFILE_V2_CHANNEL_SIZE;
+    size = (size + OUTFILE_ALIGNMENT - 1) / OUTFILE_ALIGNMENT * OUTFILE_ALIGNMENT;
+
+    unsigned char *buffer = calloc(size, 1);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "outfile_write_header_v2: calloc() buffer\n");
+        return EXIT_FAILURE;
+    }
+
+    uint32_t version = OUTFILE_VERSION_2;
+    uint32_t byte_order = OUTFILE_BYTE_ORDER_MARK;
+    uint32_t header_size = size;
+    uint32_t type = header->type;
+    uint32_t channels = header->channels;
+    int32_t n = header->n;
+    int32_t rays = header->rays;
+    uint32_t compression = header->compression;
+
+    memcpy(buffer, OUTFILE_MAGIC, OUTFILE_MAGIC_SIZE);
+    memcpy(buffer + OUTFILE_V2_VERSION_OFFSET, &version, sizeof(uint32_t));
+    memcpy(buffer + OUTFILE_V2_BYTE_ORDER_OFFSET, &byte_order, sizeof(uint32_t));
+    memcpy(buffer + OUTFILE_V2_HEADER_SIZE_OFFSET, &header_size, sizeof(uint32_t));
+    memcpy(buffer + OUTFILE_V2_TYPE_OFFSET, &type, sizeof(uint32_t));
+    memcpy(buffer + OUTFILE_V2_CHANNELS_OFFSET, &channels, sizeof(uint32_t));
+    memcpy(buffer + OUTFILE_V2_N_OFFSET, &n, sizeof(int32_t));
+    memcpy(buffer + OUTFILE_V2_RAYS_OFFSET, &rays, sizeof(int32_t));
+    memcpy(buffer + OUTFILE_V2_COMPRESSION_OFFSET, &compression, sizeof(uint32_t));
+    memcpy(buffer + OUTFILE_V2_TXX_OFFSET, &header->txx, sizeof(double));
+    memcpy(buffer + OUTFILE_V2_TXY_OFFSET, &header->txy, sizeof(double));
+    memcpy(buffer + OUTFILE_V2_RADIUS_OFFSET, &header->radius, sizeof(double));
+    memcpy(buffer + OUTFILE_V2_ARES_OFFSET, &header->ares, sizeof(double));
+
+    for (int c = 0; c < header->channels; c++)
+    {
+        unsigned char *channel = buffer + OUTFILE_V2_CHANNEL_OFFSET + c * OUTFILE_V2_CHANNEL_SIZE;
+        uint32_t kind = header->channel[c].kind;
+        memcpy(channel, &kind, sizeof(uint32_t));
+        memcpy(channel + 8, &header->channel[c].offset, sizeof(double));
+        memcpy(channel + 16, &header->channel[c].scale, sizeof(double));
+    }
+
+    if (fwrite(buffer, size, 1, outfile->file) != 1)
+    {
+        fprintf(stderr, "outfile_write_header_v2: fwrite()\n");
+        free(buffer);
+        return EXIT_FAILURE;
+    }
+    free(buffer);
+
+    // Rays written with outfile_write_ray_at() bypass the stream buffer
+    if (fflush(outfile->file))
+    {
+        fprintf(stderr, "outfile_write_header_v2: fflush()\n");
+        return EXIT_FAILURE;
+    }
+
+    outfile->header_size = size;
+
+    if (header->compression == OUTFILE_COMPRESSION_BLOCKS && _outfile_init_blocks(outfile, header) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "outfile_write_header_v2: _outfile_init_blocks()\n");
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
 
@@ -64,8 +359,87 @@ int outfile_write_ray(outfile_t *outfile, double *ray)
     return EXIT_SUCCESS;
 }
 
+int outfile_write_ray_at(outfile_t *outfile, int index, const double *const *channels)
+{
+    size_t size = outfile->ray_size;
+
+    // A single f64 channel is written as it is, anything else is converted first
+    unsigned char *buffer = NULL;
+    const unsigned char *data = (const unsigned char *)channels[0];
+    if (outfile->channels > 1 || outfile->type != RESULT_STORE_F64)
+    {
+        buffer = malloc(size);
+        if (buffer == NULL)
+        {
+            fprintf(stderr, "outfile_write_ray_at: malloc() buffer\n");
+            return EXIT_FAILURE;
+        }
+
+        size_t channel_size = size / outfile->channels;
+        for (int c = 0; c < outfile->channels; c++)
+            result_store_encode(outfile->type, outfile->channel[c].offset, outfile->channel[c].scale, channels[c],
+                                outfile->n, buffer + c * channel_size);
+        data = buffer;
+    }
+
+    int status;
+    if (outfile->compression == OUTFILE_COMPRESSION_BLOCKS)
+        status = _outfile_collect_ray(outfile, index, data);
+    else
+        status = _outfile_pwrite(outfile, data, size, outfile->header_size + (off_t)index * size);
+    free(buffer);
+
+    if (status != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "outfile_write_ray_at: index=%d\n", index);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int outfile_map(outfile_t *outfile, int ray_count, const unsigned char **rays)
+{
+    if (outfile->compression != OUTFILE_COMPRESSION_NONE)
+    {
+        fprintf(stderr, "outfile_map: compressed file\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t size = outfile->header_size + ray_count * outfile->ray_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(outfile->file), 0);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "outfile_map: mmap()\n");
+        return EXIT_FAILURE;
+    }
+
+    outfile->map = map;
+    outfile->map_size = size;
+    *rays = (const unsigned char *)map + outfile->header_size;
+    return EXIT_SUCCESS;
+}
+
 int outfile_close(outfile_t *outfile)
 {
+    if (outfile->map != NULL)
+    {
+        munmap(outfile->map, outfile->map_size);
+        outfile->map = NULL;
+    }
+
+    if (outfile->block_data != NULL)
+    {
+        int status = _outfile_finish_blocks(outfile);
+        _outfile_free_blocks(outfile);
+        if (status != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "outfile_close: _outfile_finish_blocks()\n");
+            fclose(outfile->file);
+            return EXIT_FAILURE;
+        }
+    }
+
     if (fclose(outfile->file))
     {
         fprintf(stderr, "outfile_close: fclose()\n");
@@ -2,11 +2,130 @@
 #define OUTFILE_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "result_store.h"
+
+/*
+ * Version 1 .rf file, native byte order:
+ *
+ *   double txx, txy, radius, ares; int n;
+ *   then the rays, n doubles each, back to back
+ *
+ * Version 2 .rf file, native byte order, every ray at a fixed stride so that readers
+ * can map the file and index it directly (numpy.memmap(..., offset=header_size,
+ * shape=(rays, channels, n))):
+ *
+ *   offset  type      field
+ *        0  char[8]   magic, OUTFILE_MAGIC
+ *        8  uint32    version, 2
+ *       12  uint32    byte order mark, OUTFILE_BYTE_ORDER_MARK as written by the producer
+ *       16  uint32    header_size, bytes before ray 0, a multiple of OUTFILE_ALIGNMENT
+ *       20  uint32    sample type, result_store_type_t
+ *       24  uint32    channels
+ *       28  int32     n, samples per ray and channel
+ *       32  int32     rays, one per angle
+ *       36  uint32    compression, OUTFILE_COMPRESSION_*
+ *       40  double    txx, txy, radius, ares
+ *       72  channels times: uint32 kind (outfile_channel_t), uint32 reserved,
+ *                           double offset, double scale (value = offset + code * scale
+ *                           for RESULT_STORE_U16 samples, code 0xFFFF is NaN)
+ *           zero padding up to header_size
+ *
+ *   then ray after ray, each holding its channels one after the other, n samples each
+ *
+ * A compressed version 2 file (OUTFILE_COMPRESSION_BLOCKS) has the same header. After it
+ * come blocks of block_rays consecutive rays, the last one possibly shorter, each encoded
+ * on its own as described in rfcodec.h and stored in whatever order they were finished:
+ *
+ *   blocks
+ *   block index, per block: uint64 offset, uint64 size
+ *   trailer: uint64 index offset, uint32 block_rays, uint32 blocks, char[8] OUTFILE_INDEX_MAGIC
+ */
+
+#define OUTFILE_MAGIC "C1812RF"
+#define OUTFILE_MAGIC_SIZE 8
+#define OUTFILE_VERSION_1 1
+#define OUTFILE_VERSION_2 2
+#define OUTFILE_BYTE_ORDER_MARK 0x01020304
+#define OUTFILE_ALIGNMENT 64
+#define OUTFILE_MAX_CHANNELS 3
+#define OUTFILE_COMPRESSION_NONE 0
+#define OUTFILE_COMPRESSION_BLOCKS 1
+#define OUTFILE_INDEX_MAGIC "C1812RI"
+#define OUTFILE_TRAILER_SIZE 24
+
+// Version 2 header layout
+#define OUTFILE_V2_VERSION_OFFSET 8
+#define OUTFILE_V2_BYTE_ORDER_OFFSET 12
+#define OUTFILE_V2_HEADER_SIZE_OFFSET 16
+#define OUTFILE_V2_TYPE_OFFSET 20
+#define OUTFILE_V2_CHANNELS_OFFSET 24
+#define OUTFILE_V2_N_OFFSET 28
+#define OUTFILE_V2_RAYS_OFFSET 32
+#define OUTFILE_V2_COMPRESSION_OFFSET 36
+#define OUTFILE_V2_TXX_OFFSET 40
+#define OUTFILE_V2_TXY_OFFSET 48
+#define OUTFILE_V2_RADIUS_OFFSET 56
+#define OUTFILE_V2_ARES_OFFSET 64
+#define OUTFILE_V2_CHANNEL_OFFSET 72
+#define OUTFILE_V2_CHANNEL_SIZE 24
+
+typedef enum
+{
+    OUTFILE_CHANNEL_LOSS,    // basic transmission loss [dB]
+    OUTFILE_CHANNEL_TERRAIN, // terrain height [m]
+    OUTFILE_CHANNEL_CLUTTER, // representative clutter height [m]
+} outfile_channel_kind_t;
+
+typedef struct
+{
+    outfile_channel_kind_t kind;
+    double offset; // value of code 0 (RESULT_STORE_U16)
+    double scale;  // value step between codes (RESULT_STORE_U16)
+} outfile_channel_t;
+
+// Contents of a version 2 header
+typedef struct
+{
+    double txx;    // center x coordinate
+    double txy;    // center y coordinate
+    double radius; // radius of the circle
+    double ares;   // angular resolution
+    int n;         // number of points in a ray
+    int rays;      // number of rays
+    result_store_type_t type;
+    int channels;
+    outfile_channel_t channel[OUTFILE_MAX_CHANNELS];
+    int compression; // OUTFILE_COMPRESSION_*
+    int block_rays;  // rays per compressed block
+} outfile_header_t;
 
 typedef struct
 {
     FILE *file;
     int n;
+    int version;
+    result_store_type_t type;
+    int channels;
+    outfile_channel_t channel[OUTFILE_MAX_CHANNELS];
+    long header_size; // bytes before the first ray
+    size_t ray_size;  // bytes from one ray to the next
+    void *map;        // mapping from outfile_map(), or NULL
+    size_t map_size;
+
+    // Compressed files, rays are collected per block until the block is complete
+    int compression;
+    int rays;
+    int block_rays;
+    int blocks;
+    unsigned char **block_data; // rays of the blocks being collected, NULL for the others
+    int *block_filled;          // rays received per block
+    uint64_t *block_offset;     // where each finished block was written
+    uint64_t *block_size;
+    off_t end;                  // end of the blocks written so far
+    pthread_mutex_t mutex;      // guards the block bookkeeping
 } outfile_t;
 
 /**
@@ -18,7 +137,7 @@ typedef struct
 int outfile_open(outfile_t *outfile, const char *filename);
 
 /**
- * @brief Write the header of the output file.
+ * @brief Write the header of a version 1 output file.
  *
  * @param outfile Pointer to the output file structure.
  * @param txx Center x coordinate.
@@ -30,7 +149,15 @@ int outfile_open(outfile_t *outfile, const char *filename);
 int outfile_write_header(outfile_t *outfile, double txx, double txy, double radius, double ares, int n);
 
 /**
- * @brief Write a ray to the output file.
+ * @brief Write the header of a version 2 output file.
+ *
+ * @param outfile Pointer to the output file structure.
+ * @param header Header contents.
+ */
+int outfile_write_header_v2(outfile_t *outfile, const outfile_header_t *header);
+
+/**
+ * @brief Write a ray of a version 1 output file after the previous one.
  *
  * @param outfile Pointer to the output file structure.
  * @param Lb Pointer to the ray array.
@@ -38,10 +165,34 @@ int outfile_write_header(outfile_t *outfile, double txx, double txy, double radi
 int outfile_write_ray(outfile_t *outfile, double *Lb);
 
 /**
- * @brief Close the output file.
+ * @brief Write the ray with the given index at its place in the file.
+ *
+ * Rays can be written in any order and from several threads at once,
+ * after the header has been written.
+ *
+ * @param outfile Pointer to the output file structure.
+ * @param index Index of the ray.
+ * @param channels One array of n values per channel of the file, converted to its sample type.
+ */
+int outfile_write_ray_at(outfile_t *outfile, int index, const double *const *channels);
+
+/**
+ * @brief Map the rays of the file into memory for reading, not for compressed files.
+ *
+ * The samples of the mapping are not necessarily aligned, read them with memcpy().
+ * Ray i starts outfile->ray_size * i bytes after ray 0. The mapping is released by outfile_close().
+ *
+ * @param outfile Pointer to the output file structure.
+ * @param ray_count Number of rays written.
+ * @param rays Set to the first byte of ray 0.
+ */
+int outfile_map(outfile_t *outfile, int ray_count, const unsigned char **rays);
+
+/**
+ * @brief Close the output file, writing the block index of a compressed file.
  *
  * @param outfile Pointer to the output file structure.
  */
 int outfile_close(outfile_t *outfile);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,10 +1,35 @@
 #include "p2a.h"
 
-#include <pthread.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
 #include "outfile.h"
 #include "image.h"
 #include "colors.h"
+#include "result_store.h"
+
+// Blocks handed out per thread when the job does not set angle_block. Small enough blocks
+// let fast threads pick up the work of slow ones, large enough keep neighbouring azimuths,
+// which read the same terrain around the transmitter, on one thread
+#define BLOCKS_PER_THREAD 8
+
+// Quantization of RESULT_STORE_U16 rays: losses in 0.01 dB steps up to 655 dB,
+// terrain and clutter heights in 0.25 m steps from -500 m
+#define U16_LOSS_OFFSET 0.0
+#define U16_LOSS_SCALE 0.01
+#define U16_HEIGHT_OFFSET -500.0
+#define U16_HEIGHT_SCALE 0.25
+
+// Pause of the prefetch thread once it is data_prefetch azimuths ahead [ns]
+#define PREFETCH_WAIT_NS 200000
+
+// Hands out contiguous blocks of angles to whichever thread asks first
+typedef struct
+{
+    atomic_int next_angle; // first angle of the next block
+    int angle_count;
+    int block;
+} p2a_scheduler_t;
 
 typedef struct
 {
@@ -12,29 +37,47 @@ typedef struct
 
     job_parameters_t *job_parameters;
     c1812_parameters_t *parameters;
+    c1812_prepared_t *prepared;
     terrain_file_t *tfs;
     clutter_file_t *cfs;
 
     double *angles;
-    int angle_count;
-    int angle_start;
-    int angle_increment;
+    p2a_scheduler_t *scheduler;
+
+    result_store_t *store; // store to keep the finished rays in, or NULL
+    outfile_t *outfile;    // file to write finished rays to, or NULL
 
-    double **results;
+    // Scheduling statistics, filled in by the thread
+    int rays;      // number of rays calculated
+    double busy;   // time spent calculating rays [s]
+    double finish; // time the thread ran out of work [s]
 } p2a_thread_argument_t;
 
-void *p2a_thread_func(void *argument);
-int malloc_caches(c1812_parameters_t *parameters, int n);
-void clear_caches(c1812_parameters_t *parameters, int n);
-void free_caches(c1812_parameters_t *parameters);
-int output_image(job_parameters_t *job, double **results, double *angles, int angles_count, int n);
-int output_rf_file(job_parameters_t *job, double **results, double *angles, int angles_count, int n);
+// Opens the mosaic tiles of the rays just ahead of the ones being calculated
+typedef struct
+{
+    job_parameters_t *job_parameters;
+    terrain_file_t *tf;
+    clutter_file_t *cf;
+    double *angles;
+    p2a_scheduler_t *scheduler;
+    atomic_bool done; // the calculation finished
+} p2a_prefetch_t;
 
-int p2a(job_parameters_t *job, c1812_parameters_t *parameters, terrain_file_t *tfs, clutter_file_t *cfs)
+void *p2a_thread_func(void *argument);
+void *p2a_prefetch_func(void *argument);
+int output_image(job_parameters_t *job, result_store_t *store, int angles_count, int n);
+int open_rf_file(job_parameters_t *job, outfile_t *outfile, int n, int angles_count);
+void p2a_quantization(outfile_channel_kind_t kind, double *offset, double *scale);
+outfile_channel_kind_t p2a_ray_kind(job_parameters_t *job);
+void print_thread_stats(p2a_thread_argument_t *thread_arguments, int threads, double start);
+double p2a_now();
+
+int p2a(job_parameters_t *job, c1812_parameters_t *parameters, terrain_file_t *tfs, clutter_file_t *cfs, pool_t *pool)
 {
     int n = (int)c_ceil(job->radius / (job->xres * KM_M));
     parameters->n = n;
-    parameters->d = malloc(n * sizeof(double));
+    parameters->d = malloc(n * sizeof(real_t));
     if (parameters->d == NULL)
     {
         fprintf(stderr, "p2a: malloc() parameters->d\n");
@@ -55,29 +98,36 @@ int p2a(job_parameters_t *job, c1812_parameters_t *parameters, terrain_file_t *t
     for (int i = 0; i < angles_count; i++)
         angles[i] = 360.0 * i / angles_count;
 
-    double **results = malloc(angles_count * sizeof(double *));
-    if (results == NULL)
+    bool generate_img = (strlen(job->img) > 0);
+    bool generate_out = (strlen(job->out) > 0);
+
+    // Finished rays go straight to the output file at their angle's offset, so memory
+    // only holds one ray per thread. The image reads them back from the file, unless
+    // there is none, it is compressed or it holds another sample type than the one asked for
+    outfile_t outfile;
+    if (generate_out && open_rf_file(job, &outfile, n, angles_count) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "p2a: malloc() results\n");
+        fprintf(stderr, "p2a: open_rf_file()\n");
         return EXIT_FAILURE;
     }
 
-    for (int i = 0; i < angles_count; i++)
+    bool keep_rays = generate_img && (!generate_out || outfile.compression != OUTFILE_COMPRESSION_NONE ||
+                                      outfile.type != job->result_type);
+    result_store_t store;
+    if (keep_rays)
     {
-        results[i] = malloc(n * sizeof(double));
-        if (results[i] == NULL)
+        double offset, scale;
+        p2a_quantization(p2a_ray_kind(job), &offset, &scale);
+        if (result_store_create(&store, job->result_type, angles_count, n, offset, scale) != EXIT_SUCCESS)
         {
-            fprintf(stderr, "p2a: malloc() results[%d]\n", i);
+            fprintf(stderr, "p2a: result_store_create()\n");
             return EXIT_FAILURE;
         }
     }
 
-    pthread_t *threads = malloc(job->threads * sizeof(pthread_t));
-    if (threads == NULL)
-    {
-        fprintf(stderr, "p2a: malloc() threads\n");
-        return EXIT_FAILURE;
-    }
+    // Frequency, time percentage, climate and latitude are the same for every ray
+    c1812_prepared_t prepared;
+    c1812_prepare(parameters, &prepared);
 
     p2a_thread_argument_t *thread_arguments = malloc(job->threads * sizeof(p2a_thread_argument_t));
     if (thread_arguments == NULL)
@@ -86,74 +136,118 @@ int p2a(job_parameters_t *job, c1812_parameters_t *parameters, terrain_file_t *t
         return EXIT_FAILURE;
     }
 
+    p2a_scheduler_t scheduler;
+    atomic_init(&scheduler.next_angle, 0);
+    scheduler.angle_count = angles_count;
+    scheduler.block = job->angle_block;
+    if (scheduler.block <= 0)
+        scheduler.block = (int)c_ceil((double)angles_count / (job->threads * BLOCKS_PER_THREAD));
+
+    double start = p2a_now();
     for (int t = 0; t < job->threads; t++)
     {
         thread_arguments[t].thread_id = t;
 
         thread_arguments[t].job_parameters = job;
         thread_arguments[t].parameters = parameters;
+        thread_arguments[t].prepared = &prepared;
         thread_arguments[t].tfs = tfs;
         thread_arguments[t].cfs = cfs;
 
         thread_arguments[t].angles = angles;
-        thread_arguments[t].angle_count = angles_count;
-        thread_arguments[t].angle_start = t;
-        thread_arguments[t].angle_increment = job->threads;
+        thread_arguments[t].scheduler = &scheduler;
+
+        thread_arguments[t].store = keep_rays ? &store : NULL;
+        thread_arguments[t].outfile = generate_out ? &outfile : NULL;
 
-        thread_arguments[t].results = results;
+        thread_arguments[t].rays = 0;
+        thread_arguments[t].busy = 0.0;
+        thread_arguments[t].finish = start;
     }
 
-    for (int t = 0; t < job->threads; t++)
+    // Tiles of mosaics are opened by a thread of its own ahead of the workers
+    p2a_prefetch_t prefetch;
+    pthread_t prefetch_thread;
+    bool prefetching = job->data_prefetch > 0 && (tfs[0].mosaic != NULL || cfs[0].mosaic != NULL);
+    if (prefetching)
     {
-        if (pthread_create(&threads[t], NULL, p2a_thread_func, &thread_arguments[t]) != 0)
+        prefetch.job_parameters = job;
+        prefetch.tf = &tfs[0];
+        prefetch.cf = &cfs[0];
+        prefetch.angles = angles;
+        prefetch.scheduler = &scheduler;
+        atomic_init(&prefetch.done, false);
+        if (pthread_create(&prefetch_thread, NULL, p2a_prefetch_func, &prefetch) != 0)
         {
-            fprintf(stderr, "p2a: pthread_create() t=%d\n", t);
-            return EXIT_FAILURE;
+            fprintf(stderr, "p2a: pthread_create() prefetch, tiles open as the rays reach them\n");
+            prefetching = false;
         }
     }
 
-    for (int t = 0; t < job->threads; t++)
+    int status = pool_run(pool, p2a_thread_func, thread_arguments, sizeof(p2a_thread_argument_t), job->threads);
+
+    if (prefetching)
     {
-        if (pthread_join(threads[t], NULL) != 0)
-        {
-            fprintf(stderr, "p2a: pthread_join() t=%d\n", t);
-            return EXIT_FAILURE;
-        }
+        atomic_store(&prefetch.done, true);
+        pthread_join(prefetch_thread, NULL);
+    }
+
+    if (status != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "p2a: pool_run()\n");
+        return EXIT_FAILURE;
+    }
+
+    if (job->thread_stats)
+    {
+        print_thread_stats(thread_arguments, job->threads, start);
+        if (tfs[0].coefficients != NULL)
+            printf("terrain coefficients: %.1f of %.1f MiB\n", tf_coefficients_used(&tfs[0]) / (1024.0 * 1024.0),
+                   tfs[0].coefficients->budget / (1024.0 * 1024.0));
+        if (tfs[0].mosaic != NULL)
+            printf("terrain tiles: %lu opened, %lu found open\n", tfs[0].mosaic->misses, tfs[0].mosaic->hits);
+        if (cfs[0].mosaic != NULL)
+            printf("clutter tiles: %lu opened, %lu found open\n", cfs[0].mosaic->misses, cfs[0].mosaic->hits);
     }
 
-    free(threads);
     free(thread_arguments);
 
-    bool generate_img = (strlen(job->img) > 0);
     if (generate_img)
     {
-        if (output_image(job, results, angles, angles_count, n) != EXIT_SUCCESS)
+        if (!keep_rays)
+        {
+            const unsigned char *rays;
+            if (outfile_map(&outfile, angles_count, &rays) != EXIT_SUCCESS)
+            {
+                fprintf(stderr, "p2a: outfile_map()\n");
+                return EXIT_FAILURE;
+            }
+            result_store_wrap(&store, outfile.type, rays, angles_count, n, outfile.ray_size,
+                              outfile.channel[0].offset, outfile.channel[0].scale);
+        }
+
+        if (output_image(job, &store, angles_count, n) != EXIT_SUCCESS)
         {
             fprintf(stderr, "p2a: output_image()\n");
             return EXIT_FAILURE;
         }
     }
 
-    bool generate_out = (strlen(job->out) > 0);
-    if (generate_out)
+    if (generate_out && outfile_close(&outfile) != EXIT_SUCCESS)
     {
-        if (output_rf_file(job, results, angles, angles_count, n) != EXIT_SUCCESS)
-        {
-            fprintf(stderr, "p2a: output_rf_file()\n");
-            return EXIT_FAILURE;
-        }
+        fprintf(stderr, "p2a: outfile_close()\n");
+        return EXIT_FAILURE;
     }
 
-    for (int ai = 0; ai < angles_count; ai++)
-        free(results[ai]);
-    free(results);
+    if (generate_img)
+        result_store_free(&store);
     free(angles);
     free(parameters->d);
 
     return EXIT_SUCCESS;
 }
 
-int output_image(job_parameters_t *job, double **results, double *angles, int angles_count, int n)
+int output_image(job_parameters_t *job, result_store_t *store, int angles_count, int n)
 {
     int W = job->img_size;
     int H = job->img_size;
@@ -191,7 +285,7 @@ int output_image(job_parameters_t *job, double **results, double *angles, int an
             if (ni < 3)
                 ni = 3;
 
-            double loss = results[ai][ni];
+            double loss = result_store_get(store, ai, ni);
             double value = NAN;
 
             switch (job->img_data_type)
@@ -238,35 +332,135 @@ int output_image(job_parameters_t *job, double **results, double *angles, int an
     return EXIT_SUCCESS;
 }
 
-int output_rf_file(job_parameters_t *job, double **results, double *angles, int angles_count, int n)
+outfile_channel_kind_t p2a_ray_kind(job_parameters_t *job)
 {
-    outfile_t outfile;
-    if (outfile_open(&outfile, job->out) != EXIT_SUCCESS)
+    switch (job->img_data_type)
     {
-        fprintf(stderr, "output_rf_file: outfile_open()\n");
-        return EXIT_FAILURE;
+    case IMG_DATA_TYPE_TERRAIN:
+        return OUTFILE_CHANNEL_TERRAIN;
+    case IMG_DATA_TYPE_CLUTTER:
+        return OUTFILE_CHANNEL_CLUTTER;
+    default:
+        return OUTFILE_CHANNEL_LOSS;
     }
+}
 
-    if (outfile_write_header(&outfile, job->txx, job->txy, job->radius, job->ares, n) != EXIT_SUCCESS)
+void p2a_quantization(outfile_channel_kind_t kind, double *offset, double *scale)
+{
+    bool heights = (kind == OUTFILE_CHANNEL_TERRAIN || kind == OUTFILE_CHANNEL_CLUTTER);
+    *offset = heights ? U16_HEIGHT_OFFSET : U16_LOSS_OFFSET;
+    *scale = heights ? U16_HEIGHT_SCALE : U16_LOSS_SCALE;
+}
+
+int open_rf_file(job_parameters_t *job, outfile_t *outfile, int n, int angles_count)
+{
+    if (outfile_open(outfile, job->out) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "output_rf_file: outfile_write_header()\n");
+        fprintf(stderr, "open_rf_file: outfile_open()\n");
         return EXIT_FAILURE;
     }
 
-    for (int ai = 0; ai < angles_count; ai++)
+    if (job->out_version == OUTFILE_VERSION_1)
     {
-        if (outfile_write_ray(&outfile, results[ai]) != EXIT_SUCCESS)
+        if (outfile_write_header(outfile, job->txx, job->txy, job->radius, job->ares, n) != EXIT_SUCCESS)
         {
-            fprintf(stderr, "output_rf_file: outfile_write_ray() angle=%.1f\n", angles[ai]);
+            fprintf(stderr, "open_rf_file: outfile_write_header()\n");
             return EXIT_FAILURE;
         }
+
+        return EXIT_SUCCESS;
     }
 
-    if (outfile_close(&outfile) != EXIT_SUCCESS)
+    outfile_header_t header;
+    header.txx = job->txx;
+    header.txy = job->txy;
+    header.radius = job->radius;
+    header.ares = job->ares;
+    header.n = n;
+    header.rays = angles_count;
+    header.type = job->result_type;
+    header.compression = job->out_compression ? OUTFILE_COMPRESSION_BLOCKS : OUTFILE_COMPRESSION_NONE;
+    header.block_rays = job->out_block;
+
+    // The calculated ray first, then the profiles asked for
+    header.channels = 0;
+    header.channel[header.channels++].kind = p2a_ray_kind(job);
+    if (job->out_terrain)
+        header.channel[header.channels++].kind = OUTFILE_CHANNEL_TERRAIN;
+    if (job->out_clutter)
+        header.channel[header.channels++].kind = OUTFILE_CHANNEL_CLUTTER;
+
+    for (int c = 0; c < header.channels; c++)
+        p2a_quantization(header.channel[c].kind, &header.channel[c].offset, &header.channel[c].scale);
+
+    if (outfile_write_header_v2(outfile, &header) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "output_rf_file: outfile_close()\n");
+        fprintf(stderr, "open_rf_file: outfile_write_header_v2()\n");
         return EXIT_FAILURE;
     }
+
+    return EXIT_SUCCESS;
+}
+
+void *p2a_prefetch_func(void *argument)
+{
+    p2a_prefetch_t *prefetch = argument;
+    job_parameters_t *job = prefetch->job_parameters;
+    p2a_scheduler_t *scheduler = prefetch->scheduler;
+    const struct timespec wait = {0, PREFETCH_WAIT_NS};
+
+    int next = 0; // first angle whose tiles were not opened yet
+    while (!atomic_load(&prefetch->done))
+    {
+        int current = atomic_load(&scheduler->next_angle);
+        if (next < current)
+            next = current;
+        if (next >= scheduler->angle_count)
+            break;
+
+        if (next >= current + job->data_prefetch)
+        {
+            nanosleep(&wait, NULL);
+            continue;
+        }
+
+        double angle = prefetch->angles[next];
+        double x2 = job->txx + job->radius * c_cos(angle * PI / 180.0);
+        double y2 = job->txy + job->radius * c_sin(angle * PI / 180.0);
+        if (prefetch->tf->mosaic != NULL)
+            grid_mosaic_prefetch_line(prefetch->tf->mosaic, job->txx, job->txy, x2, y2);
+        if (prefetch->cf->mosaic != NULL)
+            grid_mosaic_prefetch_line(prefetch->cf->mosaic, job->txx, job->txy, x2, y2);
+        next++;
+    }
+
+    return NULL;
+}
+
+double p2a_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void print_thread_stats(p2a_thread_argument_t *thread_arguments, int threads, double start)
+{
+    // The calculation lasts until the last thread runs out of work, every thread is idle
+    // for whatever part of that it did not spend on rays
+    double wall = 0.0;
+    for (int t = 0; t < threads; t++)
+        wall = c_max(wall, thread_arguments[t].finish - start);
+
+    double busy = 0.0;
+    for (int t = 0; t < threads; t++)
+    {
+        p2a_thread_argument_t *argument = &thread_arguments[t];
+        printf("thread %d: %d rays, busy %.3f s, idle %.3f s\n", t, argument->rays, argument->busy, wall - argument->busy);
+        busy += argument->busy;
+    }
+
+    printf("wall %.3f s, scheduling efficiency %.1f%%\n", wall, 100.0 * busy / (threads * wall));
 }
 
 void *p2a_thread_func(void *argument)
@@ -281,124 +475,153 @@ void *p2a_thread_func(void *argument)
     memcpy(&parameters, master_parameters, sizeof(c1812_parameters_t));
     int n = parameters.n;
 
-    parameters.h = malloc(parameters.n * sizeof(double));
+    parameters.h = malloc(parameters.n * sizeof(real_t));
     if (parameters.h == NULL)
     {
         fprintf(stderr, "p2a_thread_func t=%d: malloc() parameters.h\n", thread_argument->thread_id);
         return (void *)EXIT_FAILURE;
     }
 
-    parameters.Ct = malloc(parameters.n * sizeof(double));
+    parameters.Ct = malloc(parameters.n * sizeof(real_t));
     if (parameters.Ct == NULL)
     {
         fprintf(stderr, "p2a_thread_func t=%d: malloc() parameters.Ct\n", thread_argument->thread_id);
         return (void *)EXIT_FAILURE;
     }
 
-    if (malloc_caches(&parameters, n + 3) != EXIT_SUCCESS)
+    // Losses in the precision of the library, widened into the result rays
+    real_t *Lb = malloc(parameters.n * sizeof(real_t));
+    if (Lb == NULL)
     {
-        fprintf(stderr, "p2a_thread_func t=%d: malloc_caches()\n", thread_argument->thread_id);
+        fprintf(stderr, "p2a_thread_func t=%d: malloc() Lb\n", thread_argument->thread_id);
+        return (void *)EXIT_FAILURE;
+    }
+
+    // Ray being calculated, followed by room for the profile channels of the output file
+    double *ray_buffer = malloc(OUTFILE_MAX_CHANNELS * parameters.n * sizeof(double));
+    if (ray_buffer == NULL)
+    {
+        fprintf(stderr, "p2a_thread_func t=%d: malloc() ray_buffer\n", thread_argument->thread_id);
+        return (void *)EXIT_FAILURE;
+    }
+
+    // Terrain and clutter profile as sampled, before narrowing into the parameters
+    double *profile_h = malloc(2 * n * sizeof(double));
+    if (profile_h == NULL)
+    {
+        fprintf(stderr, "p2a_thread_func t=%d: malloc() profile_h\n", thread_argument->thread_id);
+        return (void *)EXIT_FAILURE;
+    }
+    double *profile_Ct = profile_h + n;
+
+    c1812_workspace_t *workspace = c1812_workspace_create(n);
+    if (workspace == NULL)
+    {
+        fprintf(stderr, "p2a_thread_func t=%d: c1812_workspace_create()\n", thread_argument->thread_id);
         return (void *)EXIT_FAILURE;
     }
 
     double x1 = job->txx, y1 = job->txy;
     double angle;
     double x2, y2;
-    double xi, yi;
-    double t;
 
     c1812_results_t results;
 
-    for (int ai = thread_argument->angle_start; ai < thread_argument->angle_count; ai += thread_argument->angle_increment)
+    p2a_scheduler_t *scheduler = thread_argument->scheduler;
+
+    for (;;)
     {
-        angle = thread_argument->angles[ai];
+        int block_start = atomic_fetch_add(&scheduler->next_angle, scheduler->block);
+        if (block_start >= scheduler->angle_count)
+            break;
 
-        x2 = job->txx + job->radius * c_cos(angle * PI / 180.0);
-        y2 = job->txy + job->radius * c_sin(angle * PI / 180.0);
+        int block_end = block_start + scheduler->block;
+        if (block_end > scheduler->angle_count)
+            block_end = scheduler->angle_count;
 
-        for (int i = 0; i < n; i++)
+        double block_time = p2a_now();
+        for (int ai = block_start; ai < block_end; ai++)
         {
-            t = i / (n - 1.0);
-            xi = x1 + (x2 - x1) * t;
-            yi = y1 + (y2 - y1) * t;
-            parameters.h[i] = tf_interpolation_func(&tfs[0], xi, yi);
-            parameters.Ct[i] = cf_interpolation_func(&cfs[0], xi, yi) / M_DM;
-        }
+            angle = thread_argument->angles[ai];
 
-        for (int i = 0; i < 3; i++)
-            thread_argument->results[ai][i] = 0.0;
+            x2 = job->txx + job->radius * c_cos(angle * PI / 180.0);
+            y2 = job->txy + job->radius * c_sin(angle * PI / 180.0);
 
-        clear_caches(&parameters, n + 3);
+            tf_profile_func(&tfs[0], x1, y1, x2, y2, n, profile_h);
+            cf_profile_func(&cfs[0], x1, y1, x2, y2, n, profile_Ct);
+            for (int i = 0; i < n; i++)
+            {
+                parameters.h[i] = profile_h[i];
+                parameters.Ct[i] = profile_Ct[i] / M_DM;
+            }
 
-        for (int i = n - 1; i >= 3; i--)
-        {
-            if (results.error == RESULTS_ERR_NONE)
+            double *ray = ray_buffer;
+            if (job->img_data_type == IMG_DATA_TYPE_TERRAIN)
             {
-                if (job->img_data_type == IMG_DATA_TYPE_TERRAIN)
-                    thread_argument->results[ai][i] = parameters.h[i];
-                else if (job->img_data_type == IMG_DATA_TYPE_CLUTTER)
-                    thread_argument->results[ai][i] = parameters.Ct[i];
-                else
-                {
-                    parameters.n = i;
-                    c1812_calculate(&parameters, &results);
-                    thread_argument->results[ai][i] = results.Lb;
-                }
+                for (int i = 0; i < n; i++)
+                    ray[i] = parameters.h[i];
+            }
+            else if (job->img_data_type == IMG_DATA_TYPE_CLUTTER)
+            {
+                for (int i = 0; i < n; i++)
+                    ray[i] = parameters.Ct[i];
             }
             else
             {
-                fprintf(stderr, "p2a_thread_func t=%d: calculation error %d\n", thread_argument->thread_id, results.error);
-                thread_argument->results[ai][i] = NAN;
+                // Losses for all receiver positions along the ray in one pass
+                c1812_calculate_ray(&parameters, thread_argument->prepared, workspace, Lb, &results);
+                if (results.error != RESULTS_ERR_NONE)
+                {
+                    fprintf(stderr, "p2a_thread_func t=%d: calculation error %d\n", thread_argument->thread_id, results.error);
+                    for (int i = 0; i < n; i++)
+                        ray[i] = NAN;
+                }
+                else
+                {
+                    for (int i = 0; i < n; i++)
+                        ray[i] = Lb[i];
+                }
             }
-        }
-    }
 
-    free(parameters.h);
-    free_caches(&parameters);
-}
+            for (int i = 0; i < 3 && i < n; i++)
+                ray[i] = 0.0;
 
-int malloc_caches(c1812_parameters_t *parameters, int n)
-{
-    parameters->v1_cache = malloc(n * sizeof(double));
-    if (parameters->v1_cache == NULL)
-    {
-        fprintf(stderr, "malloc_caches: malloc() parameters->v1_cache\n");
-        return EXIT_FAILURE;
-    }
+            if (thread_argument->store != NULL)
+                result_store_set_ray(thread_argument->store, ai, ray);
 
-    parameters->v2_cache = malloc(n * sizeof(double));
-    if (parameters->v2_cache == NULL)
-    {
-        free(parameters->v1_cache);
-        fprintf(stderr, "malloc_caches: malloc() parameters->v2_cache\n");
-        return EXIT_FAILURE;
-    }
+            outfile_t *outfile = thread_argument->outfile;
+            if (outfile != NULL)
+            {
+                const double *channels[OUTFILE_MAX_CHANNELS];
+                channels[0] = ray;
+                for (int c = 1; c < outfile->channels; c++)
+                {
+                    double *profile = ray_buffer + c * n;
+                    real_t *source = (outfile->channel[c].kind == OUTFILE_CHANNEL_TERRAIN) ? parameters.h : parameters.Ct;
+                    for (int i = 0; i < n; i++)
+                        profile[i] = source[i];
+                    channels[c] = profile;
+                }
 
-    parameters->theta_max_cache = malloc(n * sizeof(double));
-    if (parameters->theta_max_cache == NULL)
-    {
-        free(parameters->v1_cache);
-        free(parameters->v2_cache);
-        fprintf(stderr, "malloc_caches: malloc() parameters->theta_max_cache\n");
-        return EXIT_FAILURE;
+                if (outfile_write_ray_at(outfile, ai, channels) != EXIT_SUCCESS)
+                {
+                    fprintf(stderr, "p2a_thread_func t=%d: outfile_write_ray_at() angle=%.1f\n", thread_argument->thread_id, angle);
+                    return (void *)EXIT_FAILURE;
+                }
+            }
+        }
+
+        thread_argument->rays += block_end - block_start;
+        thread_argument->busy += p2a_now() - block_time;
     }
 
-    return EXIT_SUCCESS;
-}
+    thread_argument->finish = p2a_now();
 
-void clear_caches(c1812_parameters_t *parameters, int n)
-{
-    for (int i = 0; i < n; i++)
-    {
-        parameters->v1_cache[i] = NAN;
-        parameters->v2_cache[i] = NAN;
-        parameters->theta_max_cache[i] = NAN;
-    }
+    c1812_workspace_free(workspace);
+    free(profile_h);
+    free(ray_buffer);
+    free(Lb);
+    free(parameters.h);
+    free(parameters.Ct);
+    return (void *)EXIT_SUCCESS;
 }
-
-void free_caches(c1812_parameters_t *parameters)
-{
-    free(parameters->v1_cache);
-    free(parameters->v2_cache);
-    free(parameters->theta_max_cache);
-}
\ No newline at end of file
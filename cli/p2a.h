@@ -2,6 +2,7 @@
 #define P2A_H
 
 #include "p2pa_common.h"
+#include "pool.h"
 
 /**
  * @brief Point-to-area calculation
@@ -10,9 +11,10 @@
  * @param parameters Calculation parameters
  * @param tfs Terrain data files
  * @param cfs Clutter data files
+ * @param pool Worker threads, at least job_parameters->threads of them
  *
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  */
-int p2a(job_parameters_t *job_parameters, c1812_parameters_t *parameters, terrain_file_t *tfs, clutter_file_t *cfs);
+int p2a(job_parameters_t *job_parameters, c1812_parameters_t *parameters, terrain_file_t *tfs, clutter_file_t *cfs, pool_t *pool);
 
 #endif
\ No newline at end of file
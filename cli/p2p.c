@@ -56,14 +56,14 @@ int p2p_prepare(job_parameters_t *job_parameters, c1812_parameters_t *parameters
 
     int n = (int)c_ceil(distance / job_parameters->xres);
 
-    double *d = malloc(n * sizeof(double));
+    real_t *d = malloc(n * sizeof(real_t));
     if (d == NULL)
     {
         fprintf(stderr, "prepare_point_to_point: malloc() d\n");
         return EXIT_FAILURE;
     }
 
-    double *h = malloc(n * sizeof(double));
+    real_t *h = malloc(n * sizeof(real_t));
     if (h == NULL)
     {
         fprintf(stderr, "prepare_point_to_point: malloc() h\n");
@@ -71,7 +71,7 @@ int p2p_prepare(job_parameters_t *job_parameters, c1812_parameters_t *parameters
         return EXIT_FAILURE;
     }
 
-    double *Ct = malloc(n * sizeof(double));
+    real_t *Ct = malloc(n * sizeof(real_t));
     if (Ct == NULL)
     {
         fprintf(stderr, "prepare_point_to_point: malloc() Ct\n");
@@ -80,14 +80,26 @@ int p2p_prepare(job_parameters_t *job_parameters, c1812_parameters_t *parameters
         return EXIT_FAILURE;
     }
 
+    double *profile_h = malloc(2 * n * sizeof(double));
+    if (profile_h == NULL)
+    {
+        fprintf(stderr, "prepare_point_to_point: malloc() profile_h\n");
+        free(d);
+        free(h);
+        free(Ct);
+        return EXIT_FAILURE;
+    }
+    double *profile_Ct = profile_h + n;
+
+    tf_profile_func(&tfs[0], x1, y1, x2, y2, n, profile_h);
+    cf_profile_func(&cfs[0], x1, y1, x2, y2, n, profile_Ct);
     for (int i = 0; i < n; i++)
     {
-        double xi = x1 + (x2 - x1) * i / (n - 1);
-        double yi = y1 + (y2 - y1) * i / (n - 1);
         d[i] = distance * i / (n - 1);
-        h[i] = tf_interpolation_func(&tfs[0], xi, yi);
-        Ct[i] = cf_interpolation_func(&cfs[0], xi, yi) / M_DM;
+        h[i] = profile_h[i];
+        Ct[i] = profile_Ct[i] / M_DM;
     }
+    free(profile_h);
 
     parameters->n = n;
     parameters->d = d;
@@ -19,7 +19,8 @@
 #define M_CM 100.0
 #define M_DM 10.0
 
-#define tf_interpolation_func tf_get_bicubic
-#define cf_interpolation_func cf_get_bilinear
+// Profiles are sampled bicubically from the terrain and bilinearly from the clutter
+#define tf_profile_func tf_sample_line
+#define cf_profile_func cf_sample_line
 
 #endif
\ No newline at end of file
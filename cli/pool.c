@@ -0,0 +1,144 @@
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct
+{
+    pool_t *pool;
+    int thread_id;
+} _pool_worker_argument_t;
+
+void *_pool_worker(void *argument)
+{
+    _pool_worker_argument_t *worker = (_pool_worker_argument_t *)argument;
+    pool_t *pool = worker->pool;
+    int t = worker->thread_id;
+    free(worker);
+
+    unsigned int seen_run = 0;
+    pthread_mutex_lock(&pool->mutex);
+    for (;;)
+    {
+        while (!pool->shutdown && pool->run == seen_run)
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+
+        if (pool->shutdown)
+            break;
+
+        seen_run = pool->run;
+        if (t >= pool->count)
+            continue;
+
+        pool_func_t func = pool->func;
+        void *func_argument = pool->arguments + t * pool->argument_size;
+        pthread_mutex_unlock(&pool->mutex);
+
+        void *status = func(func_argument);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (status != (void *)EXIT_SUCCESS)
+            pool->failed = true;
+        pool->pending--;
+        if (pool->pending == 0)
+            pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+int pool_create(pool_t *pool, int size)
+{
+    pool->size = 0;
+    pool->run = 0;
+    pool->shutdown = false;
+    pool->failed = false;
+    pool->pending = 0;
+
+    pool->threads = malloc(size * sizeof(pthread_t));
+    if (pool->threads == NULL)
+    {
+        fprintf(stderr, "pool_create: malloc() threads\n");
+        return EXIT_FAILURE;
+    }
+
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0 ||
+        pthread_cond_init(&pool->work_cond, NULL) != 0 ||
+        pthread_cond_init(&pool->done_cond, NULL) != 0)
+    {
+        fprintf(stderr, "pool_create: pthread_*_init()\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int t = 0; t < size; t++)
+    {
+        _pool_worker_argument_t *worker = malloc(sizeof(_pool_worker_argument_t));
+        if (worker == NULL)
+        {
+            fprintf(stderr, "pool_create: malloc() worker t=%d\n", t);
+            pool_free(pool);
+            return EXIT_FAILURE;
+        }
+
+        worker->pool = pool;
+        worker->thread_id = t;
+        if (pthread_create(&pool->threads[t], NULL, _pool_worker, worker) != 0)
+        {
+            fprintf(stderr, "pool_create: pthread_create() t=%d\n", t);
+            free(worker);
+            pool_free(pool);
+            return EXIT_FAILURE;
+        }
+        pool->size++;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int pool_run(pool_t *pool, pool_func_t func, void *arguments, size_t argument_size, int count)
+{
+    if (count > pool->size)
+    {
+        fprintf(stderr, "pool_run: %d workers requested, pool has %d\n", count, pool->size);
+        return EXIT_FAILURE;
+    }
+
+    if (count <= 0)
+        return EXIT_SUCCESS;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->func = func;
+    pool->arguments = (char *)arguments;
+    pool->argument_size = argument_size;
+    pool->count = count;
+    pool->pending = count;
+    pool->failed = false;
+    pool->run++;
+    pthread_cond_broadcast(&pool->work_cond);
+
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    bool failed = pool->failed;
+    pthread_mutex_unlock(&pool->mutex);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void pool_free(pool_t *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int t = 0; t < pool->size; t++)
+        pthread_join(pool->threads[t], NULL);
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->size = 0;
+}
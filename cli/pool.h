@@ -0,0 +1,67 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void *(*pool_func_t)(void *argument);
+
+/*
+ * Worker threads kept alive between calculations, so that a batch of jobs
+ * starts its threads once
+ */
+typedef struct
+{
+    int size;           // number of worker threads
+    pthread_t *threads; // worker threads
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond; // signalled when a new run starts or the pool shuts down
+    pthread_cond_t done_cond; // signalled when the last worker of a run finishes
+
+    unsigned int run; // incremented for every pool_run()
+    bool shutdown;
+    bool failed; // a worker of the current run returned something other than (void *)EXIT_SUCCESS
+
+    // Current run
+    pool_func_t func;
+    char *arguments;
+    size_t argument_size;
+    int count;   // number of workers taking part in the run
+    int pending; // number of workers still running func
+} pool_t;
+
+/**
+ * @brief Start the worker threads.
+ *
+ * @param pool Pointer to the pool structure.
+ * @param size Number of worker threads.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int pool_create(pool_t *pool, int size);
+
+/**
+ * @brief Run func on count workers and wait for all of them to return.
+ *
+ * Worker t calls func with the t-th element of the arguments array.
+ *
+ * @param pool Pointer to the pool structure.
+ * @param func Function to run, returning (void *)EXIT_SUCCESS or (void *)EXIT_FAILURE.
+ * @param arguments Array of count arguments.
+ * @param argument_size Size of one element of the arguments array.
+ * @param count Number of workers to use, at most the pool size.
+ *
+ * @return EXIT_SUCCESS if every call of func succeeded, EXIT_FAILURE otherwise.
+ */
+int pool_run(pool_t *pool, pool_func_t func, void *arguments, size_t argument_size, int count);
+
+/**
+ * @brief Stop and join the worker threads.
+ *
+ * @param pool Pointer to the pool structure.
+ */
+void pool_free(pool_t *pool);
+
+#endif
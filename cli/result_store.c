@@ -0,0 +1,146 @@
+#include "result_store.h"
+#include "c1812/custom_math.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TYPE_NAME_F64 "f64"
+#define TYPE_NAME_F32 "f32"
+#define TYPE_NAME_U16 "u16"
+
+// Largest code that stands for a value
+#define U16_MAX_CODE (RESULT_STORE_U16_NAN - 1)
+
+size_t result_store_sample_size(result_store_type_t type)
+{
+    switch (type)
+    {
+    case RESULT_STORE_F32:
+        return sizeof(float);
+    case RESULT_STORE_U16:
+        return sizeof(uint16_t);
+    default:
+        return sizeof(double);
+    }
+}
+
+int result_store_create(result_store_t *store, result_store_type_t type, int rays, int n, double offset, double scale)
+{
+    store->type = type;
+    store->rays = rays;
+    store->n = n;
+    store->offset = offset;
+    store->scale = scale;
+    store->stride = n * result_store_sample_size(type);
+    store->owned = true;
+
+    store->data = malloc(rays * store->stride);
+    if (store->data == NULL)
+    {
+        fprintf(stderr, "result_store_create: malloc() data\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void result_store_wrap(result_store_t *store, result_store_type_t type, const unsigned char *data, int rays, int n,
+                       size_t stride, double offset, double scale)
+{
+    store->type = type;
+    store->rays = rays;
+    store->n = n;
+    store->offset = offset;
+    store->scale = scale;
+    store->stride = stride;
+    store->data = (unsigned char *)data;
+    store->owned = false;
+}
+
+void result_store_encode(result_store_type_t type, double offset, double scale, const double *values, int n,
+                         unsigned char *samples)
+{
+    switch (type)
+    {
+    case RESULT_STORE_F64:
+        memcpy(samples, values, n * sizeof(double));
+        break;
+    case RESULT_STORE_F32:
+        for (int i = 0; i < n; i++)
+        {
+            float sample = (float)values[i];
+            memcpy(samples + i * sizeof(float), &sample, sizeof(float));
+        }
+        break;
+    case RESULT_STORE_U16:
+        for (int i = 0; i < n; i++)
+        {
+            uint16_t sample = RESULT_STORE_U16_NAN;
+            if (!c_isnan(values[i]))
+            {
+                double code = c_round((values[i] - offset) / scale);
+                code = c_min(c_max(code, 0.0), U16_MAX_CODE);
+                sample = (uint16_t)code;
+            }
+            memcpy(samples + i * sizeof(uint16_t), &sample, sizeof(uint16_t));
+        }
+        break;
+    }
+}
+
+void result_store_set_ray(result_store_t *store, int ai, const double *ray)
+{
+    result_store_encode(store->type, store->offset, store->scale, ray, store->n, store->data + ai * store->stride);
+}
+
+double result_store_get(result_store_t *store, int ai, int ni)
+{
+    // Wrapped data may come unaligned
+    const unsigned char *sample = store->data + ai * store->stride + ni * result_store_sample_size(store->type);
+
+    switch (store->type)
+    {
+    case RESULT_STORE_F32:
+    {
+        float v;
+        memcpy(&v, sample, sizeof(float));
+        return v;
+    }
+    case RESULT_STORE_U16:
+    {
+        uint16_t code;
+        memcpy(&code, sample, sizeof(uint16_t));
+        if (code == RESULT_STORE_U16_NAN)
+            return NAN;
+        return store->offset + code * store->scale;
+    }
+    default:
+    {
+        double v;
+        memcpy(&v, sample, sizeof(double));
+        return v;
+    }
+    }
+}
+
+int result_store_parse_type(const char *name, result_store_type_t *type)
+{
+    if (strcmp(name, TYPE_NAME_F64) == 0)
+        *type = RESULT_STORE_F64;
+    else if (strcmp(name, TYPE_NAME_F32) == 0)
+        *type = RESULT_STORE_F32;
+    else if (strcmp(name, TYPE_NAME_U16) == 0)
+        *type = RESULT_STORE_U16;
+    else
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+void result_store_free(result_store_t *store)
+{
+    if (store->owned)
+        free(store->data);
+    store->data = NULL;
+}
@@ -0,0 +1,127 @@
+#ifndef RESULT_STORE_H
+#define RESULT_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum
+{
+    RESULT_STORE_F64, // doubles as calculated
+    RESULT_STORE_F32, // floats, about 1e-5 dB below 300 dB
+    RESULT_STORE_U16, // codes offset + code * scale, code 0xFFFF for NaN
+} result_store_type_t;
+
+// Code standing for NaN in a RESULT_STORE_U16 store
+#define RESULT_STORE_U16_NAN UINT16_MAX
+
+/*
+ * The rays of a point-to-area calculation in one contiguous block, ray after ray
+ * at a fixed stride
+ */
+typedef struct
+{
+    result_store_type_t type;
+    int rays;          // number of rays
+    int n;             // samples per ray
+    double offset;     // value of code 0 (RESULT_STORE_U16)
+    double scale;      // value step between codes (RESULT_STORE_U16)
+    size_t stride;     // bytes from one ray to the next
+    unsigned char *data;
+    bool owned;        // data is freed by result_store_free()
+} result_store_t;
+
+/**
+ * @brief Allocate a store.
+ *
+ * @param store Pointer to the store structure.
+ * @param type Sample type.
+ * @param rays Number of rays.
+ * @param n Samples per ray.
+ * @param offset Value of code 0, used by RESULT_STORE_U16 only.
+ * @param scale Value step between codes, used by RESULT_STORE_U16 only. Values outside
+ *              offset .. offset + 65534 * scale are clamped to that range.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int result_store_create(result_store_t *store, result_store_type_t type, int rays, int n, double offset, double scale);
+
+/**
+ * @brief Use existing samples, e.g. a mapped file, as a store.
+ *
+ * The samples do not need to be aligned. The data is not freed by result_store_free().
+ *
+ * @param store Pointer to the store structure.
+ * @param type Sample type.
+ * @param data First byte of ray 0.
+ * @param rays Number of rays.
+ * @param n Samples per ray.
+ * @param stride Bytes from one ray to the next, at least n samples.
+ * @param offset Value of code 0, used by RESULT_STORE_U16 only.
+ * @param scale Value step between codes, used by RESULT_STORE_U16 only.
+ */
+void result_store_wrap(result_store_t *store, result_store_type_t type, const unsigned char *data, int rays, int n,
+                       size_t stride, double offset, double scale);
+
+/**
+ * @brief Store the n samples of a ray, converting them to the store type.
+ *
+ * Different rays can be set from several threads at once.
+ *
+ * @param store Pointer to the store structure.
+ * @param ai Index of the ray.
+ * @param ray Samples of the ray.
+ */
+void result_store_set_ray(result_store_t *store, int ai, const double *ray);
+
+/**
+ * @brief Convert n values to samples of the given type.
+ *
+ * @param type Sample type.
+ * @param offset Value of code 0, used by RESULT_STORE_U16 only.
+ * @param scale Value step between codes, used by RESULT_STORE_U16 only.
+ * @param values Values to convert.
+ * @param n Number of values.
+ * @param samples Set to the n samples, not necessarily aligned.
+ */
+void result_store_encode(result_store_type_t type, double offset, double scale, const double *values, int n,
+                         unsigned char *samples);
+
+/**
+ * @brief Size of one sample of the given type.
+ *
+ * @param type Sample type.
+ *
+ * @return Size in bytes.
+ */
+size_t result_store_sample_size(result_store_type_t type);
+
+/**
+ * @brief Get one sample.
+ *
+ * @param store Pointer to the store structure.
+ * @param ai Index of the ray.
+ * @param ni Index of the sample within the ray.
+ *
+ * @return The sample value, NAN for a NaN sample.
+ */
+double result_store_get(result_store_t *store, int ai, int ni);
+
+/**
+ * @brief Parse a store type name: f64, f32 or u16.
+ *
+ * @param name Type name.
+ * @param type Set to the parsed type.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE for an unknown name.
+ */
+int result_store_parse_type(const char *name, result_store_type_t *type);
+
+/**
+ * @brief Free the store data if it is owned by the store.
+ *
+ * @param store Pointer to the store structure.
+ */
+void result_store_free(result_store_t *store);
+
+#endif
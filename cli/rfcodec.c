@@ -0,0 +1,171 @@
+#include "rfcodec.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_LITERAL 128
+#define MIN_RUN 3
+#define MAX_RUN (MIN_RUN + 127)
+#define RUN_FLAG 0x80
+
+// Samples are taken as unsigned integers of their own size, so the round trip is exact.
+// Deltas go last sample first, so that every sample is still raw when it is subtracted
+#define SAMPLE_DELTA(TYPE, data, count, stride)                            \
+    for (size_t i = (count); i-- > (stride);)                              \
+    {                                                                      \
+        TYPE a, b;                                                         \
+        memcpy(&a, (data) + i * sizeof(TYPE), sizeof(TYPE));               \
+        memcpy(&b, (data) + (i - (stride)) * sizeof(TYPE), sizeof(TYPE));  \
+        a = (TYPE)(a - b);                                                 \
+        memcpy((data) + i * sizeof(TYPE), &a, sizeof(TYPE));               \
+    }
+
+#define SAMPLE_UNDELTA(TYPE, data, count, stride)                          \
+    for (size_t i = (stride); i < (count); i++)                            \
+    {                                                                      \
+        TYPE a, b;                                                         \
+        memcpy(&a, (data) + i * sizeof(TYPE), sizeof(TYPE));               \
+        memcpy(&b, (data) + (i - (stride)) * sizeof(TYPE), sizeof(TYPE));  \
+        a = (TYPE)(a + b);                                                 \
+        memcpy((data) + i * sizeof(TYPE), &a, sizeof(TYPE));               \
+    }
+
+size_t rfcodec_bound(size_t size)
+{
+    return size + size / MAX_LITERAL + 1;
+}
+
+// Difference of every sample from the one a ray earlier, in place
+void _rfcodec_delta(size_t sample_size, size_t count, size_t stride, unsigned char *data)
+{
+    if (sample_size == sizeof(uint64_t))
+        SAMPLE_DELTA(uint64_t, data, count, stride)
+    else if (sample_size == sizeof(uint32_t))
+        SAMPLE_DELTA(uint32_t, data, count, stride)
+    else
+        SAMPLE_DELTA(uint16_t, data, count, stride)
+}
+
+// Inverse of _rfcodec_delta(), in place
+void _rfcodec_undelta(size_t sample_size, size_t count, size_t stride, unsigned char *data)
+{
+    if (sample_size == sizeof(uint64_t))
+        SAMPLE_UNDELTA(uint64_t, data, count, stride)
+    else if (sample_size == sizeof(uint32_t))
+        SAMPLE_UNDELTA(uint32_t, data, count, stride)
+    else
+        SAMPLE_UNDELTA(uint16_t, data, count, stride)
+}
+
+size_t _rfcodec_rle_encode(const unsigned char *in, size_t size, unsigned char *out)
+{
+    size_t o = 0;
+    size_t i = 0;
+    size_t literal_start = 0;
+
+    while (i < size)
+    {
+        size_t run = 1;
+        while (i + run < size && run < MAX_RUN && in[i + run] == in[i])
+            run++;
+
+        if (run < MIN_RUN && i + run < size)
+        {
+            i += run;
+            continue;
+        }
+
+        // Bytes before the run, or up to the end, go out as literals
+        size_t literal_end = (run >= MIN_RUN) ? i : size;
+        while (literal_start < literal_end)
+        {
+            size_t count = literal_end - literal_start;
+            if (count > MAX_LITERAL)
+                count = MAX_LITERAL;
+            out[o++] = (unsigned char)(count - 1);
+            memcpy(out + o, in + literal_start, count);
+            o += count;
+            literal_start += count;
+        }
+
+        if (run >= MIN_RUN)
+        {
+            out[o++] = (unsigned char)(RUN_FLAG + run - MIN_RUN);
+            out[o++] = in[i];
+        }
+
+        i += run;
+        literal_start = i;
+    }
+
+    return o;
+}
+
+int _rfcodec_rle_decode(const unsigned char *in, size_t size, unsigned char *out, size_t out_size)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < size)
+    {
+        unsigned char c = in[i++];
+        if (c & RUN_FLAG)
+        {
+            size_t run = c - RUN_FLAG + MIN_RUN;
+            if (i >= size || o + run > out_size)
+                return EXIT_FAILURE;
+            memset(out + o, in[i++], run);
+            o += run;
+        }
+        else
+        {
+            size_t count = c + 1;
+            if (i + count > size || o + count > out_size)
+                return EXIT_FAILURE;
+            memcpy(out + o, in + i, count);
+            i += count;
+            o += count;
+        }
+    }
+
+    return (o == out_size) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+size_t rfcodec_encode(result_store_type_t type, int rays, int ray_samples, const unsigned char *raw,
+                      unsigned char *encoded, unsigned char *work)
+{
+    size_t sample_size = result_store_sample_size(type);
+    size_t count = (size_t)rays * ray_samples;
+
+    // Deltas in encoded, which is larger than the block, shuffled into work
+    memcpy(encoded, raw, count * sample_size);
+    _rfcodec_delta(sample_size, count, ray_samples, encoded);
+
+    for (size_t i = 0; i < count; i++)
+        for (size_t b = 0; b < sample_size; b++)
+            work[b * count + i] = encoded[i * sample_size + b];
+
+    return _rfcodec_rle_encode(work, count * sample_size, encoded);
+}
+
+int rfcodec_decode(result_store_type_t type, int rays, int ray_samples, const unsigned char *encoded,
+                   size_t encoded_size, unsigned char *raw, unsigned char *work)
+{
+    size_t sample_size = result_store_sample_size(type);
+    size_t count = (size_t)rays * ray_samples;
+
+    if (_rfcodec_rle_decode(encoded, encoded_size, work, count * sample_size) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "rfcodec_decode: damaged block\n");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        for (size_t b = 0; b < sample_size; b++)
+            raw[i * sample_size + b] = work[b * count + i];
+
+    _rfcodec_undelta(sample_size, count, ray_samples, raw);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#ifndef RFCODEC_H
+#define RFCODEC_H
+
+#include <stddef.h>
+#include "result_store.h"
+
+/*
+ * Lossless codec for blocks of consecutive .rf rays, without external libraries:
+ *
+ *   1. delta: every sample, taken as an unsigned integer of its size, minus the sample
+ *      at the same place in the previous ray of the block, modulo 2^bits; the first
+ *      ray of a block is kept as it is
+ *   2. byte shuffle: byte 0 of every sample, then byte 1 of every sample, ...
+ *   3. run-length: control byte c < 128 is followed by c + 1 literal bytes,
+ *      c >= 128 by one byte repeated c - 125 times
+ *
+ * Neighbouring azimuths see similar losses, so the deltas have mostly zero high bytes,
+ * which the shuffle gathers into long runs
+ */
+
+/**
+ * @brief Largest possible size of an encoded block.
+ *
+ * @param size Size of the raw block in bytes.
+ *
+ * @return Size in bytes.
+ */
+size_t rfcodec_bound(size_t size);
+
+/**
+ * @brief Encode a block of rays.
+ *
+ * @param type Sample type.
+ * @param rays Number of rays in the block.
+ * @param ray_samples Samples per ray, all channels together.
+ * @param raw Rays of the block, back to back.
+ * @param encoded Set to the encoded block, at least rfcodec_bound() bytes.
+ * @param work Scratch space of the raw block size.
+ *
+ * @return Size of the encoded block in bytes.
+ */
+size_t rfcodec_encode(result_store_type_t type, int rays, int ray_samples, const unsigned char *raw,
+                      unsigned char *encoded, unsigned char *work);
+
+/**
+ * @brief Decode a block of rays.
+ *
+ * @param type Sample type.
+ * @param rays Number of rays in the block.
+ * @param ray_samples Samples per ray, all channels together.
+ * @param encoded Encoded block.
+ * @param encoded_size Size of the encoded block in bytes.
+ * @param raw Set to the rays of the block, back to back.
+ * @param work Scratch space of the raw block size.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE for a damaged block.
+ */
+int rfcodec_decode(result_store_type_t type, int rays, int ray_samples, const unsigned char *encoded,
+                   size_t encoded_size, unsigned char *raw, unsigned char *work);
+
+#endif
@@ -0,0 +1,277 @@
+#include "rfunpack.h"
+#include "outfile.h"
+#include "rfcodec.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Compressed file and where its blocks go in the plain one
+typedef struct
+{
+    const unsigned char *in; // mapping of the compressed file
+    int out_fd;
+
+    result_store_type_t type;
+    int ray_samples; // samples per ray, all channels together
+    size_t ray_size;
+    size_t header_size;
+    int rays;
+    int block_rays;
+    int blocks;
+    const unsigned char *index;
+
+    atomic_int next_block;
+} _rf_unpack_t;
+
+typedef struct
+{
+    _rf_unpack_t *unpack;
+    int thread_id;
+} _rf_unpack_thread_argument_t;
+
+uint32_t _rf_unpack_u32(const unsigned char *data)
+{
+    uint32_t v;
+    memcpy(&v, data, sizeof(uint32_t));
+    return v;
+}
+
+uint64_t _rf_unpack_u64(const unsigned char *data)
+{
+    uint64_t v;
+    memcpy(&v, data, sizeof(uint64_t));
+    return v;
+}
+
+void *_rf_unpack_thread_func(void *argument)
+{
+    _rf_unpack_thread_argument_t *thread_argument = (_rf_unpack_thread_argument_t *)argument;
+    _rf_unpack_t *unpack = thread_argument->unpack;
+
+    size_t block_size = unpack->block_rays * unpack->ray_size;
+    unsigned char *raw = malloc(block_size);
+    unsigned char *work = malloc(block_size);
+    if (raw == NULL || work == NULL)
+    {
+        fprintf(stderr, "_rf_unpack_thread_func t=%d: malloc()\n", thread_argument->thread_id);
+        free(raw);
+        free(work);
+        return (void *)EXIT_FAILURE;
+    }
+
+    void *status = (void *)EXIT_SUCCESS;
+    for (;;)
+    {
+        int b = atomic_fetch_add(&unpack->next_block, 1);
+        if (b >= unpack->blocks)
+            break;
+
+        int rays = unpack->rays - b * unpack->block_rays;
+        if (rays > unpack->block_rays)
+            rays = unpack->block_rays;
+
+        uint64_t offset = _rf_unpack_u64(unpack->index + b * 2 * sizeof(uint64_t));
+        uint64_t size = _rf_unpack_u64(unpack->index + (b * 2 + 1) * sizeof(uint64_t));
+        if (rfcodec_decode(unpack->type, rays, unpack->ray_samples, unpack->in + offset, size, raw, work) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "_rf_unpack_thread_func t=%d: rfcodec_decode() b=%d\n", thread_argument->thread_id, b);
+            status = (void *)EXIT_FAILURE;
+            break;
+        }
+
+        const unsigned char *data = raw;
+        size_t left = rays * unpack->ray_size;
+        off_t out_offset = unpack->header_size + (off_t)b * block_size;
+        while (left > 0)
+        {
+            ssize_t written = pwrite(unpack->out_fd, data, left, out_offset);
+            if (written < 0)
+            {
+                fprintf(stderr, "_rf_unpack_thread_func t=%d: pwrite() b=%d\n", thread_argument->thread_id, b);
+                status = (void *)EXIT_FAILURE;
+                break;
+            }
+            data += written;
+            left -= written;
+            out_offset += written;
+        }
+
+        if (status != (void *)EXIT_SUCCESS)
+            break;
+    }
+
+    free(raw);
+    free(work);
+    return status;
+}
+
+// Check the header and trailer of the mapped compressed file and fill in unpack
+int _rf_unpack_read_layout(const unsigned char *in, size_t size, _rf_unpack_t *unpack)
+{
+    if (size < OUTFILE_V2_CHANNEL_OFFSET + OUTFILE_TRAILER_SIZE ||
+        memcmp(in, OUTFILE_MAGIC, OUTFILE_MAGIC_SIZE) != 0 ||
+        _rf_unpack_u32(in + OUTFILE_V2_VERSION_OFFSET) != OUTFILE_VERSION_2)
+    {
+        fprintf(stderr, "_rf_unpack_read_layout: not a version 2 .rf file\n");
+        return EXIT_FAILURE;
+    }
+
+    if (_rf_unpack_u32(in + OUTFILE_V2_BYTE_ORDER_OFFSET) != OUTFILE_BYTE_ORDER_MARK)
+    {
+        fprintf(stderr, "_rf_unpack_read_layout: file written in another byte order\n");
+        return EXIT_FAILURE;
+    }
+
+    if (_rf_unpack_u32(in + OUTFILE_V2_COMPRESSION_OFFSET) != OUTFILE_COMPRESSION_BLOCKS)
+    {
+        fprintf(stderr, "_rf_unpack_read_layout: file is not compressed\n");
+        return EXIT_FAILURE;
+    }
+
+    unpack->type = _rf_unpack_u32(in + OUTFILE_V2_TYPE_OFFSET);
+    unpack->header_size = _rf_unpack_u32(in + OUTFILE_V2_HEADER_SIZE_OFFSET);
+    unpack->rays = _rf_unpack_u32(in + OUTFILE_V2_RAYS_OFFSET);
+    unpack->ray_samples = _rf_unpack_u32(in + OUTFILE_V2_CHANNELS_OFFSET) * _rf_unpack_u32(in + OUTFILE_V2_N_OFFSET);
+    unpack->ray_size = unpack->ray_samples * result_store_sample_size(unpack->type);
+
+    const unsigned char *trailer = in + size - OUTFILE_TRAILER_SIZE;
+    uint64_t index_offset = _rf_unpack_u64(trailer);
+    unpack->block_rays = _rf_unpack_u32(trailer + 8);
+    unpack->blocks = _rf_unpack_u32(trailer + 12);
+    if (memcmp(trailer + 16, OUTFILE_INDEX_MAGIC, OUTFILE_MAGIC_SIZE) != 0 || unpack->block_rays < 1 ||
+        index_offset + unpack->blocks * 2 * sizeof(uint64_t) > size - OUTFILE_TRAILER_SIZE)
+    {
+        fprintf(stderr, "_rf_unpack_read_layout: damaged block index\n");
+        return EXIT_FAILURE;
+    }
+    unpack->index = in + index_offset;
+
+    for (int b = 0; b < unpack->blocks; b++)
+    {
+        uint64_t offset = _rf_unpack_u64(unpack->index + b * 2 * sizeof(uint64_t));
+        uint64_t block_size = _rf_unpack_u64(unpack->index + (b * 2 + 1) * sizeof(uint64_t));
+        if (offset + block_size > index_offset)
+        {
+            fprintf(stderr, "_rf_unpack_read_layout: block %d outside the file\n", b);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Writes the header and the unpacked rays to unpack->out_fd
+int _rf_unpack_write(_rf_unpack_t *unpack, pool_t *pool, int threads)
+{
+    // The plain file has the same header, marked uncompressed
+    unsigned char *header = malloc(unpack->header_size);
+    if (header == NULL)
+    {
+        fprintf(stderr, "_rf_unpack_write: malloc() header\n");
+        return EXIT_FAILURE;
+    }
+
+    uint32_t compression = OUTFILE_COMPRESSION_NONE;
+    memcpy(header, unpack->in, unpack->header_size);
+    memcpy(header + OUTFILE_V2_COMPRESSION_OFFSET, &compression, sizeof(uint32_t));
+    ssize_t written = pwrite(unpack->out_fd, header, unpack->header_size, 0);
+    free(header);
+    if (written != (ssize_t)unpack->header_size)
+    {
+        fprintf(stderr, "_rf_unpack_write: pwrite() header\n");
+        return EXIT_FAILURE;
+    }
+
+    if (ftruncate(unpack->out_fd, unpack->header_size + (off_t)unpack->rays * unpack->ray_size) != 0)
+    {
+        fprintf(stderr, "_rf_unpack_write: ftruncate()\n");
+        return EXIT_FAILURE;
+    }
+
+    _rf_unpack_thread_argument_t *thread_arguments = malloc(threads * sizeof(_rf_unpack_thread_argument_t));
+    if (thread_arguments == NULL)
+    {
+        fprintf(stderr, "_rf_unpack_write: malloc() thread_arguments\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        thread_arguments[t].unpack = unpack;
+        thread_arguments[t].thread_id = t;
+    }
+
+    int status = EXIT_SUCCESS;
+    if (pool_run(pool, _rf_unpack_thread_func, thread_arguments, sizeof(_rf_unpack_thread_argument_t), threads) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "_rf_unpack_write: pool_run()\n");
+        status = EXIT_FAILURE;
+    }
+
+    free(thread_arguments);
+    return status;
+}
+
+int rf_unpack(const char *in_path, const char *out_path, pool_t *pool, int threads)
+{
+    int in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0)
+    {
+        fprintf(stderr, "rf_unpack: open() %s\n", in_path);
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(in_fd, &st) != 0)
+    {
+        fprintf(stderr, "rf_unpack: fstat()\n");
+        close(in_fd);
+        return EXIT_FAILURE;
+    }
+
+    size_t in_size = st.st_size;
+    const unsigned char *in = mmap(NULL, in_size, PROT_READ, MAP_SHARED, in_fd, 0);
+    close(in_fd);
+    if (in == MAP_FAILED)
+    {
+        fprintf(stderr, "rf_unpack: mmap()\n");
+        return EXIT_FAILURE;
+    }
+
+    _rf_unpack_t unpack;
+    unpack.in = in;
+    atomic_init(&unpack.next_block, 0);
+    if (_rf_unpack_read_layout(in, in_size, &unpack) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "rf_unpack: _rf_unpack_read_layout() %s\n", in_path);
+        munmap((void *)in, in_size);
+        return EXIT_FAILURE;
+    }
+
+    unpack.out_fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (unpack.out_fd < 0)
+    {
+        fprintf(stderr, "rf_unpack: open() %s\n", out_path);
+        munmap((void *)in, in_size);
+        return EXIT_FAILURE;
+    }
+
+    // Every failure past this point ends here, without leaving a partial plain file behind
+    int status = _rf_unpack_write(&unpack, pool, threads);
+    if (close(unpack.out_fd) != 0 && status == EXIT_SUCCESS)
+    {
+        fprintf(stderr, "rf_unpack: close() %s\n", out_path);
+        status = EXIT_FAILURE;
+    }
+    if (status != EXIT_SUCCESS)
+        unlink(out_path);
+    munmap((void *)in, in_size);
+    return status;
+}
@@ -0,0 +1,18 @@
+#ifndef RFUNPACK_H
+#define RFUNPACK_H
+
+#include "pool.h"
+
+/**
+ * @brief Decompress a compressed version 2 .rf file into a plain one, several blocks at a time.
+ *
+ * @param in_path Compressed file.
+ * @param out_path Plain file to write.
+ * @param pool Worker threads, at least threads of them.
+ * @param threads Number of threads decoding blocks.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int rf_unpack(const char *in_path, const char *out_path, pool_t *pool, int threads);
+
+#endif
@@ -1,14 +1,13 @@
 #include "terrain_file.h"
 #include "vec.h"
-#include "nneighbor.h"
+#include "grid_axis.h"
 #include "c1812/custom_math.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define READ "r"
-#define READ_BINARY "rb"
-#define WRITE_BINARY "wb"
 #define MAX_VALUE_LENGTH 20
 #define MAX_LINE_LENGTH (3 * MAX_VALUE_LENGTH + 2)
 #define SPLIT_CHARS " \n"
@@ -16,8 +15,29 @@
 #define Y_TOKEN_INDEX 1
 #define H_TOKEN_INDEX 2
 
+// Smallest height step of GRID_SAMPLE_I16 files [m], and the largest code used for a height
+#define I16_HEIGHT_STEP 0.1
+#define I16_MAX_CODE INT16_MAX
+
+// Samples a line walk looks ahead to prefetch the neighbourhood it will need
+#define PREFETCH_AHEAD 16
+
+// Ticks around a window for the 4x4 neighbourhoods of the cells on its edges
+#define WINDOW_MARGIN 2
+
+// Smallest side of a pyramid level [samples]
+#define PYRAMID_MIN_SIZE 4
+
+// Ticks between a point sampled from a mosaic tile and its edges, for the 4x4 neighbourhood
+#define MOSAIC_MARGIN 1
+
+#define PYRAMID_NAME_NONE "none"
+#define PYRAMID_NAME_MEAN "mean"
+#define PYRAMID_NAME_MAX "max"
+
 int _tf_parse_first_stage(terrain_file_t *tf, FILE *file);
 int _tf_parse_second_stage(terrain_file_t *tf, FILE *file);
+void _tf_coefficients_free(terrain_file_t *tf);
 
 void tf_zero(terrain_file_t *tf)
 {
@@ -27,7 +47,23 @@ void tf_zero(terrain_file_t *tf)
     tf->y = NULL;
     tf->y_size = 0;
 
+    grid_axis_init(&tf->y_axis, NULL, 0);
+    grid_axis_init(&tf->x_axis, NULL, 0);
+
     tf->h = NULL;
+    tf->stride = 0;
+    tf->tiles_x = 0;
+    tf->layout = GRID_LAYOUT_ROWS;
+    tf->type = GRID_SAMPLE_F64;
+    tf->scale = 1.0;
+    tf->offset = 0.0;
+    tf->nodata = NAN;
+
+    memset(&tf->file, 0, sizeof(grid_file_t));
+    tf->coefficients = NULL;
+    tf->coarser = NULL;
+    tf->pyramid_near = 0.0;
+    tf->mosaic = NULL;
 }
 
 int tf_parse(terrain_file_t *tf, const char *path)
@@ -149,7 +185,11 @@ int _tf_parse_first_stage(terrain_file_t *tf, FILE *file)
     memcpy(tf->y, y_vec.data, tf->y_size * sizeof(double));
     vec_deinit(&y_vec);
 
-    tf->h = malloc(tf->y_size * sizeof(double *));
+    grid_axis_init(&tf->y_axis, tf->y, tf->y_size);
+    grid_axis_init(&tf->x_axis, tf->x, tf->x_size);
+
+    tf->stride = tf->x_size;
+    tf->h = malloc((size_t)tf->y_size * tf->stride * sizeof(double));
     if (tf->h == NULL)
     {
         fprintf(stderr, "tf_parse: malloc() h\n");
@@ -158,23 +198,8 @@ int _tf_parse_first_stage(terrain_file_t *tf, FILE *file)
         return EXIT_FAILURE;
     }
 
-    for (int i = 0; i < tf->y_size; i++)
-    {
-        tf->h[i] = malloc(tf->x_size * sizeof(double));
-        if (tf->h[i] == NULL)
-        {
-            fprintf(stderr, "tf_parse: malloc() h @ y=%f\n", tf->y[i]);
-            free(tf->x);
-            free(tf->y);
-            for (int j = 0; j <= i; j++)
-                free(tf->h[j]);
-            free(tf->h);
-            return EXIT_FAILURE;
-        }
-
-        for (int j = 0; j < tf->x_size; j++)
-            tf->h[i][j] = NAN;
-    }
+    for (size_t i = 0; i < (size_t)tf->y_size * tf->stride; i++)
+        ((double *)tf->h)[i] = NAN;
 
     return EXIT_SUCCESS;
 }
@@ -184,7 +209,7 @@ int _tf_parse_second_stage(terrain_file_t *tf, FILE *file)
     char line[MAX_LINE_LENGTH + 1];
     int line_index = 0;
 
-    // Optimization of nneighbor() calls
+    // Optimization of tick lookups
     double last_x = NAN;
     double last_y = NAN;
     int last_x_index = -1;
@@ -208,7 +233,7 @@ int _tf_parse_second_stage(terrain_file_t *tf, FILE *file)
                 x = atof(token);
                 if (x != last_x)
                 {
-                    nneighbor(tf->x, tf->x_size, x, &last_x_index);
+                    last_x_index = grid_axis_nearest(&tf->x_axis, tf->x, tf->x_size, x);
                     last_x = x;
                 }
             }
@@ -217,13 +242,13 @@ int _tf_parse_second_stage(terrain_file_t *tf, FILE *file)
                 y = atof(token);
                 if (y != last_y)
                 {
-                    nneighbor(tf->y, tf->y_size, y, &last_y_index);
+                    last_y_index = grid_axis_nearest(&tf->y_axis, tf->y, tf->y_size, y);
                     last_y = y;
                 }
             }
             else if (token_index == H_TOKEN_INDEX)
             {
-                tf->h[last_y_index][last_x_index] = atof(token);
+                ((double *)tf->h)[(size_t)last_y_index * tf->stride + last_x_index] = atof(token);
                 break;
             }
 
@@ -235,203 +260,377 @@ int _tf_parse_second_stage(terrain_file_t *tf, FILE *file)
     return EXIT_SUCCESS;
 }
 
-int tf_store(terrain_file_t *tf, const char *path)
+int tf_store(terrain_file_t *tf, const char *path, grid_sample_type_t type)
 {
-    FILE *tf_fp = fopen(path, WRITE_BINARY);
-    if (tf_fp == NULL)
+    grid_file_t gf;
+    gf.y_size = tf->y_size;
+    gf.x_size = tf->x_size;
+    gf.y = tf->y;
+    gf.x = tf->x;
+    gf.type = type;
+    gf.scale = 1.0;
+    gf.offset = 0.0;
+    gf.nodata = NAN;
+
+    if (type == GRID_SAMPLE_I16)
     {
-        fprintf(stderr, "tf_store: fopen()\n");
-        return EXIT_FAILURE;
-    }
+        // Centre the codes on the height range, keeping the step at 0.1 m if it fits
+        double h_min = INFINITY, h_max = NEGATIVE_INFINITY;
+        for (int i = 0; i < tf->y_size; i++)
+        {
+            for (int j = 0; j < tf->x_size; j++)
+            {
+                double h = tf_height(tf, i, j);
+                if (!c_isnan(h))
+                {
+                    h_min = c_min(h_min, h);
+                    h_max = c_max(h_max, h);
+                }
+            }
+        }
 
-    if (fwrite(&tf->y_size, sizeof(int), 1, tf_fp) != 1)
-    {
-        fprintf(stderr, "tf_store: fwrite() y_size\n");
-        return EXIT_FAILURE;
-    }
+        if (h_min > h_max)
+            h_min = h_max = 0.0;
 
-    if (fwrite(&tf->x_size, sizeof(int), 1, tf_fp) != 1)
-    {
-        fprintf(stderr, "tf_store: fwrite() x_size\n");
-        return EXIT_FAILURE;
+        gf.offset = (h_min + h_max) / 2;
+        gf.scale = c_max(I16_HEIGHT_STEP, (h_max - h_min) / (2 * I16_MAX_CODE - 2));
+        gf.nodata = GRID_FILE_I16_NODATA;
     }
-
-    if (fwrite(tf->y, sizeof(double), tf->y_size, tf_fp) != tf->y_size)
+    else if (type != GRID_SAMPLE_F64 && type != GRID_SAMPLE_F32)
     {
-        fprintf(stderr, "tf_store: fwrite() y\n");
+        fprintf(stderr, "tf_store: unsupported sample type %d\n", type);
         return EXIT_FAILURE;
     }
 
-    if (fwrite(tf->x, sizeof(double), tf->x_size, tf_fp) != tf->x_size)
+    size_t sample_size = grid_file_sample_size(type);
+    unsigned char *grid = malloc((size_t)tf->y_size * tf->x_size * sample_size);
+    if (grid == NULL)
     {
-        fprintf(stderr, "tf_store: fwrite() x\n");
+        fprintf(stderr, "tf_store: malloc() grid\n");
         return EXIT_FAILURE;
     }
 
     for (int i = 0; i < tf->y_size; i++)
     {
-        if (fwrite(tf->h[i], sizeof(double), tf->x_size, tf_fp) != tf->x_size)
+        for (int j = 0; j < tf->x_size; j++)
         {
-            fprintf(stderr, "tf_store: fwrite() h @ y=%f\n", tf->y[i]);
-            return EXIT_FAILURE;
+            size_t k = (size_t)i * tf->x_size + j;
+            double h = tf_height(tf, i, j);
+            switch (type)
+            {
+            case GRID_SAMPLE_F32:
+                ((float *)grid)[k] = (float)h;
+                break;
+            case GRID_SAMPLE_I16:
+                ((int16_t *)grid)[k] = c_isnan(h) ? GRID_FILE_I16_NODATA
+                                                  : (int16_t)c_min(c_max(c_round((h - gf.offset) / gf.scale), -I16_MAX_CODE), I16_MAX_CODE);
+                break;
+            default:
+                ((double *)grid)[k] = h;
+                break;
+            }
         }
     }
 
-    if (fclose(tf_fp))
+    int status = grid_file_write(path, GRID_FILE_MAGIC_TERRAIN, &gf, grid, tf->x_size);
+    free(grid);
+
+    if (status != EXIT_SUCCESS)
     {
-        fprintf(stderr, "tf_store: fclose()\n");
+        fprintf(stderr, "tf_store: grid_file_write()\n");
         return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
 }
 
-int tf_open(terrain_file_t *tf, const char *path)
+int tf_open(terrain_file_t *tf, const char *path, const grid_window_t *window)
 {
     tf_zero(tf);
 
-    FILE *tf_fp = fopen(path, READ_BINARY);
-    if (tf_fp == NULL)
+    if (grid_file_map_window(&tf->file, path, GRID_FILE_MAGIC_TERRAIN, GRID_SAMPLE_F64, window, WINDOW_MARGIN) !=
+        EXIT_SUCCESS)
     {
-        fprintf(stderr, "tf_open: fopen()\n");
+        fprintf(stderr, "tf_open: grid_file_map_window()\n");
         return EXIT_FAILURE;
     }
 
-    if (fread(&tf->y_size, sizeof(int), 1, tf_fp) != 1)
+    tf->y_size = tf->file.y_size;
+    tf->x_size = tf->file.x_size;
+    tf->stride = tf->file.stride;
+    tf->y = tf->file.y;
+    tf->x = tf->file.x;
+    tf->type = tf->file.type;
+    tf->scale = tf->file.scale;
+    tf->offset = tf->file.offset;
+    tf->nodata = tf->file.nodata;
+    tf->h = tf->file.grid;
+    grid_axis_init(&tf->y_axis, tf->y, tf->y_size);
+    grid_axis_init(&tf->x_axis, tf->x, tf->x_size);
+
+    if (tf->type == GRID_SAMPLE_U8)
     {
-        fprintf(stderr, "tf_open: fread() y_size\n");
+        fprintf(stderr, "tf_open: unsupported sample type\n");
+        tf_free(tf);
         return EXIT_FAILURE;
     }
 
-    if (fread(&tf->x_size, sizeof(int), 1, tf_fp) != 1)
+    return EXIT_SUCCESS;
+}
+
+int _tf_mosaic_open(void *grid, const char *path)
+{
+    return tf_open(grid, path, NULL);
+}
+
+void _tf_mosaic_free(void *grid)
+{
+    tf_free(grid);
+}
+
+grid_file_t *_tf_mosaic_file(void *grid)
+{
+    return &((terrain_file_t *)grid)->file;
+}
+
+double _tf_mosaic_sample(void *grid, double x, double y, double x_tolerance, double y_tolerance)
+{
+    terrain_file_t *tf = grid;
+    int xi = grid_axis_nearest(&tf->x_axis, tf->x, tf->x_size, x);
+    int yi = grid_axis_nearest(&tf->y_axis, tf->y, tf->y_size, y);
+    if (!(c_abs(tf->x[xi] - x) <= x_tolerance && c_abs(tf->y[yi] - y) <= y_tolerance))
+        return NAN;
+
+    return tf_height(tf, yi, xi);
+}
+
+static const grid_mosaic_kind_t _tf_mosaic_kind = {
+    GRID_FILE_MAGIC_TERRAIN, GRID_SAMPLE_F64, MOSAIC_MARGIN, sizeof(terrain_file_t),
+    _tf_mosaic_open, _tf_mosaic_free, _tf_mosaic_file, _tf_mosaic_sample,
+};
+
+int tf_open_mosaic(terrain_file_t *tf, char **paths, int count, int capacity)
+{
+    tf_zero(tf);
+
+    tf->mosaic = malloc(sizeof(grid_mosaic_t));
+    if (tf->mosaic == NULL)
     {
-        fprintf(stderr, "tf_open: fread() x_size\n");
+        fprintf(stderr, "tf_open_mosaic: malloc() mosaic\n");
         return EXIT_FAILURE;
     }
 
-    tf->y = malloc(tf->y_size * sizeof(double));
-    if (tf->y == NULL)
+    if (grid_mosaic_create(tf->mosaic, &_tf_mosaic_kind, paths, count, capacity) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "tf_open: malloc() y\n");
+        fprintf(stderr, "tf_open_mosaic: grid_mosaic_create()\n");
+        free(tf->mosaic);
+        tf->mosaic = NULL;
         return EXIT_FAILURE;
     }
 
-    tf->x = malloc(tf->x_size * sizeof(double));
-    if (tf->x == NULL)
+    return EXIT_SUCCESS;
+}
+
+int tf_tile(terrain_file_t *tf)
+{
+    void *tiles;
+    if (grid_layout_tile(tf->h, tf->y_size, tf->x_size, tf->stride, grid_file_sample_size(tf->type), &tiles,
+                         &tf->tiles_x) != EXIT_SUCCESS)
     {
-        fprintf(stderr, "tf_open: malloc() x\n");
+        fprintf(stderr, "tf_tile: grid_layout_tile()\n");
         return EXIT_FAILURE;
     }
 
-    if (fread(tf->y, sizeof(double), tf->y_size, tf_fp) != tf->y_size)
+    if (tf->file.map == NULL)
+        free(tf->h);
+    tf->h = tiles;
+    tf->layout = GRID_LAYOUT_TILES;
+
+    return EXIT_SUCCESS;
+}
+
+void tf_free(terrain_file_t *tf)
+{
+    if (tf->mosaic != NULL)
     {
-        fprintf(stderr, "tf_open: fread() y\n");
-        return EXIT_FAILURE;
+        grid_mosaic_free(tf->mosaic);
+        free(tf->mosaic);
     }
 
-    if (fread(tf->x, sizeof(double), tf->x_size, tf_fp) != tf->x_size)
+    if (tf->coarser != NULL)
     {
-        fprintf(stderr, "tf_open: fread() x\n");
-        return EXIT_FAILURE;
+        tf_free(tf->coarser);
+        free(tf->coarser);
     }
 
-    tf->h = malloc(tf->y_size * sizeof(double *));
-    if (tf->h == NULL)
+    _tf_coefficients_free(tf);
+
+    if (tf->file.map == NULL || tf->layout == GRID_LAYOUT_TILES)
+        free(tf->h);
+
+    if (tf->file.map != NULL)
+    {
+        grid_file_unmap(&tf->file);
+    }
+    else
+    {
+        free(tf->x);
+        free(tf->y);
+    }
+
+    tf_zero(tf);
+}
+
+// Level below tf, from 2x2 blocks of its heights
+int _tf_build_level(terrain_file_t *tf, tf_pyramid_t mode, terrain_file_t *level)
+{
+    tf_zero(level);
+    level->y_size = tf->y_size / 2;
+    level->x_size = tf->x_size / 2;
+    level->stride = level->x_size;
+
+    level->y = malloc(level->y_size * sizeof(double));
+    level->x = malloc(level->x_size * sizeof(double));
+    level->h = malloc((size_t)level->y_size * level->x_size * sizeof(double));
+    if (level->y == NULL || level->x == NULL || level->h == NULL)
     {
-        fprintf(stderr, "tf_open: malloc() h\n");
+        fprintf(stderr, "_tf_build_level: malloc()\n");
+        tf_free(level);
         return EXIT_FAILURE;
     }
 
-    for (int i = 0; i < tf->y_size; i++)
+    for (int i = 0; i < level->y_size; i++)
+        level->y[i] = (tf->y[2 * i] + tf->y[2 * i + 1]) / 2;
+    for (int j = 0; j < level->x_size; j++)
+        level->x[j] = (tf->x[2 * j] + tf->x[2 * j + 1]) / 2;
+    grid_axis_init(&level->y_axis, level->y, level->y_size);
+    grid_axis_init(&level->x_axis, level->x, level->x_size);
+
+    double *h = level->h;
+    for (int i = 0; i < level->y_size; i++)
     {
-        tf->h[i] = malloc(tf->x_size * sizeof(double));
-        if (tf->h[i] == NULL)
+        for (int j = 0; j < level->x_size; j++)
         {
-            fprintf(stderr, "tf_open: malloc() h @ y=%f\n", tf->y[i]);
+            double sum = 0.0, max = NEGATIVE_INFINITY;
+            int count = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                double v = tf_height(tf, 2 * i + k / 2, 2 * j + k % 2);
+                if (!c_isnan(v))
+                {
+                    sum += v;
+                    max = c_max(max, v);
+                    count++;
+                }
+            }
+
+            if (count == 0)
+                h[(size_t)i * level->stride + j] = NAN;
+            else
+                h[(size_t)i * level->stride + j] = (mode == TF_PYRAMID_MAX) ? max : sum / count;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int tf_build_pyramid(terrain_file_t *tf, tf_pyramid_t mode)
+{
+    if (mode == TF_PYRAMID_NONE)
+        return EXIT_SUCCESS;
+
+    terrain_file_t *finer = tf;
+    for (int l = 0; l < TF_PYRAMID_LEVELS; l++)
+    {
+        if (finer->y_size / 2 < PYRAMID_MIN_SIZE || finer->x_size / 2 < PYRAMID_MIN_SIZE)
+            break;
+
+        terrain_file_t *level = malloc(sizeof(terrain_file_t));
+        if (level == NULL)
+        {
+            fprintf(stderr, "tf_build_pyramid: malloc() level\n");
             return EXIT_FAILURE;
         }
 
-        if (fread(tf->h[i], sizeof(double), tf->x_size, tf_fp) != tf->x_size)
+        if (_tf_build_level(finer, mode, level) != EXIT_SUCCESS)
         {
-            fprintf(stderr, "tf_open: fread() h @ y=%f\n", tf->y[i]);
+            fprintf(stderr, "tf_build_pyramid: _tf_build_level() %d\n", l + 1);
+            free(level);
             return EXIT_FAILURE;
         }
-    }
 
-    if (fclose(tf_fp))
-    {
-        fprintf(stderr, "tf_open: fclose()\n");
-        return EXIT_FAILURE;
+        finer->coarser = level;
+        finer = level;
     }
 
     return EXIT_SUCCESS;
 }
 
-void tf_free(terrain_file_t *tf)
+// Largest distance between neighbouring ticks of either axis
+double _tf_spacing(const terrain_file_t *tf)
 {
-    if (tf->x != NULL)
-        free(tf->x);
+    double x_spacing = (tf->x_size > 1) ? (tf->x[tf->x_size - 1] - tf->x[0]) / (tf->x_size - 1) : 0.0;
+    double y_spacing = (tf->y_size > 1) ? (tf->y[tf->y_size - 1] - tf->y[0]) / (tf->y_size - 1) : 0.0;
+    return c_max(x_spacing, y_spacing);
+}
 
-    if (tf->y != NULL)
-        free(tf->y);
+terrain_file_t *tf_level(terrain_file_t *tf, double spacing)
+{
+    terrain_file_t *level = tf;
+    while (level->coarser != NULL && _tf_spacing(level->coarser) <= spacing)
+        level = level->coarser;
 
-    if (tf->h != NULL)
-    {
-        for (int i = 0; i < tf->x_size; i++)
-            free(tf->h[i]);
-        free(tf->h);
-    }
+    return level;
+}
 
-    tf_zero(tf);
+int tf_pyramid_parse(const char *name, tf_pyramid_t *mode)
+{
+    if (strcmp(name, PYRAMID_NAME_NONE) == 0)
+        *mode = TF_PYRAMID_NONE;
+    else if (strcmp(name, PYRAMID_NAME_MEAN) == 0)
+        *mode = TF_PYRAMID_MEAN;
+    else if (strcmp(name, PYRAMID_NAME_MAX) == 0)
+        *mode = TF_PYRAMID_MAX;
+    else
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
 }
 
 double tf_get_nn(terrain_file_t *tf, const double x, const double y)
 {
-    int closest_x_index;
-    double closest_x = nneighbor(tf->x, tf->x_size, x, &closest_x_index);
+    int closest_x_index = grid_axis_nearest(&tf->x_axis, tf->x, tf->x_size, x);
+    int closest_y_index = grid_axis_nearest(&tf->y_axis, tf->y, tf->y_size, y);
 
-    int closest_y_index;
-    double closest_y = nneighbor(tf->y, tf->y_size, y, &closest_y_index);
-
-    return tf->h[closest_y_index][closest_x_index];
+    return tf_height(tf, closest_y_index, closest_x_index);
 }
 
 double tf_get_bilinear(terrain_file_t *tf, const double x, const double y)
 {
-    int x1_index;
-    double x1 = nneighbor(tf->x, tf->x_size, x, &x1_index);
-    if (x1 > x)
-    {
-        x1_index--;
-        if (x1_index < 0)
-            return NAN;
-        x1 = tf->x[x1_index];
-    }
+    int x1_index = grid_axis_floor(&tf->x_axis, tf->x, tf->x_size, x);
+    if (x1_index < 0)
+        return NAN;
+    double x1 = tf->x[x1_index];
 
     int x2_index = x1_index + 1;
     if (x2_index >= tf->x_size)
         return NAN;
     double x2 = tf->x[x2_index];
 
-    int y1_index;
-    double y1 = nneighbor(tf->y, tf->y_size, y, &y1_index);
-    if (y1 > y)
-    {
-        y1_index--;
-        if (y1_index < 0)
-            return NAN;
-        y1 = tf->y[y1_index];
-    }
+    int y1_index = grid_axis_floor(&tf->y_axis, tf->y, tf->y_size, y);
+    if (y1_index < 0)
+        return NAN;
+    double y1 = tf->y[y1_index];
 
     int y2_index = y1_index + 1;
     if (y2_index >= tf->y_size)
         return NAN;
     double y2 = tf->y[y2_index];
 
-    double h11 = tf->h[y1_index][x1_index];
-    double h12 = tf->h[y1_index][x2_index];
-    double h21 = tf->h[y2_index][x1_index];
-    double h22 = tf->h[y2_index][x2_index];
+    double h11 = tf_height(tf, y1_index, x1_index);
+    double h12 = tf_height(tf, y1_index, x2_index);
+    double h21 = tf_height(tf, y2_index, x1_index);
+    double h22 = tf_height(tf, y2_index, x2_index);
 
     double h1 = h11 + (h12 - h11) * (x - x1) / (x2 - x1);
     double h2 = h21 + (h22 - h21) * (x - x1) / (x2 - x1);
@@ -441,95 +640,403 @@ double tf_get_bilinear(terrain_file_t *tf, const double x, const double y)
     return h;
 }
 
+// Coefficients c[i] of x^i of the cubic through A, B, C, D, between B at x = 0 and C at x = 1
+void _tf_cubic_coefficients(double A, double B, double C, double D, double *c)
+{
+    c[3] = -A / 2 + (3 * B) / 2 - (3 * C) / 2 + D / 2;
+    c[2] = A - (5 * B) / 2 + 2 * C - D / 2;
+    c[1] = -A / 2 + C / 2;
+    c[0] = B;
+}
+
 double _tf_cubic(double A, double B, double C, double D, double x)
 {
-    float p = -A / 2 + (3 * B) / 2 - (3 * C) / 2 + D / 2;
-    float q = A - (5 * B) / 2 + 2 * C - D / 2;
-    float r = -A / 2 + C / 2;
-    float s = B;
-    return x * (x * (p * x + q) + r) + s;
+    double c[4];
+    _tf_cubic_coefficients(A, B, C, D, c);
+    return x * (x * (c[3] * x + c[2]) + c[1]) + c[0];
 }
 
-double tf_get_bicubic(terrain_file_t *tf, const double x, const double y)
+// Four cubics run side by side, one per lane
+#if defined(__GNUC__)
+typedef double _tf_lanes_t __attribute__((vector_size(4 * sizeof(double))));
+#endif
+
+// Heights h[c][r] of the 4x4 block from row yi, column xi, addressed once when the
+// block lies within a tile or the grid is in rows
+void _tf_gather(terrain_file_t *tf, int yi, int xi, double h[4][4])
 {
-    int x2_index;
-    double x2 = nneighbor(tf->x, tf->x_size, x, &x2_index);
-    if (x2 > x)
+    size_t index;
+    int pitch;
+    if (grid_layout_block(tf->layout, tf->stride, tf->tiles_x, yi, xi, 4, &index, &pitch))
+    {
+        for (int r = 0; r < 4; r++)
+            for (int c = 0; c < 4; c++)
+                h[c][r] = tf_sample(tf, index + (size_t)r * pitch + c);
+    }
+    else
     {
-        x2_index--;
-        if (x2_index < 0)
-            return NAN;
-        x2 = tf->x[x2_index];
+        for (int r = 0; r < 4; r++)
+            for (int c = 0; c < 4; c++)
+                h[c][r] = tf_height(tf, yi + r, xi + c);
     }
+}
 
-    int x1_index = x2_index - 1;
-    if (x1_index < 0)
-        return NAN;
-    double x1 = tf->x[x1_index];
+// Coefficients of the bicubic polynomial of cell xi, yi, NAN outside the grid
+void _tf_cell_coefficients(terrain_file_t *tf, int xi, int yi, double *a)
+{
+    if (xi < 1 || xi + 2 >= tf->x_size || yi < 1 || yi + 2 >= tf->y_size)
+    {
+        for (int k = 0; k < TF_CELL_COEFFICIENTS; k++)
+            a[k] = NAN;
+        return;
+    }
 
-    int x3_index = x2_index + 1;
-    if (x3_index >= tf->x_size)
-        return NAN;
-    double x3 = tf->x[x3_index];
+    double h[4][4];
+    _tf_gather(tf, yi - 1, xi - 1, h);
 
-    int x4_index = x3_index + 1;
-    if (x4_index >= tf->x_size)
-        return NAN;
-    double x4 = tf->x[x4_index];
+    // Along x, the cubics of rows yi - 1 .. yi + 2
+    double row[4][4];
+    for (int r = 0; r < 4; r++)
+        _tf_cubic_coefficients(h[0][r], h[1][r], h[2][r], h[3][r], row[r]);
+
+    // Along y, the cubic of each power of x
+    for (int i = 0; i < 4; i++)
+        _tf_cubic_coefficients(row[0][i], row[1][i], row[2][i], row[3][i], a + i * 4);
+}
+
+double _tf_cell_polynomial(const double *a, double tx, double ty)
+{
+#if defined(__GNUC__)
+    _tf_lanes_t c0, c1, c2, c3;
+    memcpy(&c0, a, sizeof(_tf_lanes_t));
+    memcpy(&c1, a + 4, sizeof(_tf_lanes_t));
+    memcpy(&c2, a + 8, sizeof(_tf_lanes_t));
+    memcpy(&c3, a + 12, sizeof(_tf_lanes_t));
+    _tf_lanes_t v = ((c3 * tx + c2) * tx + c1) * tx + c0;
+#else
+    double v[4];
+    for (int j = 0; j < 4; j++)
+        v[j] = ((a[12 + j] * tx + a[8 + j]) * tx + a[4 + j]) * tx + a[j];
+#endif
+    return ((v[3] * ty + v[2]) * ty + v[1]) * ty + v[0];
+}
+
+// Coefficients of cell xi, yi, building its tile if needed, NULL once the budget is spent
+const double *_tf_coefficients_cell(terrain_file_t *tf, int xi, int yi)
+{
+    tf_coefficients_t *coefficients = tf->coefficients;
+    int tile_index = (yi / TF_COEFFICIENT_TILE) * coefficients->tiles_x + xi / TF_COEFFICIENT_TILE;
+    size_t cell_index = (size_t)(yi % TF_COEFFICIENT_TILE) * TF_COEFFICIENT_TILE + xi % TF_COEFFICIENT_TILE;
 
-    int y2_index;
-    double y2 = nneighbor(tf->y, tf->y_size, y, &y2_index);
-    if (y2 > y)
+    double *tile = atomic_load_explicit(&coefficients->tile[tile_index], memory_order_acquire);
+    if (tile != NULL)
+        return tile + cell_index * TF_CELL_COEFFICIENTS;
+
+    if (atomic_load_explicit(&coefficients->full, memory_order_relaxed))
+        return NULL;
+
+    size_t tile_size = (size_t)TF_COEFFICIENT_TILE * TF_COEFFICIENT_TILE * TF_CELL_COEFFICIENTS * sizeof(double);
+    if (atomic_fetch_add(&coefficients->used, tile_size) + tile_size > coefficients->budget)
     {
-        y2_index--;
-        if (y2_index < 0)
-            return NAN;
-        y2 = tf->y[y2_index];
+        atomic_fetch_sub(&coefficients->used, tile_size);
+        atomic_store_explicit(&coefficients->full, true, memory_order_relaxed);
+        return NULL;
     }
 
-    int y1_index = y2_index - 1;
-    if (y1_index < 0)
-        return NAN;
-    double y1 = tf->y[y1_index];
+    tile = malloc(tile_size);
+    if (tile == NULL)
+    {
+        atomic_fetch_sub(&coefficients->used, tile_size);
+        atomic_store_explicit(&coefficients->full, true, memory_order_relaxed);
+        return NULL;
+    }
+
+    int x0 = xi - xi % TF_COEFFICIENT_TILE;
+    int y0 = yi - yi % TF_COEFFICIENT_TILE;
+    for (int r = 0; r < TF_COEFFICIENT_TILE; r++)
+        for (int c = 0; c < TF_COEFFICIENT_TILE; c++)
+            _tf_cell_coefficients(tf, x0 + c, y0 + r, tile + ((size_t)r * TF_COEFFICIENT_TILE + c) * TF_CELL_COEFFICIENTS);
+
+    // Another thread may have built the same tile meanwhile
+    double *expected = NULL;
+    if (!atomic_compare_exchange_strong(&coefficients->tile[tile_index], &expected, tile))
+    {
+        free(tile);
+        atomic_fetch_sub(&coefficients->used, tile_size);
+        tile = expected;
+    }
+
+    return tile + cell_index * TF_CELL_COEFFICIENTS;
+}
+
+void _tf_coefficients_free(terrain_file_t *tf)
+{
+    if (tf->coefficients == NULL)
+        return;
+
+    for (int i = 0; i < tf->coefficients->tiles_x * tf->coefficients->tiles_y; i++)
+        free(atomic_load(&tf->coefficients->tile[i]));
+    free(tf->coefficients->tile);
+    free(tf->coefficients);
+    tf->coefficients = NULL;
+}
+
+int tf_coefficients_enable(terrain_file_t *tf, size_t budget)
+{
+    if (tf->coefficients != NULL && tf->coefficients->budget == budget)
+        return EXIT_SUCCESS;
+
+    _tf_coefficients_free(tf);
+    if (budget == 0)
+        return EXIT_SUCCESS;
+
+    tf_coefficients_t *coefficients = malloc(sizeof(tf_coefficients_t));
+    if (coefficients == NULL)
+    {
+        fprintf(stderr, "tf_coefficients_enable: malloc() coefficients\n");
+        return EXIT_FAILURE;
+    }
+
+    coefficients->tiles_x = (tf->x_size + TF_COEFFICIENT_TILE - 1) / TF_COEFFICIENT_TILE;
+    coefficients->tiles_y = (tf->y_size + TF_COEFFICIENT_TILE - 1) / TF_COEFFICIENT_TILE;
+    coefficients->budget = budget;
+    atomic_init(&coefficients->used, 0);
+    atomic_init(&coefficients->full, false);
+
+    int tiles = coefficients->tiles_x * coefficients->tiles_y;
+    coefficients->tile = malloc(tiles * sizeof(coefficients->tile[0]));
+    if (coefficients->tile == NULL)
+    {
+        fprintf(stderr, "tf_coefficients_enable: malloc() tile\n");
+        free(coefficients);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < tiles; i++)
+        atomic_init(&coefficients->tile[i], NULL);
 
-    int y3_index = y2_index + 1;
-    if (y3_index >= tf->y_size)
+    tf->coefficients = coefficients;
+    return EXIT_SUCCESS;
+}
+
+size_t tf_coefficients_used(const terrain_file_t *tf)
+{
+    return (tf->coefficients != NULL) ? atomic_load(&tf->coefficients->used) : 0;
+}
+
+// A bicubic cell, between ticks xi, xi + 1 and yi, yi + 1. Its polynomial comes from the
+// precomputed coefficients if there are any, otherwise from the cubic coefficients
+// along x of its four rows yi - 1 .. yi + 2
+typedef struct
+{
+    int xi;
+    int yi;
+    bool inside; // the 4x4 neighbourhood lies inside the grid
+    double x2, x3;
+    double y2, y3;
+    const double *a; // precomputed coefficients, NULL when not available
+#if defined(__GNUC__)
+    _tf_lanes_t p, q, r, s;
+#else
+    double h[4][4]; // h[column][row]
+#endif
+} _tf_cell_t;
+
+void _tf_cell_load(terrain_file_t *tf, int xi, int yi, _tf_cell_t *cell)
+{
+    cell->xi = xi;
+    cell->yi = yi;
+    cell->inside = xi >= 1 && xi + 2 < tf->x_size && yi >= 1 && yi + 2 < tf->y_size;
+    if (!cell->inside)
+        return;
+
+    cell->x2 = tf->x[xi];
+    cell->x3 = tf->x[xi + 1];
+    cell->y2 = tf->y[yi];
+    cell->y3 = tf->y[yi + 1];
+
+    cell->a = (tf->coefficients != NULL) ? _tf_coefficients_cell(tf, xi, yi) : NULL;
+    if (cell->a != NULL)
+        return;
+
+#if defined(__GNUC__)
+    double h[4][4];
+    _tf_gather(tf, yi - 1, xi - 1, h);
+
+    _tf_lanes_t column[4];
+    for (int c = 0; c < 4; c++)
+        memcpy(&column[c], h[c], sizeof(_tf_lanes_t));
+
+    // _tf_cubic_coefficients(), the same operations lane by lane
+    _tf_lanes_t A = column[0], B = column[1], C = column[2], D = column[3];
+    cell->p = -A / 2 + (3 * B) / 2 - (3 * C) / 2 + D / 2;
+    cell->q = A - (5 * B) / 2 + 2 * C - D / 2;
+    cell->r = -A / 2 + C / 2;
+    cell->s = B;
+#else
+    _tf_gather(tf, yi - 1, xi - 1, cell->h);
+#endif
+}
+
+double _tf_cell_bicubic(const _tf_cell_t *cell, const double x, const double y)
+{
+    if (!cell->inside)
         return NAN;
-    double y3 = tf->y[y3_index];
 
-    int y4_index = y3_index + 1;
-    if (y4_index >= tf->y_size)
+    double tx = (x - cell->x2) / (cell->x3 - cell->x2);
+    double ty = (y - cell->y2) / (cell->y3 - cell->y2);
+    if (cell->a != NULL)
+        return _tf_cell_polynomial(cell->a, tx, ty);
+
+#if defined(__GNUC__)
+    _tf_lanes_t h = tx * (tx * (cell->p * tx + cell->q) + cell->r) + cell->s;
+#else
+    double h[4];
+    for (int r = 0; r < 4; r++)
+        h[r] = _tf_cubic(cell->h[0][r], cell->h[1][r], cell->h[2][r], cell->h[3][r], tx);
+#endif
+
+    return _tf_cubic(h[0], h[1], h[2], h[3], ty);
+}
+
+double tf_get_bicubic(terrain_file_t *tf, const double x, const double y)
+{
+    _tf_cell_t cell;
+    _tf_cell_load(tf, grid_axis_floor(&tf->x_axis, tf->x, tf->x_size, x),
+                  grid_axis_floor(&tf->y_axis, tf->y, tf->y_size, y), &cell);
+
+    return _tf_cell_bicubic(&cell, x, y);
+}
+
+// Start loading the 4x4 neighbourhood of cell xi, yi into the cache
+void _tf_prefetch(terrain_file_t *tf, int xi, int yi)
+{
+#if defined(__GNUC__)
+    if (xi < 1 || xi + 2 >= tf->x_size || yi < 1 || yi + 2 >= tf->y_size)
+        return;
+
+    size_t sample_size = grid_file_sample_size(tf->type);
+    for (int r = -1; r <= 2; r++)
+    {
+        __builtin_prefetch((const char *)tf->h + grid_layout_index(tf->layout, tf->stride, tf->tiles_x, yi + r, xi - 1) * sample_size);
+        __builtin_prefetch((const char *)tf->h + grid_layout_index(tf->layout, tf->stride, tf->tiles_x, yi + r, xi + 2) * sample_size);
+    }
+#endif
+}
+
+// Points first .. last - 1 of tf_sample_line() from this grid alone
+void _tf_sample_range(terrain_file_t *tf, const double x1, const double y1, const double x2, const double y2, int n,
+                      int first, int last, double *h)
+{
+    _tf_cell_t cell;
+    cell.xi = cell.yi = -1;
+    cell.inside = false;
+
+    for (int i = first; i < last; i++)
+    {
+        double t = (n > 1) ? i / (n - 1.0) : 0.0;
+        double x = x1 + (x2 - x1) * t;
+        double y = y1 + (y2 - y1) * t;
+
+        int xi = grid_axis_step(&tf->x_axis, tf->x, tf->x_size, cell.xi, x);
+        int yi = grid_axis_step(&tf->y_axis, tf->y, tf->y_size, cell.yi, y);
+        if (xi != cell.xi || yi != cell.yi)
+        {
+            _tf_cell_load(tf, xi, yi, &cell);
+
+            if (i + PREFETCH_AHEAD < n && tf->coefficients == NULL)
+            {
+                double ahead = (i + PREFETCH_AHEAD) / (n - 1.0);
+                _tf_prefetch(tf, grid_axis_floor(&tf->x_axis, tf->x, tf->x_size, x1 + (x2 - x1) * ahead),
+                             grid_axis_floor(&tf->y_axis, tf->y, tf->y_size, y1 + (y2 - y1) * ahead));
+            }
+        }
+
+        h[i] = _tf_cell_bicubic(&cell, x, y);
+    }
+}
+
+// Bicubic interpolation at x, y from the 4x4 neighbourhood gathered across the tiles of a mosaic
+double _tf_mosaic_bicubic(grid_mosaic_t *m, const double x, const double y)
+{
+    double xs[4], ys[4], v[4][4]; // v[row][column]
+    if (grid_mosaic_gather(m, x, y, 1, 4, xs, ys, &v[0][0]) != EXIT_SUCCESS)
         return NAN;
-    double y4 = tf->y[y4_index];
 
-    double h11 = tf->h[y1_index][x1_index];
-    double h12 = tf->h[y2_index][x1_index];
-    double h13 = tf->h[y3_index][x1_index];
-    double h14 = tf->h[y4_index][x1_index];
+    double tx = (x - xs[1]) / (xs[2] - xs[1]);
+    double ty = (y - ys[1]) / (ys[2] - ys[1]);
+    double h[4];
+    for (int r = 0; r < 4; r++)
+        h[r] = _tf_cubic(v[r][0], v[r][1], v[r][2], v[r][3], tx);
+
+    return _tf_cubic(h[0], h[1], h[2], h[3], ty);
+}
+
+// tf_sample_line() of a mosaic, one run of points inside the same tile at a time
+void _tf_mosaic_sample_line(terrain_file_t *tf, const double x1, const double y1, const double x2, const double y2,
+                            int n, double *h)
+{
+    grid_mosaic_t *m = tf->mosaic;
+
+    int i = 0;
+    while (i < n)
+    {
+        double t = (n > 1) ? i / (n - 1.0) : 0.0;
+        double x = x1 + (x2 - x1) * t;
+        double y = y1 + (y2 - y1) * t;
+
+        // A point near the edges of every tile holding it, or between tiles, takes its
+        // neighbourhood from all the tiles around it
+        int tile = grid_mosaic_find(m, x, y);
+        if (tile < 0 || !grid_mosaic_inside(m, tile, x, y))
+        {
+            h[i++] = _tf_mosaic_bicubic(m, x, y);
+            continue;
+        }
 
-    double h21 = tf->h[y1_index][x2_index];
-    double h22 = tf->h[y2_index][x2_index];
-    double h23 = tf->h[y3_index][x2_index];
-    double h24 = tf->h[y4_index][x2_index];
+        int last = i + 1;
+        while (last < n)
+        {
+            double t_last = (n > 1) ? last / (n - 1.0) : 0.0;
+            if (!grid_mosaic_inside(m, tile, x1 + (x2 - x1) * t_last, y1 + (y2 - y1) * t_last))
+                break;
+            last++;
+        }
 
-    double h31 = tf->h[y1_index][x3_index];
-    double h32 = tf->h[y2_index][x3_index];
-    double h33 = tf->h[y3_index][x3_index];
-    double h34 = tf->h[y4_index][x3_index];
+        terrain_file_t *grid = grid_mosaic_acquire(m, tile);
+        if (grid != NULL)
+        {
+            _tf_sample_range(grid, x1, y1, x2, y2, n, i, last, h);
+            grid_mosaic_release(m, tile);
+        }
+        else
+        {
+            for (int k = i; k < last; k++)
+                h[k] = NAN;
+        }
 
-    double h41 = tf->h[y1_index][x4_index];
-    double h42 = tf->h[y2_index][x4_index];
-    double h43 = tf->h[y3_index][x4_index];
-    double h44 = tf->h[y4_index][x4_index];
+        i = last;
+    }
+}
 
-    double tx = (x - x2) / (x3 - x2);
-    double h1 = _tf_cubic(h11, h21, h31, h41, tx);
-    double h2 = _tf_cubic(h12, h22, h32, h42, tx);
-    double h3 = _tf_cubic(h13, h23, h33, h43, tx);
-    double h4 = _tf_cubic(h14, h24, h34, h44, tx);
+void tf_sample_line(terrain_file_t *tf, const double x1, const double y1, const double x2, const double y2, int n,
+                    double *h)
+{
+    if (tf->mosaic != NULL)
+    {
+        _tf_mosaic_sample_line(tf, x1, y1, x2, y2, n, h);
+        return;
+    }
 
-    double ty = (y - y2) / (y3 - y2);
-    double h = _tf_cubic(h1, h2, h3, h4, ty);
+    terrain_file_t *level = tf;
+    int near = n;
+    if (tf->coarser != NULL && n > 1)
+    {
+        double spacing = c_sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)) / (n - 1);
+        level = tf_level(tf, spacing);
+        if (level != tf)
+            near = (int)c_min(n, c_floor(tf->pyramid_near / spacing) + 1);
+    }
 
-    return h;
+    _tf_sample_range(tf, x1, y1, x2, y2, n, 0, near, h);
+    _tf_sample_range(level, x1, y1, x2, y2, n, near, n, h);
 }
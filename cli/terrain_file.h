@@ -1,15 +1,103 @@
 #ifndef TERRAIN_FILE_H
 #define TERRAIN_FILE_H
 
+#include "grid_file.h"
+#include "grid_axis.h"
+#include "grid_layout.h"
+#include "grid_mosaic.h"
+#include "c1812/custom_math.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Cells along each side of a tile of precomputed bicubic coefficients
+#define TF_COEFFICIENT_TILE 64
+
+// Coefficients of one cell, a[i * 4 + j] of tx^i * ty^j
+#define TF_CELL_COEFFICIENTS 16
+
+// Levels of a terrain pyramid below the full resolution grid, at most
+#define TF_PYRAMID_LEVELS 8
+
+// How the heights of a coarser pyramid level are made from 2x2 heights of the finer one
+typedef enum
+{
+    TF_PYRAMID_NONE, // no pyramid
+    TF_PYRAMID_MEAN, // mean height
+    TF_PYRAMID_MAX,  // highest height, obstructions are kept
+} tf_pyramid_t;
+
+/*
+ * Bicubic polynomial coefficients of the cells of a terrain grid, built tile by tile
+ * the first time a sampler enters a tile and shared by all threads
+ */
 typedef struct
 {
-    int y_size; // rows
-    int x_size; // columns
-    double *y;  // y axis ticks
-    double *x;  // x axis ticks
-    double **h; // grid of height values, h[y][x]
+    int tiles_x;             // tiles along x
+    int tiles_y;             // tiles along y
+    size_t budget;           // bytes the tiles may take
+    atomic_size_t used;      // bytes taken by built tiles
+    atomic_bool full;        // a tile was refused for lack of budget
+    _Atomic(double *) *tile; // tile[ty * tiles_x + tx], NULL until built
+} tf_coefficients_t;
+
+typedef struct terrain_file
+{
+    int y_size;  // rows
+    int x_size;  // columns
+    int stride;  // samples from the start of one row of h to the next, GRID_LAYOUT_ROWS
+    int tiles_x; // tiles along x, GRID_LAYOUT_TILES
+    double *y;   // y axis ticks
+    double *x;   // x axis ticks
+    grid_axis_t y_axis; // lookup of y on the y ticks
+    grid_axis_t x_axis; // lookup of x on the x ticks
+    grid_sample_type_t type; // type of the samples of h
+    double scale;  // height step between GRID_SAMPLE_I16 samples
+    double offset; // height of GRID_SAMPLE_I16 sample 0
+    double nodata; // sample standing for a missing height
+    grid_layout_t layout; // order of the samples of h
+    void *h;       // grid of height samples, allocated unless it points into the mapping
+    grid_file_t file; // mapping y, x and h point into, file.map is NULL when they are allocated
+    tf_coefficients_t *coefficients; // precomputed bicubic coefficients, NULL when disabled
+    struct terrain_file *coarser;    // next pyramid level, half the resolution, NULL when there is none
+    double pyramid_near;             // distance [m] from the start of a profile sampled at full resolution
+    grid_mosaic_t *mosaic;           // tiles sampled by tf_sample_line() in place of this grid, NULL for a single grid
 } terrain_file_t;
 
+/**
+ * @brief Height of sample i of h, NAN where it is missing.
+ */
+static inline double tf_sample(const terrain_file_t *tf, size_t i)
+{
+    switch (tf->type)
+    {
+    case GRID_SAMPLE_F32:
+    {
+        float h = ((const float *)tf->h)[i];
+        return (h == tf->nodata) ? NAN : h;
+    }
+    case GRID_SAMPLE_I16:
+    {
+        int16_t h = ((const int16_t *)tf->h)[i];
+        return (h == tf->nodata) ? NAN : tf->offset + h * tf->scale;
+    }
+    default:
+    {
+        double h = ((const double *)tf->h)[i];
+        return (h == tf->nodata) ? NAN : h;
+    }
+    }
+}
+
+/**
+ * @brief Height at row yi, column xi, NAN where it is missing.
+ */
+static inline double tf_height(const terrain_file_t *tf, int yi, int xi)
+{
+    return tf_sample(tf, grid_layout_index(tf->layout, tf->stride, tf->tiles_x, yi, xi));
+}
+
 /**
  * @brief Clear terrain file structure.
  *
@@ -28,24 +116,52 @@ void tf_zero(terrain_file_t *tf);
 int tf_parse(terrain_file_t *tf, const char *path);
 
 /**
- * @brief Store terrain file to disk.
+ * @brief Store terrain file to disk, in the page-aligned version 3 layout.
+ *
+ * GRID_SAMPLE_I16 heights are stored in steps of 0.1 m, or of whatever larger step
+ * fits the height range into 16 bits.
  *
  * @param tf Pointer to terrain_file_t structure.
  * @param path Path to terrain file.
+ * @param type Sample type to store the heights as, GRID_SAMPLE_F64, GRID_SAMPLE_F32 or GRID_SAMPLE_I16.
  *
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
  */
-int tf_store(terrain_file_t *tf, const char *path);
+int tf_store(terrain_file_t *tf, const char *path, grid_sample_type_t type);
 
 /**
  * @brief Open terrain file from disk.
  *
+ * The file is mapped read-only and used in place, version 1 and 2 layouts alike. With a
+ * window only the samples around it are mapped, enough for bicubic interpolation anywhere
+ * inside it; x and y keep the coordinates of the file.
+ *
  * @param tf Pointer to terrain_file_t structure.
  * @param path Path to terrain file.
+ * @param window Area of interest, NULL for the whole file.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int tf_open(terrain_file_t *tf, const char *path, const grid_window_t *window);
+
+/**
+ * @brief Open terrain files as the tiles of a mosaic.
+ *
+ * Only the headers are read here; tiles are mapped when a line is first sampled from them
+ * and at most capacity of them are kept mapped. Where tiles overlap, the first one that
+ * holds the whole neighbourhood of a point is sampled; near the edges of abutting tiles or
+ * tiles sharing an edge, the neighbourhood is gathered tick by tick across them, so the
+ * tiles must continue each other's evenly spaced ticks. A mosaic is sampled by
+ * tf_sample_line() only.
+ *
+ * @param tf Pointer to terrain_file_t structure.
+ * @param paths Paths to the terrain files of the tiles.
+ * @param count Number of tiles.
+ * @param capacity Tiles kept mapped at most.
  *
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
  */
-int tf_open(terrain_file_t *tf, const char *path);
+int tf_open_mosaic(terrain_file_t *tf, char **paths, int count, int capacity);
 
 /**
  * @brief Deallocate and clear terrain_file_t structure.
@@ -54,6 +170,78 @@ int tf_open(terrain_file_t *tf, const char *path);
  */
 void tf_free(terrain_file_t *tf);
 
+/**
+ * @brief Rearrange the heights into GRID_LAYOUT_TILES.
+ *
+ * The samples are copied, a mapped file stays mapped for the axes.
+ *
+ * @param tf Pointer to terrain_file_t structure, in GRID_LAYOUT_ROWS.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int tf_tile(terrain_file_t *tf);
+
+/**
+ * @brief Build the levels of a terrain pyramid, each half the resolution of the one before.
+ *
+ * Levels are built until a side would fall below 4 samples, or TF_PYRAMID_LEVELS of them.
+ * Missing heights are left out of a mean or maximum, a sample is missing only if all
+ * four of its heights are.
+ *
+ * @param tf Pointer to terrain_file_t structure without pyramid levels.
+ * @param mode How coarser heights are made, TF_PYRAMID_NONE to build nothing.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int tf_build_pyramid(terrain_file_t *tf, tf_pyramid_t mode);
+
+/**
+ * @brief Coarsest pyramid level whose tick spacing is at most the given spacing.
+ *
+ * @param tf Pointer to terrain_file_t structure, the full resolution level.
+ * @param spacing Distance between samples [m].
+ *
+ * @return The level, tf itself when no coarser level fits.
+ */
+terrain_file_t *tf_level(terrain_file_t *tf, double spacing);
+
+/**
+ * @brief Parse a pyramid mode name: none, mean or max.
+ *
+ * @param name Mode name.
+ * @param mode Set to the parsed mode.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE for an unknown name.
+ */
+int tf_pyramid_parse(const char *name, tf_pyramid_t *mode);
+
+/**
+ * @brief Set the memory budget for precomputed bicubic coefficients.
+ *
+ * Tiles of TF_COEFFICIENT_TILE x TF_COEFFICIENT_TILE cells are built when the bicubic
+ * samplers first need them, at TF_CELL_COEFFICIENTS doubles per cell. Each sample
+ * in a built tile is then one polynomial evaluation. Once the budget is spent, the
+ * remaining cells are sampled from the heights as usual. Results match those without
+ * precomputation to within rounding.
+ *
+ * Not thread-safe against samplers of the same terrain file.
+ *
+ * @param tf Pointer to terrain_file_t structure.
+ * @param budget Bytes the coefficients may take, 0 to disable them.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int tf_coefficients_enable(terrain_file_t *tf, size_t budget);
+
+/**
+ * @brief Bytes taken by the precomputed bicubic coefficients.
+ *
+ * @param tf Pointer to terrain_file_t structure.
+ *
+ * @return Bytes taken, 0 when disabled.
+ */
+size_t tf_coefficients_used(const terrain_file_t *tf);
+
 /**
  * @brief Get nearest known height to the given x, y coordinates.
  *
@@ -87,4 +275,26 @@ double tf_get_bilinear(terrain_file_t *tf, const double x, const double y);
  */
 double tf_get_bicubic(terrain_file_t *tf, const double x, const double y);
 
+/**
+ * @brief Bicubically interpolated heights at n evenly spaced points from x1, y1 to x2, y2.
+ *
+ * Point i lies at fraction i / (n - 1) of the way. The points are walked cell by cell,
+ * so the 4x4 neighbourhood is gathered once per cell rather than once per point. The
+ * heights equal those of tf_get_bicubic() at the same points.
+ *
+ * With a pyramid, points farther than tf->pyramid_near from x1, y1 are sampled from
+ * tf_level() of the spacing between points. A mosaic samples each run of points inside
+ * one tile from that tile. Safe to call from several threads at once.
+ *
+ * @param tf The terrain_file_t structure to sample.
+ * @param x1 The x coordinate of the first point.
+ * @param y1 The y coordinate of the first point.
+ * @param x2 The x coordinate of the last point.
+ * @param y2 The y coordinate of the last point.
+ * @param n Number of points.
+ * @param h Set to the n heights, NAN where the neighbourhood leaves the grid.
+ */
+void tf_sample_line(terrain_file_t *tf, const double x1, const double y1, const double x2, const double y2, int n,
+                    double *h);
+
 #endif
\ No newline at end of file
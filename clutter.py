@@ -8,6 +8,47 @@ import scipy.ndimage
 
 import struct
 
+GRID_MAGIC_TERRAIN = b'C1812TF\0'
+GRID_MAGIC_CLUTTER = b'C1812CF\0'
+GRID_VERSION = 3
+GRID_BYTE_ORDER_MARK = 0x01020304
+GRID_PAGE_SIZE = 4096
+GRID_ROW_ALIGNMENT = 64
+GRID_SAMPLE_U8 = 3
+
+
+def read_grid_axes(f):
+    """Read y_size, x_size, y, x of a version 1, 2 or 3 grid file (see cli/grid_file.h)."""
+    if f.read(8) == GRID_MAGIC_TERRAIN:
+        version, _, y_size, x_size = struct.unpack('IIii', f.read(16))
+        f.seek(64 if version >= 3 else 40)
+    else:
+        f.seek(0)
+        y_size, x_size = struct.unpack('ii', f.read(8))
+    y = np.fromfile(f, dtype=np.float64, count=y_size)
+    x = np.fromfile(f, dtype=np.float64, count=x_size)
+    return y_size, x_size, y, x
+
+
+def write_grid(f, magic, y, x, rows):
+    """Write a version 3 byte grid file with page-aligned grid and cache-line aligned rows."""
+    rows = np.asarray(rows)
+    row_size = -(-rows.shape[1] * rows.itemsize // GRID_ROW_ALIGNMENT) * GRID_ROW_ALIGNMENT
+    stride = row_size // rows.itemsize
+    grid_offset = -(-(64 + 8 * (len(y) + len(x))) // GRID_PAGE_SIZE) * GRID_PAGE_SIZE
+
+    f.write(magic)
+    f.write(struct.pack('IIiiiIQddd', GRID_VERSION, GRID_BYTE_ORDER_MARK, len(y), len(x), stride, GRID_SAMPLE_U8,
+                        grid_offset, 1.0, 0.0, np.nan))
+    np.asarray(y, dtype=np.float64).tofile(f)
+    np.asarray(x, dtype=np.float64).tofile(f)
+    f.write(bytes(grid_offset - f.tell()))
+
+    padded = np.zeros((rows.shape[0], stride), dtype=rows.dtype)
+    padded[:, :rows.shape[1]] = rows
+    padded.tofile(f)
+
+
 if __name__ == '__main__':
 
     SOURCE_ESRI_FILE = "34U_20220101-20230101.tif"
@@ -34,10 +75,7 @@ if __name__ == '__main__':
     HEIGHT_MAPPING = np.vectorize(CLUTTER_HEIGHT_MAP.get)
 
     with open(SOURCE_TF_FILE, "rb") as ter:
-        y_size = struct.unpack('i', ter.read(4))[0]
-        x_size = struct.unpack('i', ter.read(4))[0]
-        y = np.fromfile(ter, dtype=np.float64, count=y_size)
-        x = np.fromfile(ter, dtype=np.float64, count=x_size)
+        y_size, x_size, y, x = read_grid_axes(ter)
 
     dst_shape = (y_size * OVERSAMPLE, x_size * OVERSAMPLE)
     destination = np.zeros(dst_shape, dtype=np.uint8)
@@ -119,13 +157,7 @@ if __name__ == '__main__':
     new_y = np.linspace(y[0], y[-1], y_size * OVERSAMPLE, dtype=np.float64)
     new_x = np.linspace(x[0], x[-1], x_size * OVERSAMPLE, dtype=np.float64)
     with open(DESTINATION_CF_FILE, "wb") as dst:
-        dst.write(struct.pack('i', y_size * OVERSAMPLE))
-        dst.write(struct.pack('i', x_size * OVERSAMPLE))
-        new_y.tofile(dst)
-        new_x.tofile(dst)
-        for iy in range(y_size * OVERSAMPLE):
-            row = destination[y_size * OVERSAMPLE - iy - 1]
-            row_heights = np.round(row * 10)  # dm
-            row_heights.astype(np.uint8).tofile(dst)
+        rows = np.round(destination[::-1] * 10)  # dm
+        write_grid(dst, GRID_MAGIC_CLUTTER, new_y, new_x, rows.astype(np.uint8))
 
     print("CF file created")
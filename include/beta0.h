@@ -1,6 +1,17 @@
 #ifndef BETA0_H
 #define BETA0_H
 
+#include "real.h"
+
+/*
+ * Latitude-only factors of beta0
+ */
+typedef struct
+{
+    real_t mu4_exponent; // exponent of mu1 in Eq (4)
+    real_t scale;        // latitude factor of Eq (5)
+} beta0_prepared_t;
+
 /*
  * This function computes the time percentage for which refractive index lapse-rates exceeding 
  * 100 N-units/km can be expected in the first 100m of the lower atmosphere
@@ -11,6 +22,19 @@
  *
  * @return the time percentage that the refractivity gradient (DELTA-N) exceeds 100 N-units/km in the first 100m of the lower atmosphere
  */
-double beta0(double phi, double dtm, double dlm);
+real_t beta0(real_t phi, real_t dtm, real_t dlm);
+
+/*
+ * Computes the factors of beta0 that depend on the path centre latitude only
+ *
+ * @param phi path centre latitude (deg)
+ * @param prepared the factors
+ */
+void beta0_prepare(real_t phi, beta0_prepared_t *prepared);
+
+/*
+ * Same as beta0(), with the latitude factors from beta0_prepare()
+ */
+real_t beta0_prepared(const beta0_prepared_t *prepared, real_t dtm, real_t dlm);
 
 #endif
\ No newline at end of file
@@ -1,9 +1,56 @@
 #ifndef CALCULATE_H
 #define CALCULATE_H
 
+#include "real.h"
 #include "parameters.h"
 #include "results.h"
+#include "prepare.h"
+#include "workspace.h"
 
+/*
+ * Calculates the basic transmission loss of one path. The profile must start at the
+ * transmitter with d[0] = 0, otherwise results->error is set and results->parameters_error
+ * is PARAM_ERR_INVALID_DISTANCE_FROM_TRANSMITTER.
+ *
+ * @param parameters calculation parameters
+ * @param results calculation results
+ */
 void c1812_calculate(c1812_parameters_t *parameters, c1812_results_t *results);
 
+/*
+ * Same as c1812_calculate(), with the job-invariant values computed once by c1812_prepare()
+ *
+ * @param parameters calculation parameters
+ * @param prepared values prepared from the same scalar parameters
+ * @param results calculation results
+ */
+void c1812_calculate_prepared(c1812_parameters_t *parameters, const c1812_prepared_t *prepared, c1812_results_t *results);
+
+/*
+ * Same as c1812_calculate(), but keeps prefix values of the profile in the workspace so that
+ * repeated calls on one profile with a varying number of points n reuse them.
+ * Call c1812_workspace_invalidate() before moving on to a different profile.
+ *
+ * @param parameters calculation parameters, n must not exceed the n_max of the workspace
+ * @param prepared values prepared from the same scalar parameters, or NULL to prepare them here
+ * @param workspace workspace to keep the cached values in
+ * @param results calculation results
+ */
+void c1812_calculate_ws(c1812_parameters_t *parameters, const c1812_prepared_t *prepared, c1812_workspace_t *workspace, c1812_results_t *results);
+
+/*
+ * Calculates the basic transmission loss for every receiver position along one profile.
+ * The receiver is moved outward from point 2 to point n - 1 and the profile analysis
+ * state is carried from one position to the next instead of being rebuilt for each of them.
+ *
+ * @param parameters calculation parameters, n must not exceed the n_max of the workspace
+ * @param prepared values prepared from the same scalar parameters, or NULL to prepare them here
+ * @param workspace scratch memory for the profile analysis state, its cached values are left untouched
+ * @param Lb output array of n elements, Lb[i] is the loss for the receiver at d[i];
+ *           Lb[0] and Lb[1] are set to NAN
+ * @param results error status, Lb holds the loss for the receiver at d[n - 1]; on an error
+ *                the losses from the failing receiver on are NAN
+ */
+void c1812_calculate_ray(c1812_parameters_t *parameters, const c1812_prepared_t *prepared, c1812_workspace_t *workspace, real_t *Lb, c1812_results_t *results);
+
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef CUSTOM_MATH_H
 #define CUSTOM_MATH_H
 
+#include "real.h"
+
 #define NEGATIVE_INFINITY (-1.0 / 0.0)
 #define INFINITY (1.0 / 0.0)
 #define NAN (0.0 / 0.0)
@@ -8,25 +10,25 @@
 #define PI 3.14159265358979323846
 #define PI_2 1.57079632679489661923
 
-double c_isnan(double x);
-double c_floor(double x);
-double c_ceil(double x);
-double c_round(double x);
-double c_abs(double x);
-double c_min(double x, double y);
-double c_max(double x, double y);
-double c_pow(double x, double y);
-double c_atan(double x);
-double c_atan2(double y, double x);
-double c_atan2_exact(double y, double x);
-double c_exp(double x);
-double c_log(double x);
-double c_sqrt(double x);
-double c_cbrt(double x);
-double c_log10(double x);
-double c_tanh(double x);
-double c_sin(double x);
-double c_cos(double x);
-double c_acos(double x);
+real_t c_isnan(real_t x);
+real_t c_floor(real_t x);
+real_t c_ceil(real_t x);
+real_t c_round(real_t x);
+real_t c_abs(real_t x);
+real_t c_min(real_t x, real_t y);
+real_t c_max(real_t x, real_t y);
+real_t c_pow(real_t x, real_t y);
+real_t c_atan(real_t x);
+real_t c_atan2(real_t y, real_t x);
+real_t c_atan2_exact(real_t y, real_t x);
+real_t c_exp(real_t x);
+real_t c_log(real_t x);
+real_t c_sqrt(real_t x);
+real_t c_cbrt(real_t x);
+real_t c_log10(real_t x);
+real_t c_tanh(real_t x);
+real_t c_sin(real_t x);
+real_t c_cos(real_t x);
+real_t c_acos(real_t x);
 
 #endif
\ No newline at end of file
@@ -1,25 +1,104 @@
 #ifndef DL_BULL_H
 #define DL_BULL_H
 
+#include "real.h"
+#include "upper_hull.h"
+
+/*
+ * Upper convex hull of the intermediate profile points of a path that grows
+ * at the receiver end. Points are stored as (d, g - 500 * d^2 / ap), in which
+ * frame the Bullington slopes and clearances of the actual profile become
+ * tangent and supporting-line queries on the hull.
+ */
+typedef struct
+{
+    real_t Ce;           // effective Earth curvature (km^-1)
+    upper_hull_t points; // vertices as (d [km], g - 500 * Ce * d^2 [m])
+} dl_bull_hull_t;
+
+/*
+ * Profile reductions the Bullington loss is computed from
+ */
+typedef struct
+{
+    real_t Stim;  // highest slope of the line from the transmitter to an intermediate point
+    real_t Srim;  // highest slope of the line from the receiver to an intermediate point
+    real_t numax; // highest diffraction parameter, used only for LoS paths
+} dl_bull_profile_t;
+
 typedef struct
 {
     int n;
-    double *d;
-    double *h;
-    double *Ct;
-    double hts;
-    double hrs;
-    double ap;
-    double f;
-    double lambda;
-    double dtot;
+    real_t *d;
+    real_t *h;
+    real_t *Ct;
+    real_t hts;
+    real_t hrs;
+    real_t ap;
+    real_t f;
+    real_t lambda;
+    real_t dtot;
+
+    // Optional incremental state, holding exactly the intermediate points 1 .. n - 2
+    dl_bull_hull_t *hull;
+
+    // Optional reductions of this profile computed elsewhere, take precedence over the hull
+    const dl_bull_profile_t *profile;
 } dl_bull_input_t;
 
 typedef struct
 {
-    double Lbull;
+    real_t Lbull;
 } dl_bull_output_t;
 
 void dl_bull(dl_bull_input_t *input, dl_bull_output_t *output);
 
-#endif
\ No newline at end of file
+/*
+ * Scans the intermediate points of the profile for Stim, Srim and numax
+ */
+void dl_bull_profile(dl_bull_input_t *input, dl_bull_profile_t *profile);
+
+/*
+ * Bullington loss for a smooth path, i.e. all profile heights set to zero (h and Ct are ignored)
+ */
+void dl_bull_smooth(dl_bull_input_t *input, dl_bull_output_t *output);
+
+/*
+ * Stim, Srim and numax of the zero-height profile in O(log n). Each slope is a concave
+ * function of the distance with a closed-form maximum, so only the profile points around
+ * it are evaluated; numax is unimodal along the path and found by bisection.
+ */
+void dl_bull_smooth_profile(dl_bull_input_t *input, dl_bull_profile_t *profile);
+
+/*
+ * Computes the Bullington loss (Eq 21) from the profile reductions
+ */
+void dl_bull_loss(dl_bull_input_t *input, const dl_bull_profile_t *profile, dl_bull_output_t *output);
+
+/*
+ * Starts an empty hull
+ *
+ * @param hull the hull to initialize
+ * @param x storage for vertex distances, at least as many elements as points that will be pushed
+ * @param y storage for vertex heights, at least as many elements as points that will be pushed
+ * @param ap the effective Earth radius in kilometers
+ */
+void dl_bull_hull_init(dl_bull_hull_t *hull, real_t *x, real_t *y, real_t ap);
+
+/*
+ * Adds the next intermediate point, amortized O(1)
+ *
+ * @param d distance of the point from the transmitter, greater than that of any point already pushed (km)
+ * @param g terrain plus clutter height of the point (m)
+ */
+void dl_bull_hull_push(dl_bull_hull_t *hull, real_t d, real_t g);
+
+/*
+ * Answers Stim, Srim and the LoS numax for the current receiver in O(log n).
+ * When the hull cannot show that numax stays below the knife-edge threshold
+ * of -0.78, only the profile points under the hull edges whose clearance
+ * bound could still exceed it are scanned.
+ */
+void dl_bull_hull_profile(dl_bull_hull_t *hull, dl_bull_input_t *input, dl_bull_profile_t *profile);
+
+#endif
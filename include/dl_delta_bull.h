@@ -1,29 +1,43 @@
 #ifndef DL_DELTA_BULL_H
 #define DL_DELTA_BULL_H
 
+#include "real.h"
+#include "dl_bull.h"
+#include "dl_se_ft.h"
+
 typedef struct
 {
     int n;
-    double *d;
-    double *h;
-    double *Ct;
-    double hts;
-    double hrs;
-    double hstd;
-    double hsrd;
-    double ap;
-    double f;
-    double lambda;
-    double dtot;
-    double omega;
+    real_t *d;
+    real_t *h;
+    real_t *Ct;
+    real_t hts;
+    real_t hrs;
+    real_t hstd;
+    real_t hsrd;
+    real_t ap;
+    real_t f;
+    real_t lambda;
+    real_t dtot;
+    real_t omega;
+
+    // Optional incremental Bullington state of the actual profile for radius ap
+    dl_bull_hull_t *hull;
+
+    // Optional Bullington reductions of the actual profile for radius ap, take precedence over hull
+    const dl_bull_profile_t *bull_profile;
+
+    // Optional first-term spherical-Earth terms for radius ap
+    const dl_se_ft_prepared_t *se_ft;
+    dl_se_ft_func_t se_ft_func;
 } dl_delta_bull_input_t;
 
 typedef struct
 {
-    double Ld[2];
-    double Lbulla;
-    double Lbulls;
-    double Ldsph[2];
+    real_t Ld[2];
+    real_t Lbulla;
+    real_t Lbulls;
+    real_t Ldsph[2];
 } dl_delta_bull_output_t;
 
 /**
@@ -41,6 +55,10 @@ typedef struct
  * @param input->ap the effective Earth radius in kilometers
  * @param input->f frequency expressed in GHz
  * @param input->omega the fraction of the path over sea
+ * @param input->hull optional hull of the intermediate points of g for ap, or NULL
+ * @param input->bull_profile optional Stim, Srim and numax of g for ap, or NULL
+ * @param input->se_ft optional terms from dl_se_ft_prepare() for ap and f, or NULL
+ * @param input->se_ft_func optional specialization of dl_se_ft() from dl_se_ft_select(), or NULL
  *
  * @return
  * Ld = diffraction loss for the general path according to Section 4.3.3 of ITU-R P.1812-4,
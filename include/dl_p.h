@@ -1,6 +1,10 @@
 #ifndef DL_P_H
 #define DL_P_H
 
+#include "real.h"
+#include "dl_bull.h"
+#include "dl_se_ft.h"
+
 //   This function computes the diffraction loss not exceeded for p// of time
 //   as defined in ITU-R P.1812-5 (Section 4.3-5) and Attachment 4 to Annex 1
 //
@@ -22,6 +26,14 @@
 //                 quantity in this procedure
 //     flag4   -   Set to 1 if the alternative method is used to calculate Lbulls 
 //                 without using terrain profile analysis (Attachment 4 to Annex 1)
+//     hull_ae -   Optional incremental Bullington state of g for ae, or NULL
+//     hull_ab -   Optional incremental Bullington state of g for ab, or NULL
+//     bull_profile_ae - Optional Bullington reductions of g for ae, or NULL
+//     bull_profile_ab - Optional Bullington reductions of g for ab, or NULL
+//     se_ft_ae -  Optional first-term spherical-Earth terms for ae, or NULL
+//     se_ft_ab -  Optional first-term spherical-Earth terms for ab, or NULL
+//     se_ft_func - Optional specialization of dl_se_ft() for the job polarization and omega, or NULL
+//     inv_cum_norm_p - inv_cum_norm(p / 100)
 //
 //     Output parameters:
 //     Ldp    -   diffraction loss for the general path not exceeded for p // of the time 
@@ -39,32 +51,45 @@
 typedef struct
 {
     int n;
-    double *d;
-    double *h;
-    double *Ct;
-    double hts;
-    double hrs;
-    double hstd;
-    double hsrd;
-    double ae;
-    double ab;
-    double f;
-    double lambda;
-    double dtot;
-    double omega;
-    double p;
-    double b0;
-    double DN;
+    real_t *d;
+    real_t *h;
+    real_t *Ct;
+    real_t hts;
+    real_t hrs;
+    real_t hstd;
+    real_t hsrd;
+    real_t ae;
+    real_t ab;
+    real_t f;
+    real_t lambda;
+    real_t dtot;
+    real_t omega;
+    real_t p;
+    real_t b0;
+    real_t DN;
+
+    // Optional incremental state
+    dl_bull_hull_t *hull_ae;
+    dl_bull_hull_t *hull_ab;
+    const dl_bull_profile_t *bull_profile_ae;
+    const dl_bull_profile_t *bull_profile_ab;
+
+    // Optional job-invariant terms
+    const dl_se_ft_prepared_t *se_ft_ae;
+    const dl_se_ft_prepared_t *se_ft_ab;
+    dl_se_ft_func_t se_ft_func;
+
+    real_t inv_cum_norm_p;
 } dl_p_input_t;
 
 typedef struct
 {
-    double Ldp[2];
-    double Ldb[2];
-    double Ld50[2];
-    double Lbulla50;
-    double Lbulls50;
-    double Ldsph50[2];
+    real_t Ldp[2];
+    real_t Ldb[2];
+    real_t Ld50[2];
+    real_t Lbulla50;
+    real_t Lbulls50;
+    real_t Ldsph50[2];
 } dl_p_output_t;
 
 void dl_p(dl_p_input_t *input, dl_p_output_t *output);
@@ -1,18 +1,27 @@
 #ifndef DL_SE_H
 #define DL_SE_H
 
+#include "real.h"
+#include "dl_se_ft.h"
+
 typedef struct {
-    double d;
-    double hte;
-    double hre;
-    double ap;
-    double f;
-    double lambda;
-    double omega;
+    real_t d;
+    real_t hte;
+    real_t hre;
+    real_t ap;
+    real_t f;
+    real_t lambda;
+    real_t omega;
+
+    // Optional first-term terms from dl_se_ft_prepare() for adft = ap
+    const dl_se_ft_prepared_t *prepared;
+
+    // Optional specialization of dl_se_ft() from dl_se_ft_select()
+    dl_se_ft_func_t ft;
 } dl_se_input_t;
 
 typedef struct {
-    double Ldsph[2];
+    real_t Ldsph[2];
 } dl_se_output_t;
 
 void dl_se(dl_se_input_t *input, dl_se_output_t *output);
@@ -1,22 +1,45 @@
 #ifndef DL_SE_FT_H
 #define DL_SE_FT_H
 
+#include "real.h"
+#include "dl_se_ft_inner.h"
+
+typedef struct
+{
+    dl_se_ft_inner_prepared_t land;
+    dl_se_ft_inner_prepared_t sea;
+} dl_se_ft_prepared_t;
+
 typedef struct
 {
-    double d;
-    double hte;
-    double hre;
-    double ap;
-    double f;
-    double lambda;
-    double omega;
+    real_t d;
+    real_t hte;
+    real_t hre;
+    real_t ap;
+    real_t f;
+    real_t lambda;
+    real_t omega;
+
+    // Optional terms from dl_se_ft_prepare() for this ap and f
+    const dl_se_ft_prepared_t *prepared;
 } dl_se_ft_input_t;
 
 typedef struct
 {
-    double Ldft[2];
+    real_t Ldft[2];
 } dl_se_ft_output_t;
 
+void dl_se_ft_prepare(real_t adft, real_t f, dl_se_ft_prepared_t *prepared);
+
 void dl_se_ft(dl_se_ft_input_t *input, dl_se_ft_output_t *output);
 
+typedef void (*dl_se_ft_func_t)(dl_se_ft_input_t *input, dl_se_ft_output_t *output);
+
+/*
+ * Picks a specialization of dl_se_ft() that evaluates only polarization pol (0 horizontal, 1 vertical)
+ * and, when omega is exactly 0 or 1, only the land or the sea term. Ldft of the other polarization is NAN,
+ * and stays NAN through dl_se() and dl_delta_bull(). Without prepared terms, only those of pol are computed.
+ */
+dl_se_ft_func_t dl_se_ft_select(int pol, real_t omega);
+
 #endif
\ No newline at end of file
@@ -1,20 +1,41 @@
 #ifndef DL_SE_FT_INNER_H
 #define DL_SE_FT_INNER_H
 
+#include "real.h"
+
+// Terms that depend on the ground, adft and f only, for horizontal (0) and vertical (1) polarizations
+typedef struct {
+    real_t K[2];        // Eq (29ab)
+    real_t beta_dft[2]; // Eq (30)
+    real_t X_factor[2]; // Eq (31) per km of distance
+    real_t Y_factor[2]; // Eq (32ab) per m of height
+    real_t GY_min[2];   // lower bound of G(Y), 2 + 20 log10(K)
+} dl_se_ft_inner_prepared_t;
+
 typedef struct {
-    double epsr;
-    double sigma;
-    double d;
-    double hte;
-    double hre;
-    double adft;
-    double f;
+    real_t epsr;
+    real_t sigma;
+    real_t d;
+    real_t hte;
+    real_t hre;
+    real_t adft;
+    real_t f;
+
+    // Optional terms from dl_se_ft_inner_prepare() for this epsr, sigma, adft and f
+    const dl_se_ft_inner_prepared_t *prepared;
 } dl_se_ft_inner_input_t;
 
 typedef struct {
-    double Ldft[2];
+    real_t Ldft[2];
 } dl_se_ft_inner_output_t;
 
+void dl_se_ft_inner_prepare(real_t epsr, real_t sigma, real_t adft, real_t f, dl_se_ft_inner_prepared_t *prepared);
+
 void dl_se_ft_inner(dl_se_ft_inner_input_t *input, dl_se_ft_inner_output_t *output);
 
+// Same as dl_se_ft_inner() for the horizontal (h) or vertical (v) polarization only,
+// Ldft of the other polarization is NAN
+void dl_se_ft_inner_h(dl_se_ft_inner_input_t *input, dl_se_ft_inner_output_t *output);
+void dl_se_ft_inner_v(dl_se_ft_inner_input_t *input, dl_se_ft_inner_output_t *output);
+
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef INV_CUM_NORM_H
 #define INV_CUM_NORM_H
 
-double inv_cum_norm(double x);
+#include "real.h"
+
+real_t inv_cum_norm(real_t x);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef PARAMETERS_H
 #define PARAMETERS_H
 
+#include "real.h"
+
 typedef enum
 {
 	POLARIZATION_HORIZONTAL = 0,
@@ -17,28 +19,23 @@ typedef enum
 typedef struct
 {
 	// Scalar data
-	double f;	// frequency [GHz]
-	double p;	// percentage of average year for which the calculated signal level is exceeded [%]
-	double htg; // transmitter height above ground level [m]
-	double hrg; // receiver height above ground level [m]
+	real_t f;	// frequency [GHz]
+	real_t p;	// percentage of average year for which the calculated signal level is exceeded [%]
+	real_t htg; // transmitter height above ground level [m]
+	real_t hrg; // receiver height above ground level [m]
 	c1812_polarization_t pol;
 	c1812_radioclimactic_zone_t zone;
-	double ws;	// street width [m]
-	double lon; // path center longitude [degrees]
-	double lat; // path center latitude [degrees]
-	double N0;	// sea-level surface refractivity [N-units]
-	double DN;	// average radio-refractivity lapse-rate through the lowest 1 km of the atmosphere [N-units/km]
+	real_t ws;	// street width [m]
+	real_t lon; // path center longitude [degrees]
+	real_t lat; // path center latitude [degrees]
+	real_t N0;	// sea-level surface refractivity [N-units]
+	real_t DN;	// average radio-refractivity lapse-rate through the lowest 1 km of the atmosphere [N-units/km]
 
 	// Vector data
 	int n;		// number of points
-	double *d;	// distance from transmitter [km]
-	double *h;	// terrain height above sea level [m]
-	double *Ct; // representative clutter height [m]
-
-	// Optional caches
-	double *v1_cache;
-    double *v2_cache;
-	double *theta_max_cache;
+	real_t *d;	// distance from transmitter [km], d[0] = 0 at the transmitter
+	real_t *h;	// terrain height above sea level [m]
+	real_t *Ct; // representative clutter height [m]
 
 } c1812_parameters_t;
 
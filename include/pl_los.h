@@ -1,23 +1,25 @@
 #ifndef PL_LOS_H
 #define PL_LOS_H
 
+#include "real.h"
+
 typedef struct
 {
-    double d;
-    double hts;
-    double hrs;
-    double f;
-    double p;
-    double b0;
-    double dlt;
-    double dlr;
+    real_t d;
+    real_t hts;
+    real_t hrs;
+    real_t f;
+    real_t p;
+    real_t b0;
+    real_t dlt;
+    real_t dlr;
 } pl_los_input_t;
 
 typedef struct
 {
-    double Lbfs; // Basic transmission loss due to free-space propagation
-    double Lb0p; // Basic transmission loss not exceeded for time percentage, p%, due to LoS propagation
-    double Lb0b; // Basic transmission loss not exceedd for time percentage, b0%, due to LoS propagation
+    real_t Lbfs; // Basic transmission loss due to free-space propagation
+    real_t Lb0p; // Basic transmission loss not exceeded for time percentage, p%, due to LoS propagation
+    real_t Lb0b; // Basic transmission loss not exceedd for time percentage, b0%, due to LoS propagation
 } pl_los_output_t;
 
 void pl_los(pl_los_input_t *input, pl_los_output_t *output);
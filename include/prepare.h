@@ -0,0 +1,42 @@
+#ifndef PREPARE_H
+#define PREPARE_H
+
+#include "real.h"
+#include "parameters.h"
+#include "beta0.h"
+#include "dl_se_ft.h"
+#include "tl_anomalous.h"
+#include "tl_tropo.h"
+
+/*
+ * Values that depend only on the scalar parameters (f, p, DN, lat, zone), shared read-only
+ * by every path calculated with those parameters
+ */
+typedef struct
+{
+	real_t lambda;		   // wavelength [m]
+	real_t ae;			   // median effective Earth radius (7a) [km]
+	real_t ab;			   // effective Earth radius exceeded for b0 time (7b) [km]
+	real_t inv_cum_norm_p; // inv_cum_norm(p / 100) for the interpolation factor Fi (40a)
+	real_t Lloc;		   // location variability of losses (67a) [dB]
+	real_t omega;		   // fraction of the path over sea (1)
+
+	// dl_se_ft() specialized for the polarization and omega
+	dl_se_ft_func_t dl_se_ft_func;
+
+	beta0_prepared_t beta0;
+	dl_se_ft_prepared_t dl_se_ft_ae;
+	dl_se_ft_prepared_t dl_se_ft_ab;
+	tl_anomalous_prepared_t tl_anomalous;
+	tl_tropo_prepared_t tl_tropo;
+} c1812_prepared_t;
+
+/*
+ * Computes the job-invariant values for c1812_calculate_prepared() and friends
+ *
+ * @param parameters calculation parameters, the vector data is not used
+ * @param prepared the values to fill in
+ */
+void c1812_prepare(c1812_parameters_t *parameters, c1812_prepared_t *prepared);
+
+#endif
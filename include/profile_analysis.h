@@ -0,0 +1,52 @@
+#ifndef PROFILE_ANALYSIS_H
+#define PROFILE_ANALYSIS_H
+
+#include "real.h"
+#include "dl_bull.h"
+
+typedef struct
+{
+    int n;
+    real_t *d;
+    real_t *h;
+    real_t *Ct;
+    real_t dtot;
+    real_t lambda;
+    real_t htg;
+    real_t hrg;
+    real_t ae;
+    real_t ab;
+} profile_analysis_input_t;
+
+/*
+ * Per-point reductions of one path profile, for smooth_earth_heights() and for the
+ * Bullington loss of the actual profile with both effective Earth radii
+ */
+typedef struct
+{
+    // Smooth-Earth heights, Section 5.6
+    real_t v1;        // Eq (161)
+    real_t v2;        // Eq (162)
+    real_t hobs;      // highest obstruction height above the line between the antennas
+    real_t alpha_obt; // highest obstruction angle seen from the transmitter
+    real_t alpha_obr; // highest obstruction angle seen from the receiver
+    real_t theta_max; // highest horizon elevation angle from the transmitter [mrad]
+    real_t theta_r;   // highest horizon elevation angle from the receiver, transhorizon path [mrad]
+    real_t dlt_trans; // horizon distance from the transmitter for a transhorizon path [km]
+    real_t dlt_los;   // distance of the highest diffraction parameter for a LoS path [km]
+
+    // Bullington, Section 4.3.1, for g = h + Ct and ap = ae, ab
+    dl_bull_profile_t bull_ae;
+    dl_bull_profile_t bull_ab;
+} profile_analysis_output_t;
+
+/*
+ * Computes every reduction above in a single traversal of the profile. The terminal
+ * heights are hts = h[0] + htg and hrs = h[n - 1] + hrg, as in smooth_earth_heights().
+ * Which of dlt_trans/theta_r and dlt_los applies is only known after the traversal,
+ * so both are computed; numax of the Bullington profiles is always set and is only
+ * meaningful for a LoS path (Stim < Str).
+ */
+void profile_analysis(profile_analysis_input_t *input, profile_analysis_output_t *output);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef REAL_H
+#define REAL_H
+
+// Floating-point type of the library: float in the c1812f build (C1812_FLOAT defined), double otherwise.
+// Code using c1812f must define C1812_FLOAT as well.
+#ifdef C1812_FLOAT
+typedef float real_t;
+#else
+typedef double real_t;
+#endif
+
+#endif
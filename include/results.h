@@ -1,6 +1,7 @@
 #ifndef RESULTS_H
 #define RESULTS_H
 
+#include "real.h"
 #include "parameters.h"
 #include "parameters_validation.h"
 
@@ -14,7 +15,7 @@ typedef struct
 {
 	c1812_results_error_t error;
 	c1812_parameters_error_t parameters_error;
-	double Lb; // Basic transmission loss
+	real_t Lb; // Basic transmission loss
 } c1812_results_t;
 
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef RF_H
 #define RF_H
 
+#include "real.h"
+
 /*
  * Convert Watts to dBm
  *
@@ -8,7 +10,7 @@
  * 
  * @return Power [dBm]
  */
-double watts_to_dBm(double P);
+real_t watts_to_dBm(real_t P);
 
 /*
  * Link budget
@@ -20,6 +22,6 @@ double watts_to_dBm(double P);
  * 
  * @return Received signal strength [dBm]
  */
-double link_budget(double P, double Gt, double Gr, double L);
+real_t link_budget(real_t P, real_t Gt, real_t Gr, real_t L);
 
 #endif
\ No newline at end of file
@@ -1,48 +1,105 @@
 #ifndef SMOOTH_EARTH_HEIGHTS_H
 #define SMOOTH_EARTH_HEIGHTS_H
 
+#include "real.h"
+#include "upper_hull.h"
+#include "profile_analysis.h"
+
+/*
+ * Running profile analysis of a path that grows at the receiver end. The sums, maxima and
+ * hulls answer the per-receiver queries without visiting every point; only the
+ * line-of-sight dlt search still reads the profile, and there only the points under the
+ * hull_z edges whose bound can reach the highest nu of a vertex
+ */
+typedef struct
+{
+    int n;            // number of profile points covered, 0 for a fresh state
+    real_t hts;       // transmitter height above mean sea level [m]
+    real_t v1;        // Eq (161) sum over the covered points
+    real_t v2;        // Eq (162) sum over the covered points
+    real_t theta_max; // highest horizon elevation angle from the transmitter over the intermediate points [mrad]
+    real_t alpha_t;   // highest (hi - hts) / di over the intermediate points
+    upper_hull_t hull_h; // intermediate points as (di, hi)
+    upper_hull_t hull_z; // intermediate points as (di, hi - 500 * di^2 / ae)
+} seh_state_t;
+
+/*
+ * Prefix values of one profile indexed by the number of points n (n_max + 1 entries each).
+ * An entry is valid only while its stamp equals generation, so bumping generation
+ * invalidates the whole cache at once
+ */
+typedef struct
+{
+    unsigned int generation;
+    unsigned int *v1_v2_stamp;
+    unsigned int *theta_max_stamp;
+    real_t *v1;
+    real_t *v2;
+    real_t *theta_max;
+} seh_cache_t;
+
 typedef struct
 {
     int n;
-    double *d;
-    double *h;
-    double *Ct;
-    double dtot;
-    double lambda;
-    double htg;
-    double hrg;
-    double ae;
-
-    // Optional caches
-    double *v1_cache;
-    double *v2_cache;
-	double *theta_max_cache;
+    real_t *d;
+    real_t *h;
+    real_t *Ct;
+    real_t dtot;
+    real_t lambda;
+    real_t htg;
+    real_t hrg;
+    real_t ae;
+
+    // Optional cache
+    seh_cache_t *cache;
+
+    // Optional incremental state, takes precedence over the cache
+    seh_state_t *state;
+
+    // Optional reductions from profile_analysis() of the same profile, used when state is NULL
+    const profile_analysis_output_t *analysis;
 } seh_input_t;
 
 typedef struct
 {
-    double hts; // transmitter height above mean sea level [m]
-    double hrs; // receiver height above mean sea level [m]
-    double htc;
-    double hrc;
-    double hst;
-    double hsr;
-    double hst_n;
-    double hsr_n;
-    double hstp;
-    double hsrp;
-    double hstd;
-    double hsrd;
-    double hte;
-    double hre;
-    double theta;
-    double theta_t;
-    double theta_r;
-    double dlt;
-    double dlr;
-    double hm;
+    real_t hts; // transmitter height above mean sea level [m]
+    real_t hrs; // receiver height above mean sea level [m]
+    real_t htc;
+    real_t hrc;
+    real_t hst;
+    real_t hsr;
+    real_t hst_n;
+    real_t hsr_n;
+    real_t hstp;
+    real_t hsrp;
+    real_t hstd;
+    real_t hsrd;
+    real_t hte;
+    real_t hre;
+    real_t theta;
+    real_t theta_t;
+    real_t theta_r;
+    real_t dlt;
+    real_t dlr;
+    real_t hm;
 } seh_output_t;
 
 void smooth_earth_heights(seh_input_t *input, seh_output_t *output);
 
+/*
+ * Starts an empty incremental state
+ *
+ * @param state the state to initialize
+ * @param storage 4 * n_max elements for the hull vertices
+ * @param n_max the largest number of profile points the state will cover
+ */
+void seh_state_init(seh_state_t *state, real_t *storage, int n_max);
+
+/*
+ * Brings the state up to input->n profile points. Only the points added since the previous
+ * call are visited, so input->n must not decrease and h, htg and ae must stay the same.
+ * smooth_earth_heights() calls this itself when input->state is set.
+ */
+void seh_state_advance(seh_state_t *state, seh_input_t *input);
+
 #endif
\ No newline at end of file
@@ -1,15 +1,17 @@
 #ifndef S_UNIT_H
 #define S_UNIT_H
 
+#include "real.h"
+
 typedef struct
 {
 	int full_units;
-	double dB_over;
+	real_t dB_over;
 } s_unit_t;
 
-void dBm_to_s_unit_hf(double dbm, s_unit_t *s_unit);
-double s_unit_to_dBm_hf(s_unit_t *s_unit);
-void dBm_to_s_unit_vhf(double dbm, s_unit_t *s_unit);
-double s_unit_to_dBm_vhf(s_unit_t *s_unit);
+void dBm_to_s_unit_hf(real_t dbm, s_unit_t *s_unit);
+real_t s_unit_to_dBm_hf(s_unit_t *s_unit);
+void dBm_to_s_unit_vhf(real_t dbm, s_unit_t *s_unit);
+real_t s_unit_to_dBm_vhf(s_unit_t *s_unit);
 
 #endif
\ No newline at end of file
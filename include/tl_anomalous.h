@@ -1,31 +1,44 @@
 #ifndef TL_ANOMALOUS_H
 #define TL_ANOMALOUS_H
 
+#include "real.h"
+
 typedef struct
 {
-    double dtot;
-    double dlt;
-    double dlr;
-    double dct;
-    double dcr;
-    double dlm;
-    double hts;
-    double hrs;
-    double hte;
-    double hre;
-    double hm;
-    double theta_t;
-    double theta_r;
-    double f;
-    double p;
-    double omega;
-    double ae;
-    double b0;
+    real_t Alf;    // empirical correction (47a)
+    real_t Af_f;   // frequency term of (47), 20 * log10(f)
+    real_t cbrt_f; // f^(1/3) for (48) and (51)
+    real_t sqrt_f; // f^(1/2) for (55)
+} tl_anomalous_prepared_t;
+
+typedef struct
+{
+    real_t dtot;
+    real_t dlt;
+    real_t dlr;
+    real_t dct;
+    real_t dcr;
+    real_t dlm;
+    real_t hts;
+    real_t hrs;
+    real_t hte;
+    real_t hre;
+    real_t hm;
+    real_t theta_t;
+    real_t theta_r;
+    real_t f;
+    real_t p;
+    real_t omega;
+    real_t ae;
+    real_t b0;
+
+    // Optional terms from tl_anomalous_prepare() for this f
+    const tl_anomalous_prepared_t *prepared;
 } tl_anomalous_input_t;
 
 typedef struct
 {
-    double Lba;
+    real_t Lba;
 } tl_anomalous_output_t;
 
 /**
@@ -52,9 +65,18 @@ typedef struct
  * @param omega Fraction of the total path over water
  * @param ae The median effective Earth radius (km)
  * @param b0 The time percentage that the refractivity gradient (DELTA-N) exceeds 100 N-units/km in the first 100m of the lower atmosphere
+ * @param prepared Optional frequency-only terms from tl_anomalous_prepare(), or NULL
  *
  * @return The basic transmission loss due to anomalous propagation (ducting and layer reflection)
  */
 void tl_anomalous(tl_anomalous_input_t *input, tl_anomalous_output_t *output);
 
+/**
+ * Computes the terms of tl_anomalous() that depend on the frequency only
+ *
+ * @param f Frequency expressed in GHz
+ * @param prepared The terms
+ */
+void tl_anomalous_prepare(real_t f, tl_anomalous_prepared_t *prepared);
+
 #endif
\ No newline at end of file
@@ -1,20 +1,33 @@
 #ifndef TL_TROPO_H
 #define TL_TROPO_H
 
+#include "real.h"
+
+typedef struct
+{
+	real_t Lf; // frequency dependent loss eq (45)
+	real_t Lp; // time percentage term 10.125 * log10(50 / p)^0.7
+} tl_tropo_prepared_t;
+
 typedef struct
 {
-	double dtot;
-	double theta;
-	double f;
-	double p;
-	double N0;
+	real_t dtot;
+	real_t theta;
+	real_t f;
+	real_t p;
+	real_t N0;
+
+	// Optional terms from tl_tropo_prepare() for this f and p
+	const tl_tropo_prepared_t *prepared;
 } tl_tropo_input_t;
 
 typedef struct
 {
-	double Lbs;
+	real_t Lbs;
 } tl_tropo_output_t;
 
+void tl_tropo_prepare(real_t f, real_t p, tl_tropo_prepared_t *prepared);
+
 void tl_tropo(tl_tropo_input_t *input, tl_tropo_output_t *output);
 
 #endif
\ No newline at end of file
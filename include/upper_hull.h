@@ -0,0 +1,61 @@
+#ifndef UPPER_HULL_H
+#define UPPER_HULL_H
+
+#include "real.h"
+
+/*
+ * Upper convex hull of points pushed in order of strictly increasing x
+ */
+typedef struct
+{
+    int size;  // number of vertices
+    real_t *x; // vertex x coordinates, caller-provided storage
+    real_t *y; // vertex y coordinates, caller-provided storage
+} upper_hull_t;
+
+/*
+ * Starts an empty hull
+ *
+ * @param hull the hull to initialize
+ * @param x storage for vertex x coordinates, at least as many elements as points that will be pushed
+ * @param y storage for vertex y coordinates, at least as many elements as points that will be pushed
+ */
+void upper_hull_init(upper_hull_t *hull, real_t *x, real_t *y);
+
+/*
+ * Adds a point right of all points pushed so far, amortized O(1)
+ */
+void upper_hull_push(upper_hull_t *hull, real_t x, real_t y);
+
+/*
+ * Vertex maximizing (y - qy) / (x - qx) for a query point left of all vertices, O(log n)
+ *
+ * @return vertex index, or -1 for an empty hull
+ */
+int upper_hull_tangent_left(upper_hull_t *hull, real_t qx, real_t qy);
+
+/*
+ * Vertex maximizing (y - qy) / (qx - x) for a query point right of all vertices, O(log n)
+ *
+ * @return vertex index, or -1 for an empty hull
+ */
+int upper_hull_tangent_right(upper_hull_t *hull, real_t qx, real_t qy);
+
+/*
+ * Vertex maximizing y - slope * x, O(log n)
+ *
+ * @return vertex index, or -1 for an empty hull
+ */
+int upper_hull_support(upper_hull_t *hull, real_t slope);
+
+/*
+ * Highest (y - qy - slope * x) / sqrt(x * (span - x)) along the edge from vertex a to vertex b,
+ * a single vertex for a == b, for vertices in 0 < x < span, O(1). Points under the edge
+ * stay below this value, which bounds the knife-edge diffraction parameters of the
+ * profile points between two vertices.
+ *
+ * @return the maximum, or INFINITY for an edge with a vertex not below the line
+ */
+real_t upper_hull_edge_clearance(upper_hull_t *hull, real_t qy, real_t slope, real_t span, int a, int b);
+
+#endif
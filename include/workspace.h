@@ -0,0 +1,29 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+/*
+ * Scratch and prefix-cache memory for calculations on profiles of up to n_max points.
+ * A workspace is not thread safe, each thread needs its own.
+ */
+typedef struct c1812_workspace c1812_workspace_t;
+
+/*
+ * Allocates a workspace
+ *
+ * @param n_max the largest number of profile points the workspace will be used with
+ *
+ * @return the workspace, NULL if the allocation failed
+ */
+c1812_workspace_t *c1812_workspace_create(int n_max);
+
+/*
+ * Releases a workspace, NULL is ignored
+ */
+void c1812_workspace_free(c1812_workspace_t *workspace);
+
+/*
+ * Marks every cached value as stale in O(1), call it whenever the profile (d, h, htg or DN) changes
+ */
+void c1812_workspace_invalidate(c1812_workspace_t *workspace);
+
+#endif
@@ -1,8 +1,110 @@
-import struct
+import os
+from concurrent.futures import ThreadPoolExecutor
 import numpy as np
 import matplotlib.pyplot as plt
 import matplotlib.tri as tri
 
+RF_MAGIC = b'C1812RF\0'
+RF_BYTE_ORDER_MARK = 0x01020304
+RF_V1_HEADER = np.dtype([('txx', 'f8'), ('txy', 'f8'), ('radius', 'f8'), ('ares', 'f8'), ('n', 'i4')])
+RF_V2_HEADER = np.dtype([('magic', 'S8'), ('version', 'u4'), ('byte_order', 'u4'), ('header_size', 'u4'),
+                         ('type', 'u4'), ('channels', 'u4'), ('n', 'i4'), ('rays', 'i4'), ('compression', 'u4'),
+                         ('txx', 'f8'), ('txy', 'f8'), ('radius', 'f8'), ('ares', 'f8')])
+RF_V2_CHANNEL = np.dtype([('kind', 'u4'), ('reserved', 'u4'), ('offset', 'f8'), ('scale', 'f8')])
+RF_SAMPLE_TYPES = ['f8', 'f4', 'u2']
+RF_U16_NAN = 0xFFFF
+RF_COMPRESSION_BLOCKS = 1
+RF_TRAILER = np.dtype([('index_offset', 'u8'), ('block_rays', 'u4'), ('blocks', 'u4'), ('magic', 'S8')])
+RF_INDEX_MAGIC = b'C1812RI'
+RF_RUN_FLAG = 0x80
+RF_MIN_RUN = 3
+
+
+def _rle_decode(encoded, size):
+    out = bytearray(size)
+    i = o = 0
+    while i < len(encoded):
+        c = encoded[i]
+        i += 1
+        if c & RF_RUN_FLAG:
+            run = c - RF_RUN_FLAG + RF_MIN_RUN
+            out[o:o + run] = encoded[i:i + 1] * run
+            i += 1
+        else:
+            run = c + 1
+            out[o:o + run] = encoded[i:i + run]
+            i += run
+        o += run
+    return out
+
+
+def _decode_block(encoded, rays, ray_samples, sample_type):
+    # Inverse of rfcodec_encode(): run-length, byte shuffle, delta against the previous ray
+    count = rays * ray_samples
+    itemsize = sample_type.itemsize
+    shuffled = np.frombuffer(_rle_decode(encoded, count * itemsize), dtype=np.uint8).reshape(itemsize, count)
+    deltas = np.ascontiguousarray(shuffled.T).view(sample_type.str[0] + 'u%d' % itemsize).astype('u%d' % itemsize)
+    samples = np.cumsum(deltas.reshape(rays, ray_samples), axis=0, dtype=deltas.dtype)
+    return samples.view(sample_type.newbyteorder('='))
+
+
+def _read_blocks(path, order, sample_type, rays, ray_samples):
+    # Blocks are independent, so they are decoded in parallel
+    data = np.fromfile(path, dtype=np.uint8)
+    trailer = data[-RF_TRAILER.itemsize:].view(RF_TRAILER.newbyteorder(order))[0]
+    if trailer['magic'] != RF_INDEX_MAGIC:
+        raise ValueError('damaged block index')
+    block_rays = int(trailer['block_rays'])
+    index_end = int(trailer['index_offset']) + int(trailer['blocks']) * 16
+    index = data[int(trailer['index_offset']):index_end].view(order + 'u8').reshape(-1, 2)
+
+    def decode(b):
+        offset, size = int(index[b, 0]), int(index[b, 1])
+        block = min(block_rays, rays - b * block_rays)
+        return _decode_block(data[offset:offset + size].tobytes(), block, ray_samples, sample_type)
+
+    with ThreadPoolExecutor() as executor:
+        return np.concatenate(list(executor.map(decode, range(len(index)))))
+
+
+def read_rf(path, channel=0):
+    """Return (x0, y0, radius, ares, rays) of an .rf file, rays being an (angles, n) array of one channel."""
+    with open(path, 'rb') as f:
+        magic = f.read(len(RF_MAGIC))
+        f.seek(12)
+        byte_order = f.read(4)
+
+    if magic != RF_MAGIC:
+        # Version 1, a bare header followed by rays of doubles
+        header = np.fromfile(path, dtype=RF_V1_HEADER, count=1)[0]
+        n = int(header['n'])
+        data = np.memmap(path, dtype='f8', mode='r', offset=RF_V1_HEADER.itemsize)
+        rays = data[:data.size // n * n].reshape(-1, n)
+        return header['txx'], header['txy'], header['radius'], header['ares'], rays
+
+    # The file is in the byte order of the machine that wrote it
+    order = '<' if byte_order == RF_BYTE_ORDER_MARK.to_bytes(4, 'little') else '>'
+    header = np.fromfile(path, dtype=RF_V2_HEADER.newbyteorder(order), count=1)[0]
+    channels = np.fromfile(path, dtype=RF_V2_CHANNEL.newbyteorder(order), count=int(header['channels']),
+                           offset=RF_V2_HEADER.itemsize)
+
+    sample_type = RF_SAMPLE_TYPES[header['type']]
+    shape = (int(header['rays']), int(header['channels']), int(header['n']))
+    if header['compression'] == RF_COMPRESSION_BLOCKS:
+        data = _read_blocks(path, order, np.dtype(sample_type).newbyteorder(order), shape[0], shape[1] * shape[2])
+        data = data.reshape(shape)
+    else:
+        data = np.memmap(path, dtype=np.dtype(sample_type).newbyteorder(order), mode='r',
+                         offset=int(header['header_size']), shape=shape)
+    rays = data[:, channel, :]
+
+    if sample_type == 'u2':
+        info = channels[channel]
+        rays = np.where(rays == RF_U16_NAN, np.nan, info['offset'] + rays * info['scale'])
+
+    return header['txx'], header['txy'], header['radius'], header['ares'], rays
+
+
 if __name__ == '__main__':
     x0: float
     y0: float
@@ -10,31 +112,10 @@ if __name__ == '__main__':
     angles_a: np.ndarray
     losses_a: np.ndarray
 
-    with open('results.rf', 'rb') as f:
-        f.seek(0, 2)
-        file_size = f.tell()
-        print(round(file_size / 1024, 1), 'KiB')
-        f.seek(0, 0)
-
-        x0 = struct.unpack('d', f.read(8))[0]
-        y0 = struct.unpack('d', f.read(8))[0]
-        radius = struct.unpack('d', f.read(8))[0]
-        ares = struct.unpack('d', f.read(8))[0]
-        n = struct.unpack('i', f.read(4))[0]
-
-        losses = []
-        angles = []
-        angle = 0.0
-        while f.tell() < file_size:
-            ray = np.zeros(n)
-            for i in range(0, n):
-                ray[i] = struct.unpack('d', f.read(8))[0]
-            losses.append(ray)
-            angles.append(angle)
-            angle += ares
-
-        angles_a = np.array(angles)
-        losses_a = np.array(losses)
+    print(round(os.path.getsize('results.rf') / 1024, 1), 'KiB')
+    x0, y0, radius, ares, losses_a = read_rf('results.rf')
+    n = losses_a.shape[1]
+    angles_a = np.arange(losses_a.shape[0]) * ares
 
     distances_a = np.linspace(0, radius, num=n)
 
@@ -1,21 +1,33 @@
 #include "beta0.h"
 #include "custom_math.h"
 
-double beta0(double phi, double dtm, double dlm)
+void beta0_prepare(real_t phi, beta0_prepared_t *prepared)
 {
-    double tau = 1 - c_exp(-c_pow(4.12e-4 * c_pow(dlm, 2.41), 1));                                         // (3)
-    double mu1 = c_pow(c_pow(10, -dtm / (16 - 6.6 * tau)) + c_pow(10, -5 * (0.496 + 0.354 * tau)), 0.2); // (2)
-    mu1 = c_min(mu1, 1.0);
-
-    double mu4;
     if (c_abs(phi) <= 70)
     {
-        mu4 = c_pow(mu1, -0.935 + 0.0176 * c_abs(phi));           // (4)
-        return c_pow(10, -0.015 * c_abs(phi) + 1.67) * mu1 * mu4; // (5)
+        prepared->mu4_exponent = -0.935 + 0.0176 * c_abs(phi); // (4)
+        prepared->scale = c_pow(10, -0.015 * c_abs(phi) + 1.67); // (5)
     }
     else
     {
-        mu4 = c_pow(mu1, 0.3);   // (4)
-        return 4.17 * mu1 * mu4; // (5)
+        prepared->mu4_exponent = 0.3; // (4)
+        prepared->scale = 4.17;       // (5)
     }
+}
+
+real_t beta0_prepared(const beta0_prepared_t *prepared, real_t dtm, real_t dlm)
+{
+    real_t tau = 1 - c_exp(-c_pow(4.12e-4 * c_pow(dlm, 2.41), 1));                                         // (3)
+    real_t mu1 = c_pow(c_pow(10, -dtm / (16 - 6.6 * tau)) + c_pow(10, -5 * (0.496 + 0.354 * tau)), 0.2); // (2)
+    mu1 = c_min(mu1, 1.0);
+
+    real_t mu4 = c_pow(mu1, prepared->mu4_exponent); // (4)
+    return prepared->scale * mu1 * mu4;              // (5)
+}
+
+real_t beta0(real_t phi, real_t dtm, real_t dlm)
+{
+    beta0_prepared_t prepared;
+    beta0_prepare(phi, &prepared);
+    return beta0_prepared(&prepared, dtm, dlm);
 }
\ No newline at end of file
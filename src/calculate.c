@@ -3,6 +3,7 @@
 
 #include "beta0.h"
 #include "smooth_earth_heights.h"
+#include "profile_analysis.h"
 #include "pl_los.h"
 #include "dl_p.h"
 #include "inv_cum_norm.h"
@@ -12,6 +13,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #define ER 6371.0
 #define DEBUG 0
@@ -19,62 +21,163 @@
 typedef struct
 {
 	// Copied from parameters
-	double p;	// time percentage [%]
-	double f;	// frequency [GHz]
+	real_t p;	// time percentage [%]
+	real_t f;	// frequency [GHz]
 	int n;		// number of points
-	double *d;	// path distances [km]
-	double *h;	// path heights [m]
-	double *Ct; // representative clutter heights [m]
-	double htg; // transmitter height above ground [m]
-	double hrg; // receiver height above ground [m]
-	double DN;
+	real_t *d;	// path distances [km]
+	real_t *h;	// path heights [m]
+	real_t *Ct; // representative clutter heights [m]
+	real_t htg; // transmitter height above ground [m]
+	real_t hrg; // receiver height above ground [m]
+	real_t DN;
 
 	// Calculated in c1812_calculate
-	double lambda; // wavelength [m]
-	double dtot;   // total great-circle path distance [km]
-	double dtm;	   // longest continuous land section of the great-circle path [km]
-	double dlm;	   // longest continuous inland section of the great-circle path [km]
-	double b0;	   // beta0
-	double ae, ab;
-	double omega; // fraction of the path over sea
+	real_t lambda; // wavelength [m]
+	real_t dtot;   // total great-circle path distance [km]
+	real_t dtm;	   // longest continuous land section of the great-circle path [km]
+	real_t dlm;	   // longest continuous inland section of the great-circle path [km]
+	real_t b0;	   // beta0
+	real_t ae, ab;
+	real_t omega; // fraction of the path over sea
 
 	// Calculated in smooth_earth_heights
-	double hts; // transmitter height above mean sea level [m]
-	double hrs; // receiver height above mean sea level [m]
-	double htc;
-	double hrc;
-	double hst;
-	double hsr;
-	double hstp;
-	double hsrp;
-	double hstd;
-	double hsrd;
-	double hte;
-	double hre;
-	double theta;
-	double dlt;
-	double dlr;
-	double dct;
-	double dcr;
-	double hm;
-	double theta_t;
-	double theta_r;
-
-	// Optional caches
-	double *v1_cache;
-	double *v2_cache;
-	double *theta_max_cache;
-	double *theta_r_cache;
-	double *kindex_cache;
-	double *numax_cache;
+	real_t hts; // transmitter height above mean sea level [m]
+	real_t hrs; // receiver height above mean sea level [m]
+	real_t htc;
+	real_t hrc;
+	real_t hst;
+	real_t hsr;
+	real_t hstp;
+	real_t hsrp;
+	real_t hstd;
+	real_t hsrd;
+	real_t hte;
+	real_t hre;
+	real_t theta;
+	real_t dlt;
+	real_t dlr;
+	real_t dct;
+	real_t dcr;
+	real_t hm;
+	real_t theta_t;
+	real_t theta_r;
+
+	// Job-invariant values
+	const c1812_prepared_t *prepared;
+
+	// Optional prefix cache of the profile
+	seh_cache_t *seh_cache;
+
+	// Optional incremental profile analysis state
+	seh_state_t *seh_state;
+
+	// Optional incremental Bullington state for ae and ab
+	dl_bull_hull_t *hull_ae;
+	dl_bull_hull_t *hull_ab;
+
+	// Single-pass profile reductions, set in calculate_path when no incremental state is used
+	const profile_analysis_output_t *analysis;
 
 } c1812_calculate_ctx_t;
 
-void copy_parameters_to_ctx(c1812_parameters_t *parameters, c1812_calculate_ctx_t *ctx)
+struct c1812_workspace
 {
+	int n_max;
+	seh_cache_t seh_cache;
+	real_t *scratch; // 8 * n_max elements for c1812_calculate_ray()
+
+	// Backing allocations of the cache and the scratch memory
+	real_t *reals;
+	unsigned int *stamps;
+};
+
+c1812_workspace_t *c1812_workspace_create(int n_max)
+{
+	c1812_workspace_t *workspace = malloc(sizeof(c1812_workspace_t));
+	if (workspace == NULL)
+		return NULL;
+
+	workspace->n_max = n_max;
+	workspace->reals = malloc((3 * (n_max + 1) + 8 * n_max) * sizeof(real_t));
+	workspace->stamps = calloc(2 * (n_max + 1), sizeof(unsigned int));
+	if (workspace->reals == NULL || workspace->stamps == NULL)
+	{
+		c1812_workspace_free(workspace);
+		return NULL;
+	}
+
+	// Stamps start at 0, so generation 1 begins with every entry stale
+	workspace->seh_cache.generation = 1;
+	workspace->seh_cache.v1_v2_stamp = workspace->stamps;
+	workspace->seh_cache.theta_max_stamp = workspace->stamps + (n_max + 1);
+	workspace->seh_cache.v1 = workspace->reals;
+	workspace->seh_cache.v2 = workspace->seh_cache.v1 + (n_max + 1);
+	workspace->seh_cache.theta_max = workspace->seh_cache.v2 + (n_max + 1);
+	workspace->scratch = workspace->seh_cache.theta_max + (n_max + 1);
+
+	return workspace;
+}
+
+void c1812_workspace_free(c1812_workspace_t *workspace)
+{
+	if (workspace == NULL)
+		return;
+
+	free(workspace->reals);
+	free(workspace->stamps);
+	free(workspace);
+}
+
+void c1812_workspace_invalidate(c1812_workspace_t *workspace)
+{
+	workspace->seh_cache.generation++;
+
+	// After a wrap-around old stamps could match again, start over from a clean slate
+	if (workspace->seh_cache.generation == 0)
+	{
+		memset(workspace->stamps, 0, 2 * (workspace->n_max + 1) * sizeof(unsigned int));
+		workspace->seh_cache.generation = 1;
+	}
+}
+
+void c1812_prepare(c1812_parameters_t *parameters, c1812_prepared_t *prepared)
+{
+	prepared->lambda = 0.2998 / parameters->f;
+
+	prepared->ae = ER * (157 / (157 - parameters->DN)); // (6) (7a)
+	prepared->ab = ER * 3;								  // (7b)
+
+	prepared->inv_cum_norm_p = inv_cum_norm(parameters->p / 100);
+
+	// Location variability of losses (Section 4.8)
+	prepared->Lloc = 0.0; // outdoors only (67a)
+	if (parameters->zone != RC_ZONE_SEA)
+	{
+		// TODO parametrize
+		real_t pL = 50;		 // 50% of locations
+		real_t sigmaL = 5.5; // dB
+		prepared->Lloc = -inv_cum_norm(pL / 100.0) * sigmaL;
+	}
+
+	prepared->omega = 0.0; // TEMPORARY
+
+	beta0_prepare(parameters->lat, &prepared->beta0);
+	prepared->dl_se_ft_func = dl_se_ft_select(parameters->pol, prepared->omega);
+	dl_se_ft_prepare(prepared->ae, parameters->f, &prepared->dl_se_ft_ae);
+	dl_se_ft_prepare(prepared->ab, parameters->f, &prepared->dl_se_ft_ab);
+	tl_anomalous_prepare(parameters->f, &prepared->tl_anomalous);
+	tl_tropo_prepare(parameters->f, parameters->p, &prepared->tl_tropo);
+}
+
+void copy_parameters_to_ctx(c1812_parameters_t *parameters, const c1812_prepared_t *prepared, c1812_calculate_ctx_t *ctx)
+{
+	ctx->prepared = prepared;
+
 	ctx->p = parameters->p;
 	ctx->f = parameters->f;
-	ctx->lambda = 0.2998 / ctx->f;
+	ctx->lambda = prepared->lambda;
+	ctx->ae = prepared->ae;
+	ctx->ab = prepared->ab;
 
 	ctx->htg = parameters->htg;
 	ctx->hrg = parameters->hrg;
@@ -85,9 +188,11 @@ void copy_parameters_to_ctx(c1812_parameters_t *parameters, c1812_calculate_ctx_
 	ctx->h = parameters->h;
 	ctx->Ct = parameters->Ct;
 
-	ctx->v1_cache = parameters->v1_cache;
-	ctx->v2_cache = parameters->v2_cache;
-	ctx->theta_max_cache = parameters->theta_max_cache;
+	ctx->seh_cache = NULL;
+	ctx->seh_state = NULL;
+	ctx->hull_ae = NULL;
+	ctx->hull_ab = NULL;
+	ctx->analysis = NULL;
 }
 
 void copy_ctx_to_seh_input(c1812_calculate_ctx_t *ctx, seh_input_t *input)
@@ -101,9 +206,23 @@ void copy_ctx_to_seh_input(c1812_calculate_ctx_t *ctx, seh_input_t *input)
 	input->htg = ctx->htg;
 	input->hrg = ctx->hrg;
 	input->ae = ctx->ae;
-	input->v1_cache = ctx->v1_cache;
-	input->v2_cache = ctx->v2_cache;
-	input->theta_max_cache = ctx->theta_max_cache;
+	input->cache = ctx->seh_cache;
+	input->state = ctx->seh_state;
+	input->analysis = ctx->analysis;
+}
+
+void copy_ctx_to_profile_analysis_input(c1812_calculate_ctx_t *ctx, profile_analysis_input_t *input)
+{
+	input->n = ctx->n;
+	input->d = ctx->d;
+	input->h = ctx->h;
+	input->Ct = ctx->Ct;
+	input->dtot = ctx->dtot;
+	input->lambda = ctx->lambda;
+	input->htg = ctx->htg;
+	input->hrg = ctx->hrg;
+	input->ae = ctx->ae;
+	input->ab = ctx->ab;
 }
 
 void copy_seh_output_to_ctx(seh_output_t *output, c1812_calculate_ctx_t *ctx)
@@ -159,6 +278,14 @@ void copy_ctx_to_dl_p_input(c1812_calculate_ctx_t *ctx, dl_p_input_t *input)
 	input->p = ctx->p;
 	input->b0 = ctx->b0;
 	input->DN = ctx->DN;
+	input->hull_ae = ctx->hull_ae;
+	input->hull_ab = ctx->hull_ab;
+	input->bull_profile_ae = (ctx->analysis != NULL) ? &ctx->analysis->bull_ae : NULL;
+	input->bull_profile_ab = (ctx->analysis != NULL) ? &ctx->analysis->bull_ab : NULL;
+	input->se_ft_ae = &ctx->prepared->dl_se_ft_ae;
+	input->se_ft_ab = &ctx->prepared->dl_se_ft_ab;
+	input->se_ft_func = ctx->prepared->dl_se_ft_func;
+	input->inv_cum_norm_p = ctx->prepared->inv_cum_norm_p;
 }
 
 void copy_ctx_to_tl_anomalous_input(c1812_calculate_ctx_t *ctx, tl_anomalous_input_t *input)
@@ -181,6 +308,7 @@ void copy_ctx_to_tl_anomalous_input(c1812_calculate_ctx_t *ctx, tl_anomalous_inp
 	input->omega = ctx->omega;
 	input->ae = ctx->ae;
 	input->b0 = ctx->b0;
+	input->prepared = &ctx->prepared->tl_anomalous;
 }
 
 void copy_ctx_to_tl_tropo_input(c1812_calculate_ctx_t *ctx, tl_tropo_input_t *input)
@@ -190,150 +318,160 @@ void copy_ctx_to_tl_tropo_input(c1812_calculate_ctx_t *ctx, tl_tropo_input_t *in
 	input->f = ctx->f;
 	input->p = ctx->p;
 	input->N0 = ctx->DN;
+	input->prepared = &ctx->prepared->tl_tropo;
 }
 
-void c1812_calculate(c1812_parameters_t *parameters, c1812_results_t *results)
+void calculate_path(c1812_parameters_t *parameters, c1812_calculate_ctx_t *ctx, c1812_results_t *results)
 {
 	results->error = RESULTS_ERR_UNKNOWN;
+	results->parameters_error = PARAM_ERR_NONE;
 
-	c1812_calculate_ctx_t ctx;
-	copy_parameters_to_ctx(parameters, &ctx);
+	// The profile analysis takes d[i] as the distance from the transmitter, so the profile must start there
+	if (ctx->d[0] != 0)
+	{
+		results->parameters_error = PARAM_ERR_INVALID_DISTANCE_FROM_TRANSMITTER;
+		return;
+	}
 
 	// Compute dtot - the total great-circle path distance (km)
-	ctx.dtot = parameters->d[parameters->n - 1] - parameters->d[0];
+	ctx->dtot = ctx->d[ctx->n - 1] - ctx->d[0];
 
 	// Compute dtm - the longest continuous land (inland + coastal =34) section of the great-circle path (km)
-	ctx.dtm = ((parameters->zone == RC_ZONE_INLAND) || (parameters->zone == RC_ZONE_COASTAL_LAND)) ? ctx.dtot : 0.0;
+	ctx->dtm = ((parameters->zone == RC_ZONE_INLAND) || (parameters->zone == RC_ZONE_COASTAL_LAND)) ? ctx->dtot : 0.0;
 
 	// Compute dlm - the longest continuous inland section (4) of the great-circle path (km)
-	ctx.dlm = (parameters->zone == RC_ZONE_INLAND) ? ctx.dtot : 0.0;
+	ctx->dlm = (parameters->zone == RC_ZONE_INLAND) ? ctx->dtot : 0.0;
 
 	// TODO distance to sea [km]
-	ctx.dct = ctx.dcr = 500.0;
+	ctx->dct = ctx->dcr = 500.0;
 
 	// Compute b0
-	ctx.b0 = beta0(parameters->lat, ctx.dtm, ctx.dlm);
-
-	// Compute ae and ab
-	ctx.ae = ER * (157 / (157 - ctx.DN)); // (6) (7a)
-	ctx.ab = ER * 3;					  // (7b)
+	ctx->b0 = beta0_prepared(&ctx->prepared->beta0, ctx->dtm, ctx->dlm);
 
 	// Compute the path fraction over sea Eq (1)
-	ctx.omega = 0.0; // TEMPORARY
+	ctx->omega = ctx->prepared->omega;
+
+	// Without an incremental state or a prefix cache to draw on, the profile reductions of the
+	// smooth-Earth heights and of both Bullington passes come from one traversal
+	profile_analysis_output_t analysis;
+	if (ctx->seh_state == NULL && ctx->seh_cache == NULL && ctx->hull_ae == NULL && ctx->hull_ab == NULL)
+	{
+		profile_analysis_input_t analysis_input;
+		copy_ctx_to_profile_analysis_input(ctx, &analysis_input);
+		profile_analysis(&analysis_input, &analysis);
+		ctx->analysis = &analysis;
+	}
 
 	// Derive parameters for the path profile analysis
 	seh_input_t seh_input;
-	copy_ctx_to_seh_input(&ctx, &seh_input);
+	copy_ctx_to_seh_input(ctx, &seh_input);
 	seh_output_t seh_output;
 	smooth_earth_heights(&seh_input, &seh_output);
-	copy_seh_output_to_ctx(&seh_output, &ctx);
+	copy_seh_output_to_ctx(&seh_output, ctx);
 
 #if DEBUG == 1
-	printf("d (km) = %f\n", ctx.dtot);
-	printf("dlt (km) = %f\n", ctx.dlt);
-	printf("dlr (km) = %f\n", ctx.dlr);
-	printf("th_t (mrad) = %f\n", ctx.theta_t);
-	printf("th_r (mrad) = %f\n", ctx.theta_r);
-	printf("th (mrad) = %f\n", ctx.theta);
-	printf("hts (m) = %f\n", ctx.hts);
-	printf("hrs (m) = %f\n", ctx.hrs);
-	printf("htc (m) = %f\n", ctx.htc);
-	printf("hrc (m) = %f\n", ctx.hrc);
-	printf("w = %f\n", ctx.omega);
-	printf("dtm (km) = %f\n", ctx.dtm);
-	printf("dlm (km) = %f\n", ctx.dlm);
+	printf("d (km) = %f\n", ctx->dtot);
+	printf("dlt (km) = %f\n", ctx->dlt);
+	printf("dlr (km) = %f\n", ctx->dlr);
+	printf("th_t (mrad) = %f\n", ctx->theta_t);
+	printf("th_r (mrad) = %f\n", ctx->theta_r);
+	printf("th (mrad) = %f\n", ctx->theta);
+	printf("hts (m) = %f\n", ctx->hts);
+	printf("hrs (m) = %f\n", ctx->hrs);
+	printf("htc (m) = %f\n", ctx->htc);
+	printf("hrc (m) = %f\n", ctx->hrc);
+	printf("w = %f\n", ctx->omega);
+	printf("dtm (km) = %f\n", ctx->dtm);
+	printf("dlm (km) = %f\n", ctx->dlm);
 	printf("phi (deg) = %f\n", parameters->lat);
-	printf("b0 (%%) = %f\n", ctx.b0);
-	printf("ae (km) = %f\n", ctx.ae);
-	printf("hst (m) = %f\n", ctx.hst);
-	printf("hsr (m) = %f\n", ctx.hsr);
-	printf("hst (m) = %f\n", ctx.hst);
-	printf("hsr (m) = %f\n", ctx.hsr);
-	printf("hstd (m) = %f\n", ctx.hstd);
-	printf("hsrd (m) = %f\n", ctx.hsrd);
-	printf("htc' (m) = %f\n", ctx.htc - ctx.hstd);
-	printf("hrc' (m) = %f\n", ctx.hrc - ctx.hsrd);
-	printf("hte (m) = %f\n", ctx.hte);
-	printf("hre (m) = %f\n", ctx.hre);
-	printf("hm (m) = %f\n", ctx.hm);
+	printf("b0 (%%) = %f\n", ctx->b0);
+	printf("ae (km) = %f\n", ctx->ae);
+	printf("hst (m) = %f\n", ctx->hst);
+	printf("hsr (m) = %f\n", ctx->hsr);
+	printf("hst (m) = %f\n", ctx->hst);
+	printf("hsr (m) = %f\n", ctx->hsr);
+	printf("hstd (m) = %f\n", ctx->hstd);
+	printf("hsrd (m) = %f\n", ctx->hsrd);
+	printf("htc' (m) = %f\n", ctx->htc - ctx->hstd);
+	printf("hrc' (m) = %f\n", ctx->hrc - ctx->hsrd);
+	printf("hte (m) = %f\n", ctx->hte);
+	printf("hre (m) = %f\n", ctx->hre);
+	printf("hm (m) = %f\n", ctx->hm);
 	printf("\n");
 #endif
 
 	// pl_los
 	pl_los_input_t pl_los_input;
-	copy_ctx_to_pl_los_input(&ctx, &pl_los_input);
+	copy_ctx_to_pl_los_input(ctx, &pl_los_input);
 	pl_los_output_t pl_los_output;
 	pl_los(&pl_los_input, &pl_los_output);
 
 	// dl_p
 	dl_p_input_t dl_p_input;
-	copy_ctx_to_dl_p_input(&ctx, &dl_p_input);
+	copy_ctx_to_dl_p_input(ctx, &dl_p_input);
 	dl_p_output_t dl_p_output;
 	dl_p(&dl_p_input, &dl_p_output);
 
 	// The median basic transmission loss associated with diffraction Eq (42)
-	double Lbd50 = pl_los_output.Lbfs + dl_p_output.Ld50[parameters->pol];
+	real_t Lbd50 = pl_los_output.Lbfs + dl_p_output.Ld50[parameters->pol];
 
 	// The basic tranmission loss associated with diffraction not exceeded for
 	// p% time Eq (43)
-	double Lbd = pl_los_output.Lb0p + dl_p_output.Ldp[parameters->pol];
+	real_t Lbd = pl_los_output.Lb0p + dl_p_output.Ldp[parameters->pol];
 
 	// A notional minimum basic transmission loss associated with LoS
 	// propagation and over-sea sub-path diffraction
-	double Lminb0p = pl_los_output.Lb0p + (1 - ctx.omega) * dl_p_output.Ldp[parameters->pol];
+	real_t Lminb0p = pl_los_output.Lb0p + (1 - ctx->omega) * dl_p_output.Ldp[parameters->pol];
 
 	// eq (40a)
-	double Fi = 1;
-	if (ctx.p >= ctx.b0)
+	real_t Fi = 1;
+	if (ctx->p >= ctx->b0)
 	{
-		Fi = inv_cum_norm(ctx.p / 100) / inv_cum_norm(ctx.b0 / 100);
-		Lminb0p = Lbd50 + (pl_los_output.Lb0b + (1 - ctx.omega) * dl_p_output.Ldp[0] - Lbd50) * Fi; // eq (59)
+		Fi = ctx->prepared->inv_cum_norm_p / inv_cum_norm(ctx->b0 / 100);
+		Lminb0p = Lbd50 + (pl_los_output.Lb0b + (1 - ctx->omega) * dl_p_output.Ldp[parameters->pol] - Lbd50) * Fi; // eq (59)
 	}
 
 	// Calculate an interpolation factor Fj to take account of the path angular
 	// distance Eq (57)
-	const double THETA = 0.3;
-	const double KSI = 0.8;
-	double Fj = 1.0 - 0.5 * (1.0 + c_tanh(3.0 * KSI * (ctx.theta - THETA) / THETA));
+	const real_t THETA = 0.3;
+	const real_t KSI = 0.8;
+	real_t Fj = 1.0 - 0.5 * (1.0 + c_tanh(3.0 * KSI * (ctx->theta - THETA) / THETA));
 
 	// Calculate an interpolation factor, Fk, to take account of the great
 	// circle path distance:
-	const double dsw = 20;
-	const double kappa = 0.5;
-	double Fk = 1.0 - 0.5 * (1.0 + c_tanh(3.0 * kappa * (ctx.dtot - dsw) / dsw)); // eq (58)
+	const real_t dsw = 20;
+	const real_t kappa = 0.5;
+	real_t Fk = 1.0 - 0.5 * (1.0 + c_tanh(3.0 * kappa * (ctx->dtot - dsw) / dsw)); // eq (58)
 
 	// Calculate the transmission loss due to anomalous propagation
 	tl_anomalous_output_t tl_anomalous_output;
 	tl_anomalous_input_t tl_anomalous_input;
-	copy_ctx_to_tl_anomalous_input(&ctx, &tl_anomalous_input);
+	copy_ctx_to_tl_anomalous_input(ctx, &tl_anomalous_input);
 
 	tl_anomalous(&tl_anomalous_input, &tl_anomalous_output);
-	double Lba = tl_anomalous_output.Lba;
+	real_t Lba = tl_anomalous_output.Lba;
 
-	const double eta = 2.5;
-	double Lminbap = eta * c_log(c_exp(Lba / eta) + c_exp(pl_los_output.Lb0p / eta)); // eq (60)
-	double Lbda = Lbd;
+	const real_t eta = 2.5;
+	// eq (60), with the larger loss factored out so that exp() stays in range in the float build
+	real_t Lmax = c_max(Lba, pl_los_output.Lb0p);
+	real_t Lminbap = Lmax + eta * c_log(c_exp((Lba - Lmax) / eta) + c_exp((pl_los_output.Lb0p - Lmax) / eta));
+	real_t Lbda = Lbd;
 	if (Lminbap <= Lbd)
 		Lbda = Lminbap + (Lbd - Lminbap) * Fk;
 
-	double Lbam = Lbda + (Lminb0p - Lbda) * Fj; // eq (62)
+	real_t Lbam = Lbda + (Lminb0p - Lbda) * Fj; // eq (62)
 
 	tl_tropo_output_t tl_tropo_output;
 	tl_tropo_input_t tl_tropo_input;
-	copy_ctx_to_tl_tropo_input(&ctx, &tl_tropo_input);
+	copy_ctx_to_tl_tropo_input(ctx, &tl_tropo_input);
 	tl_tropo(&tl_tropo_input, &tl_tropo_output);
 
-	double Lbc = -5 * c_log10(c_pow(10, -0.2 * tl_tropo_output.Lbs) + c_pow(10, -0.2 * Lbam));
+	// Power sum of the two losses, again relative to the smaller one to keep 10^(-0.2 L) in range
+	real_t Lmin = c_min(tl_tropo_output.Lbs, Lbam);
+	real_t Lbc = Lmin - 5 * c_log10(c_pow(10, -0.2 * (tl_tropo_output.Lbs - Lmin)) + c_pow(10, -0.2 * (Lbam - Lmin)));
 
 	// Location variability of losses (Section 4.8)
-	double Lloc = 0.0; // outdoors only (67a)
-	if (parameters->zone != RC_ZONE_SEA)
-	{
-		// TODO parametrize
-		double pL = 50;		 // 50% of locations
-		double sigmaL = 5.5; // dB
-		Lloc = -inv_cum_norm(pL / 100.0) * sigmaL;
-	}
+	real_t Lloc = ctx->prepared->Lloc;
 
 	// Basic transmission loss not exceeded for p% time and pL% locations
 	// (Sections 4.8 and 4.9) not implemented
@@ -365,3 +503,94 @@ void c1812_calculate(c1812_parameters_t *parameters, c1812_results_t *results)
 	printf("Lb (dB) = %f\n", results->Lb);
 #endif
 }
+
+void c1812_calculate(c1812_parameters_t *parameters, c1812_results_t *results)
+{
+	c1812_prepared_t prepared;
+	c1812_prepare(parameters, &prepared);
+	c1812_calculate_prepared(parameters, &prepared, results);
+}
+
+void c1812_calculate_prepared(c1812_parameters_t *parameters, const c1812_prepared_t *prepared, c1812_results_t *results)
+{
+	c1812_calculate_ctx_t ctx;
+	copy_parameters_to_ctx(parameters, prepared, &ctx);
+	calculate_path(parameters, &ctx, results);
+}
+
+void c1812_calculate_ws(c1812_parameters_t *parameters, const c1812_prepared_t *prepared, c1812_workspace_t *workspace, c1812_results_t *results)
+{
+	if (parameters->n > workspace->n_max)
+	{
+		results->error = RESULTS_ERR_UNKNOWN;
+		return;
+	}
+
+	c1812_prepared_t local;
+	if (prepared == NULL)
+	{
+		c1812_prepare(parameters, &local);
+		prepared = &local;
+	}
+
+	c1812_calculate_ctx_t ctx;
+	copy_parameters_to_ctx(parameters, prepared, &ctx);
+	ctx.seh_cache = &workspace->seh_cache;
+	calculate_path(parameters, &ctx, results);
+}
+
+void c1812_calculate_ray(c1812_parameters_t *parameters, const c1812_prepared_t *prepared, c1812_workspace_t *workspace, real_t *Lb, c1812_results_t *results)
+{
+	results->error = RESULTS_ERR_UNKNOWN;
+
+	int n = parameters->n;
+	for (int i = 0; i < n && i < 2; i++)
+		Lb[i] = NAN;
+
+	if (n > workspace->n_max)
+		return;
+
+	c1812_prepared_t local;
+	if (prepared == NULL)
+	{
+		c1812_prepare(parameters, &local);
+		prepared = &local;
+	}
+
+	c1812_calculate_ctx_t ctx;
+	copy_parameters_to_ctx(parameters, prepared, &ctx);
+
+	real_t *scratch = workspace->scratch;
+
+	// Running sums, maxima and hulls of the smooth-Earth profile analysis
+	seh_state_t seh_state;
+	seh_state_init(&seh_state, scratch, n);
+	ctx.seh_state = &seh_state;
+
+	// Upper hulls of the intermediate points for both effective Earth radii
+	real_t *hull_storage = scratch + 4 * n;
+	dl_bull_hull_t hull_ae, hull_ab;
+	dl_bull_hull_init(&hull_ae, hull_storage, hull_storage + n, ctx.ae);
+	dl_bull_hull_init(&hull_ab, hull_storage + 2 * n, hull_storage + 3 * n, ctx.ab);
+	ctx.hull_ae = &hull_ae;
+	ctx.hull_ab = &hull_ab;
+
+	// Move the receiver outward, the profile of receiver i is the first i + 1 points of the ray
+	for (int i = 2; i < n; i++)
+	{
+		// Point i - 1 becomes an intermediate point once the receiver is at point i
+		real_t g = ctx.h[i - 1] + ((ctx.Ct != NULL) ? ctx.Ct[i - 1] : 0.0);
+		dl_bull_hull_push(&hull_ae, ctx.d[i - 1], g);
+		dl_bull_hull_push(&hull_ab, ctx.d[i - 1], g);
+
+		ctx.n = i + 1;
+		calculate_path(parameters, &ctx, results);
+		if (results->error != RESULTS_ERR_NONE)
+		{
+			for (int j = i; j < n; j++)
+				Lb[j] = NAN;
+			break;
+		}
+		Lb[i] = results->Lb;
+	}
+}
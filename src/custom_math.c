@@ -2,6 +2,13 @@
 #include <math.h>
 #include <stdbool.h>
 
+// libm function for real_t, sqrt -> sqrtf in the float build
+#ifdef C1812_FLOAT
+#define M(name) name##f
+#else
+#define M(name) name
+#endif
+
 #define A1 0.99997726
 #define A3 -0.33262347
 #define A5 0.19354346
@@ -9,57 +16,63 @@
 #define A9 0.05265332
 #define A11 -0.01172120
 
-double c_isnan(double x)
+real_t c_isnan(real_t x)
 {
 	return isnan(x);
 }
 
-double c_floor(double x)
+real_t c_floor(real_t x)
 {
-	return floor(x);
+	return M(floor)(x);
 }
 
-double c_ceil(double x)
+real_t c_ceil(real_t x)
 {
-	return ceil(x);
+	return M(ceil)(x);
 }
 
-double c_round(double x)
+real_t c_round(real_t x)
 {
-	return round(x);
+	return M(round)(x);
 }
 
-double c_abs(double x)
+real_t c_abs(real_t x)
 {
-	return fabs(x);
+	return M(fabs)(x);
 }
 
-double c_min(double x, double y)
+real_t c_min(real_t x, real_t y)
 {
-	return fmin(x, y);
+	return M(fmin)(x, y);
 }
 
-double c_max(double x, double y)
+real_t c_max(real_t x, real_t y)
 {
-	return fmax(x, y);
+	return M(fmax)(x, y);
 }
 
-double c_pow(double x, double y)
+real_t c_pow(real_t x, real_t y)
 {
-	return pow(x, y);
+	return M(pow)(x, y);
 }
 
-double c_atan(double x)
+real_t c_atan(real_t x)
 {
-	double x2 = x * x;
+	// The polynomial only holds on [-1, 1], reduce with atan(x) = +-pi/2 - atan(1/x)
+	if (x > 1.0)
+		return PI_2 - c_atan(1.0 / x);
+	if (x < -1.0)
+		return -PI_2 - c_atan(1.0 / x);
+
+	real_t x2 = x * x;
 	return x * (A1 + x2 * (A3 + x2 * (A5 + x2 * (A7 + x2 * (A9 + x2 * A11)))));
 }
 
-double c_atan2(double y, double x)
+real_t c_atan2(real_t y, real_t x)
 {
 	bool swap = c_abs(x) < c_abs(y);
-	double atan_input = (swap ? x : y) / (swap ? y : x);
-	double res = c_atan(atan_input);
+	real_t atan_input = (swap ? x : y) / (swap ? y : x);
+	real_t res = c_atan(atan_input);
 	res = swap ? (atan_input >= 0.0 ? PI_2 : -PI_2) - res : res;
 	if (x < 0.0 && y >= 0.0)
 		res = PI + res; // 2nd quadrant
@@ -68,52 +81,52 @@ double c_atan2(double y, double x)
 	return res;
 }
 
-double c_atan2_exact(double y, double x)
+real_t c_atan2_exact(real_t y, real_t x)
 {
-	return atan2(y, x);
+	return M(atan2)(y, x);
 }
 
-double c_exp(double x)
+real_t c_exp(real_t x)
 {
-	return exp(x);
+	return M(exp)(x);
 }
 
-double c_log(double x)
+real_t c_log(real_t x)
 {
-	return log(x);
+	return M(log)(x);
 }
 
-double c_sqrt(double x)
+real_t c_sqrt(real_t x)
 {
-	return sqrt(x);
+	return M(sqrt)(x);
 }
 
-double c_cbrt(double x)
+real_t c_cbrt(real_t x)
 {
-	return cbrt(x);
+	return M(cbrt)(x);
 }
 
-double c_log10(double x)
+real_t c_log10(real_t x)
 {
-	return log10(x);
+	return M(log10)(x);
 }
 
-double c_tanh(double x)
+real_t c_tanh(real_t x)
 {
-	return tanh(x);
+	return M(tanh)(x);
 }
 
-double c_sin(double x)
+real_t c_sin(real_t x)
 {
-	return sin(x);
+	return M(sin)(x);
 }
 
-double c_cos(double x)
+real_t c_cos(real_t x)
 {
-	return cos(x);
+	return M(cos)(x);
 }
 
-double c_acos(double x)
+real_t c_acos(real_t x)
 {
-	return acos(x);
+	return M(acos)(x);
 }
\ No newline at end of file
@@ -2,39 +2,107 @@
 #include "custom_math.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Lane width of the profile scans, a 256-bit register with AVX, 128-bit with SSE2 (any x86-64),
+// a single element otherwise: 4/2 doubles, or 8/4 floats in the float build
+#if defined(__AVX__)
+#include <immintrin.h>
+#ifdef C1812_FLOAT
+#define LANES 8
+#define LANES_SQRT(x) ((lanes_t)_mm256_sqrt_ps((__m256)(x)))
+#define LANES_MAX(x, y) ((lanes_t)_mm256_max_ps((__m256)(x), (__m256)(y)))
+#else
+#define LANES 4
+#define LANES_SQRT(x) ((lanes_t)_mm256_sqrt_pd((__m256d)(x)))
+#define LANES_MAX(x, y) ((lanes_t)_mm256_max_pd((__m256d)(x), (__m256d)(y)))
+#endif
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef C1812_FLOAT
+#define LANES 4
+#define LANES_SQRT(x) ((lanes_t)_mm_sqrt_ps((__m128)(x)))
+#define LANES_MAX(x, y) ((lanes_t)_mm_max_ps((__m128)(x), (__m128)(y)))
+#else
+#define LANES 2
+#define LANES_SQRT(x) ((lanes_t)_mm_sqrt_pd((__m128d)(x)))
+#define LANES_MAX(x, y) ((lanes_t)_mm_max_pd((__m128d)(x), (__m128d)(y)))
+#endif
+#else
+#define LANES 1
+#endif
+
+#if LANES > 1
+typedef real_t lanes_t __attribute__((vector_size(LANES * sizeof(real_t))));
+#endif
 
 #define h(input, i) ((input->h != NULL) ? input->h[i] : 0.0)
 #define Ct(input, i) ((input->Ct != NULL) ? input->Ct[i] : 0.0)
 #define g(input, i) (h(input, i) + Ct(input, i))
 
+// Knife-edge diffraction parameters at or below this value give no loss, Eq (12)
+#define NU_THRESHOLD -0.78
+
+// Pruning margin for rounding in the hull bounds on nu, which lose precision in the float build
+#define NU_BOUND_SLACK 1e-3
+
+// Set to 1 to compare the closed-form smooth profile against the full scan
+#define DEBUG_SMOOTH_PROFILE 0
+#define SMOOTH_PROFILE_TOLERANCE 1e-9
+
 void dl_bull(dl_bull_input_t *input, dl_bull_output_t *output)
+{
+    if (input->profile != NULL)
+    {
+        dl_bull_loss(input, input->profile, output);
+        return;
+    }
+
+    dl_bull_profile_t profile;
+    if (input->hull != NULL)
+        dl_bull_hull_profile(input->hull, input, &profile);
+    else
+        dl_bull_profile(input, &profile);
+
+    dl_bull_loss(input, &profile, output);
+}
+
+void dl_bull_smooth(dl_bull_input_t *input, dl_bull_output_t *output)
+{
+    dl_bull_profile_t profile;
+    dl_bull_smooth_profile(input, &profile);
+    dl_bull_loss(input, &profile, output);
+}
+
+void dl_bull_profile(dl_bull_input_t *input, dl_bull_profile_t *profile)
 {
     // Effective Earth curvature Ce (km^-1)
-    double Ce = 1 / input->ap;
+    real_t Ce = 1 / input->ap;
 
     // Calculate the slope of the line from transmitter to receiver assuming a
     // LoS path
-    double Str = (input->hrs - input->hts) / input->dtot;
+    real_t Str = (input->hrs - input->hts) / input->dtot;
 
     // Find the intermediate profile point with the highest slope of the line
     // from the transmitter to the point
-    double Stim = NEGATIVE_INFINITY;
+    real_t Stim = NEGATIVE_INFINITY;
 
     // Find the intermediate profile point with the highest diffraction
     // parameter nu:
-    double numax = NEGATIVE_INFINITY;
+    real_t numax = NEGATIVE_INFINITY;
 
     // Find the intermediate profile point with the highest slope of the
     // line from the receiver to the point
-    double Srim = NEGATIVE_INFINITY;
+    real_t Srim = NEGATIVE_INFINITY;
 
     for (int i = 1; i < input->n - 1; i++)
     {
-        double d = input->d[i];
-        double dtot_min_d = input->dtot - input->d[i];
-        double tmp = g(input, i) + 500 * Ce * d * dtot_min_d;
+        real_t d = input->d[i];
+        real_t dtot_min_d = input->dtot - input->d[i];
+        real_t tmp = g(input, i) + 500 * Ce * d * dtot_min_d;
 
-        double Sti = tmp;
+        real_t Sti = tmp;
         Sti -= input->hts;
         Sti /= d;
         if (Sti > Stim)
@@ -42,28 +110,40 @@ void dl_bull(dl_bull_input_t *input, dl_bull_output_t *output)
 
         if (Stim < Str)
         {
-            double nu = tmp;
+            real_t nu = tmp;
             nu -= (input->hts * dtot_min_d + input->hrs * d) / input->dtot;
             nu *= c_sqrt(0.002 * input->dtot / (input->lambda * d * dtot_min_d));
             if (nu > numax)
                 numax = nu;
         }
 
-        double Sri = tmp;
+        real_t Sri = tmp;
         Sri -= input->hrs;
         Sri /= dtot_min_d;
         if (Sri > Srim)
             Srim = Sri;
     }
 
+    profile->Stim = Stim;
+    profile->Srim = Srim;
+    profile->numax = numax;
+}
+
+void dl_bull_loss(dl_bull_input_t *input, const dl_bull_profile_t *profile, dl_bull_output_t *output)
+{
+    real_t Str = (input->hrs - input->hts) / input->dtot;
+    real_t Stim = profile->Stim;
+    real_t Srim = profile->Srim;
+    real_t numax = profile->numax;
+
     // Knife-edge diffraction loss
-    double Luc = 0.0;
+    real_t Luc = 0.0;
 
     if (Stim < Str)
     { // Case 1, Path is LoS
 
         // ... extracted to fused loop
-        if (numax > -0.78)
+        if (numax > NU_THRESHOLD)
         {
             numax -= 0.1;
             Luc = 6.9 + 20 * c_log10(c_sqrt(numax * numax + 1) + numax); // Eq (12), (16)
@@ -74,14 +154,14 @@ void dl_bull(dl_bull_input_t *input, dl_bull_output_t *output)
         // ... extracted to fused loop
 
         // Calculate the distance of the Bullington point from the transmitter:
-        double dbp = (input->hrs - input->hts + Srim * input->dtot) / (Stim + Srim); // Eq (18)
+        real_t dbp = (input->hrs - input->hts + Srim * input->dtot) / (Stim + Srim); // Eq (18)
 
         // Calculate the diffraction parameter, nub, for the Bullington point
-        double nub = input->hts + Stim * dbp - (input->hts * (input->dtot - dbp) + input->hrs * dbp) / input->dtot;
+        real_t nub = input->hts + Stim * dbp - (input->hts * (input->dtot - dbp) + input->hrs * dbp) / input->dtot;
         nub *= c_sqrt(0.002 * input->dtot / (input->lambda * dbp * (input->dtot - dbp))); // Eq (20)
 
         // The knife-edge loss for the Bullington point is given by
-        if (nub > -0.78)
+        if (nub > NU_THRESHOLD)
         {
             nub -= 0.1;
             Luc = 6.9 + 20 * c_log10(c_sqrt(nub * nub + 1) + nub); // Eq (12), (20)
@@ -92,3 +172,277 @@ void dl_bull(dl_bull_input_t *input, dl_bull_output_t *output)
     // for the path is given by
     output->Lbull = Luc + (1 - c_exp(-Luc / 6.0)) * (10 + 0.02 * input->dtot); // Eq(21)
 }
+
+void dl_bull_hull_init(dl_bull_hull_t *hull, real_t *x, real_t *y, real_t ap)
+{
+    hull->Ce = 1 / ap;
+    upper_hull_init(&hull->points, x, y);
+}
+
+void dl_bull_hull_push(dl_bull_hull_t *hull, real_t d, real_t g)
+{
+    upper_hull_push(&hull->points, d, g - 500 * hull->Ce * d * d);
+}
+
+// Last intermediate point with d[i] <= target, or the first one if there is none
+int _dl_bull_locate(dl_bull_input_t *input, real_t target)
+{
+    int lo = 1, hi = input->n - 2;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (input->d[mid] <= target)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+// Highest diffraction parameter over the intermediate points first .. last of a LoS path
+// (Stim < Str). Every point is independent, so the scan runs LANES points at a time
+real_t _dl_bull_los_numax(dl_bull_input_t *input, real_t Ce, int first, int last)
+{
+    real_t numax = NEGATIVE_INFINITY;
+    int i = first;
+
+#if LANES > 1
+    lanes_t numax_lanes;
+    lanes_t zero;
+    for (int l = 0; l < LANES; l++)
+    {
+        numax_lanes[l] = NEGATIVE_INFINITY;
+        zero[l] = 0.0;
+    }
+
+    // Scalars as real_t, vector-scalar operations do not narrow implicitly
+    real_t dtot = input->dtot, hts = input->hts, hrs = input->hrs, lambda = input->lambda;
+    real_t k = 500 * Ce;
+    real_t w = 0.002 * input->dtot;
+
+    for (; i + LANES <= last + 1; i += LANES)
+    {
+        lanes_t d, g;
+        memcpy(&d, input->d + i, sizeof(lanes_t));
+        if (input->h != NULL)
+            memcpy(&g, input->h + i, sizeof(lanes_t));
+        else
+            g = zero;
+        if (input->Ct != NULL)
+        {
+            lanes_t Ct;
+            memcpy(&Ct, input->Ct + i, sizeof(lanes_t));
+            g = g + Ct;
+        }
+        else
+        {
+            g = g + zero;
+        }
+
+        lanes_t dtot_min_d = dtot - d;
+        lanes_t nu = g + k * d * dtot_min_d;
+        nu -= (hts * dtot_min_d + hrs * d) / dtot;
+        nu *= LANES_SQRT(w / (lambda * d * dtot_min_d));
+
+        // NaN lanes keep the running maximum, like the comparison below
+        numax_lanes = LANES_MAX(nu, numax_lanes);
+    }
+
+    for (int l = 0; l < LANES; l++)
+        if (numax_lanes[l] > numax)
+            numax = numax_lanes[l];
+#endif
+
+    for (; i <= last; i++)
+    {
+        real_t d = input->d[i];
+        real_t dtot_min_d = input->dtot - input->d[i];
+        real_t nu = g(input, i) + 500 * Ce * d * dtot_min_d;
+        nu -= (input->hts * dtot_min_d + input->hrs * d) / input->dtot;
+        nu *= c_sqrt(0.002 * input->dtot / (input->lambda * d * dtot_min_d));
+        if (nu > numax)
+            numax = nu;
+    }
+
+    return numax;
+}
+
+// Clearance of hull vertex k above the line between the antennas, y - (hts + slope * d)
+real_t _dl_bull_clearance(dl_bull_input_t *input, upper_hull_t *points, real_t slope, int k)
+{
+    return points->y[k] - (input->hts + slope * points->x[k]);
+}
+
+void dl_bull_hull_profile(dl_bull_hull_t *hull, dl_bull_input_t *input, dl_bull_profile_t *profile)
+{
+    upper_hull_t *points = &hull->points;
+    if (points->size == 0)
+    {
+        profile->Stim = NEGATIVE_INFINITY;
+        profile->Srim = NEGATIVE_INFINITY;
+        profile->numax = NEGATIVE_INFINITY;
+        return;
+    }
+
+    real_t Ce = hull->Ce;
+    real_t dtot = input->dtot;
+
+    // With y = g - 500 * Ce * d^2 the profile heights above the chord become
+    // g + 500 * Ce * d * (dtot - d) = y + 500 * Ce * dtot * d, so
+    // Sti = (y - hts) / d + 500 * Ce * dtot
+    // Sri = (y - yr) / (dtot - d) - 500 * Ce * dtot, with yr = hrs - 500 * Ce * dtot^2
+    real_t yr = input->hrs - 500 * Ce * dtot * dtot;
+
+    int t = upper_hull_tangent_left(points, 0.0, input->hts);
+    profile->Stim = (points->y[t] - input->hts) / points->x[t] + 500 * Ce * dtot;
+
+    int r = upper_hull_tangent_right(points, dtot, yr);
+    profile->Srim = (points->y[r] - yr) / (dtot - points->x[r]) - 500 * Ce * dtot;
+
+    real_t Str = (input->hrs - input->hts) / dtot;
+    profile->numax = NEGATIVE_INFINITY;
+    if (profile->Stim >= Str)
+        return; // Transhorizon, numax is not used
+
+    // LoS: every point lies below the line between the antennas, at clearance
+    // H = y - (hts + (Str - 500 * Ce * dtot) * d) < 0, and nu = H * w(d) with
+    // w(d) = sqrt(0.002 * dtot / (lambda * d * (dtot - d))) smallest mid-path,
+    // so Hmax * w(dtot / 2) bounds nu from above
+    real_t slope = Str - 500 * Ce * dtot;
+    real_t scale = c_sqrt(0.002 * dtot / input->lambda);
+    real_t w_min = 2 * scale / dtot;
+    int s = upper_hull_support(points, slope);
+    if (_dl_bull_clearance(input, points, slope, s) * w_min <= NU_THRESHOLD)
+        return;
+
+    // The path is close to grazing somewhere
+    if (points->size == 1)
+    {
+        int i = _dl_bull_locate(input, points->x[0]);
+        profile->numax = _dl_bull_los_numax(input, Ce, i, i);
+        return;
+    }
+
+    // The clearance falls off the vertices either side of s, so only the vertices from
+    // first to last can have nu above both the threshold and the best vertex
+    real_t limit = c_max(NU_THRESHOLD, scale * upper_hull_edge_clearance(points, input->hts, slope, dtot, s, s));
+    int first = s, last = s;
+    while (first > 0 && _dl_bull_clearance(input, points, slope, first - 1) * w_min > limit - NU_BOUND_SLACK)
+    {
+        first--;
+        limit = c_max(limit, scale * upper_hull_edge_clearance(points, input->hts, slope, dtot, first, first));
+    }
+    while (last < points->size - 1 && _dl_bull_clearance(input, points, slope, last + 1) * w_min > limit - NU_BOUND_SLACK)
+    {
+        last++;
+        limit = c_max(limit, scale * upper_hull_edge_clearance(points, input->hts, slope, dtot, last, last));
+    }
+
+    // Points between two vertices lie below their edge, so only the edges whose
+    // bound reaches the best vertex need the profile
+    first = (first > 0) ? first - 1 : first;
+    last = (last < points->size - 1) ? last + 1 : last;
+    for (int k = first; k < last; k++)
+    {
+        if (scale * upper_hull_edge_clearance(points, input->hts, slope, dtot, k, k + 1) <= limit - NU_BOUND_SLACK)
+            continue;
+
+        real_t numax = _dl_bull_los_numax(input, Ce, _dl_bull_locate(input, points->x[k]), _dl_bull_locate(input, points->x[k + 1]));
+        profile->numax = c_max(profile->numax, numax);
+        limit = c_max(limit, profile->numax);
+    }
+}
+
+// Slope from the transmitter to the zero-height point i
+real_t _dl_bull_smooth_sti(dl_bull_input_t *input, real_t Ce, int i)
+{
+    real_t d = input->d[i];
+    return (500 * Ce * d * (input->dtot - d) - input->hts) / d;
+}
+
+// Slope from the receiver to the zero-height point i
+real_t _dl_bull_smooth_sri(dl_bull_input_t *input, real_t Ce, int i)
+{
+    real_t d = input->d[i];
+    real_t dtot_min_d = input->dtot - d;
+    return (500 * Ce * d * dtot_min_d - input->hrs) / dtot_min_d;
+}
+
+// Diffraction parameter of the zero-height point i
+real_t _dl_bull_smooth_nu(dl_bull_input_t *input, real_t Ce, int i)
+{
+    real_t d = input->d[i];
+    real_t dtot_min_d = input->dtot - d;
+    real_t nu = 500 * Ce * d * dtot_min_d - (input->hts * dtot_min_d + input->hrs * d) / input->dtot;
+    return nu * c_sqrt(0.002 * input->dtot / (input->lambda * d * dtot_min_d));
+}
+
+void dl_bull_smooth_profile(dl_bull_input_t *input, dl_bull_profile_t *profile)
+{
+    profile->Stim = NEGATIVE_INFINITY;
+    profile->Srim = NEGATIVE_INFINITY;
+    profile->numax = NEGATIVE_INFINITY;
+
+    int first = 1, last = input->n - 2;
+    if (last < first)
+        return;
+
+    // The closed forms below need both antennas above the smooth surface,
+    // which always holds for hts - hstd and hrs - hsrd
+    if (input->hts <= 0 || input->hrs <= 0)
+    {
+        dl_bull_input_t smooth_input = *input;
+        smooth_input.h = NULL;
+        smooth_input.Ct = NULL;
+        dl_bull_profile(&smooth_input, profile);
+        return;
+    }
+
+    real_t Ce = 1 / input->ap;
+
+    // Sti = 500 * Ce * (dtot - d) - hts / d is concave with its maximum at d = sqrt(hts / (500 * Ce))
+    int i = _dl_bull_locate(input, c_sqrt(input->hts / (500 * Ce)));
+    profile->Stim = _dl_bull_smooth_sti(input, Ce, i);
+    if (i < last)
+        profile->Stim = c_max(profile->Stim, _dl_bull_smooth_sti(input, Ce, i + 1));
+
+    // Sri = 500 * Ce * d - hrs / (dtot - d) is the mirror image, peaking at dtot - d = sqrt(hrs / (500 * Ce))
+    i = _dl_bull_locate(input, input->dtot - c_sqrt(input->hrs / (500 * Ce)));
+    profile->Srim = _dl_bull_smooth_sri(input, Ce, i);
+    if (i < last)
+        profile->Srim = c_max(profile->Srim, _dl_bull_smooth_sri(input, Ce, i + 1));
+
+    real_t Str = (input->hrs - input->hts) / input->dtot;
+    if (profile->Stim < Str)
+    {
+        // With d = dtot * sin^2(phi), nu is proportional to
+        // 500 * Ce * dtot * sin(phi) * cos(phi) - (hts * cot(phi) + hrs * tan(phi)) / dtot,
+        // which is strictly concave in phi, so nu has a single peak along the path
+        int lo = first, hi = last;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (_dl_bull_smooth_nu(input, Ce, mid) < _dl_bull_smooth_nu(input, Ce, mid + 1))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        profile->numax = _dl_bull_smooth_nu(input, Ce, lo);
+    }
+
+#if DEBUG_SMOOTH_PROFILE == 1
+    dl_bull_input_t smooth_input = *input;
+    smooth_input.h = NULL;
+    smooth_input.Ct = NULL;
+    dl_bull_profile_t reference;
+    dl_bull_profile(&smooth_input, &reference);
+
+    real_t tolerance = SMOOTH_PROFILE_TOLERANCE * (1 + c_abs(reference.Stim) + c_abs(reference.Srim));
+    bool mismatch = c_abs(profile->Stim - reference.Stim) > tolerance || c_abs(profile->Srim - reference.Srim) > tolerance;
+    if (profile->Stim < Str)
+        mismatch = mismatch || c_abs(profile->numax - reference.numax) > SMOOTH_PROFILE_TOLERANCE * (1 + c_abs(reference.numax));
+    if (mismatch)
+        fprintf(stderr, "dl_bull_smooth_profile: n=%d Stim %g/%g Srim %g/%g numax %g/%g\n", input->n,
+                profile->Stim, reference.Stim, profile->Srim, reference.Srim, profile->numax, reference.numax);
+#endif
+}
@@ -18,6 +18,8 @@ void dl_delta_bull(dl_delta_bull_input_t *input, dl_delta_bull_output_t *output)
     dl_bull_input.f = input->f;
     dl_bull_input.lambda = input->lambda;
     dl_bull_input.dtot = input->dtot;
+    dl_bull_input.hull = input->hull;
+    dl_bull_input.profile = input->bull_profile;
 
     // Use the method in 4.3.1 for the actual terrain profile and antenna
     // heights. Set the resulting Bullington diffraction loss for the actual
@@ -32,13 +34,15 @@ void dl_delta_bull(dl_delta_bull_input_t *input, dl_delta_bull_output_t *output)
     // h1 = zeros(size(g));
     // where hstd and hsrd are given in 5.6.2 of Attachment 1.
     // Set the resulting Bullington diffraction loss for this smooth path to Lbulls
-    double hts1 = input->hts - input->hstd;
-    double hrs1 = input->hrs - input->hsrd;
+    real_t hts1 = input->hts - input->hstd;
+    real_t hrs1 = input->hrs - input->hsrd;
     dl_bull_input.h = NULL;
     dl_bull_input.Ct = NULL;
+    dl_bull_input.hull = NULL;
+    dl_bull_input.profile = NULL;
     dl_bull_input.hts = hts1;
     dl_bull_input.hrs = hrs1;
-    dl_bull(&dl_bull_input, &dl_bull_output);
+    dl_bull_smooth(&dl_bull_input, &dl_bull_output);
     output->Lbulls = dl_bull_output.Lbull;
 
     // Use the method in 4.3.2 to calculate the spherical-Earth diffraction loss
@@ -54,6 +58,8 @@ void dl_delta_bull(dl_delta_bull_input_t *input, dl_delta_bull_output_t *output)
     dl_se_input.f = input->f;
     dl_se_input.lambda = input->lambda;
     dl_se_input.omega = input->omega;
+    dl_se_input.prepared = input->se_ft;
+    dl_se_input.ft = input->se_ft_func;
     dl_se(&dl_se_input, &dl_se_output);
     output->Ldsph[0] = dl_se_output.Ldsph[0];
     output->Ldsph[1] = dl_se_output.Ldsph[1];
@@ -61,6 +67,7 @@ void dl_delta_bull(dl_delta_bull_input_t *input, dl_delta_bull_output_t *output)
     // Diffraction loss for the general path is now given by
     // Ld(1) = Lbulla + max(Ldsph(1) - Lbulls, 0);  % eq (39)
     // Ld(2) = Lbulla + max(Ldsph(2) - Lbulls, 0);  % eq (39)
-    output->Ld[0] = output->Lbulla + c_max(output->Ldsph[0] - output->Lbulls, 0);
-    output->Ld[1] = output->Lbulla + c_max(output->Ldsph[1] - output->Lbulls, 0);
+    // A polarization the dl_se_ft() specialization skipped stays NAN
+    for (int ii = 0; ii < 2; ii++)
+        output->Ld[ii] = c_isnan(output->Ldsph[ii]) ? output->Ldsph[ii] : output->Lbulla + c_max(output->Ldsph[ii] - output->Lbulls, 0);
 }
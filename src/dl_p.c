@@ -18,11 +18,15 @@ void dl_p(dl_p_input_t *input, dl_p_output_t *output)
     dl_delta_bull_input.lambda = input->lambda;
     dl_delta_bull_input.dtot = input->dtot;
     dl_delta_bull_input.omega = input->omega;
+    dl_delta_bull_input.se_ft_func = input->se_ft_func;
 
     // Use the method in 4.3.4 to calculate diffraction loss Ld for median effective
     // Earth radius ap = ae as given by equation (7a). Set median diffraction
     // loss to Ldp50
     dl_delta_bull_input.ap = input->ae;
+    dl_delta_bull_input.hull = input->hull_ae;
+    dl_delta_bull_input.bull_profile = input->bull_profile_ae;
+    dl_delta_bull_input.se_ft = input->se_ft_ae;
     dl_delta_bull(&dl_delta_bull_input, &dl_delta_bull_output);
 
     output->Ld50[0] = dl_delta_bull_output.Ld[0];
@@ -38,6 +42,9 @@ void dl_p(dl_p_input_t *input, dl_p_output_t *output)
         output->Ldp[1] = output->Ld50[1];
 
         dl_delta_bull_input.ap = input->ab;
+        dl_delta_bull_input.hull = input->hull_ab;
+        dl_delta_bull_input.bull_profile = input->bull_profile_ab;
+        dl_delta_bull_input.se_ft = input->se_ft_ab;
         dl_delta_bull(&dl_delta_bull_input, &dl_delta_bull_output);
 
         output->Ldb[0] = dl_delta_bull_output.Ld[0];
@@ -53,6 +60,9 @@ void dl_p(dl_p_input_t *input, dl_p_output_t *output)
         // Earth radius ap = abeta, as given in equation (7b). Set diffraction loss
         // not exceeded for beta0% time Ldb = Ld
         dl_delta_bull_input.ap = input->ab;
+        dl_delta_bull_input.hull = input->hull_ab;
+        dl_delta_bull_input.bull_profile = input->bull_profile_ab;
+        dl_delta_bull_input.se_ft = input->se_ft_ab;
         dl_delta_bull(&dl_delta_bull_input, &dl_delta_bull_output);
 
         output->Ldb[0] = dl_delta_bull_output.Ld[0];
@@ -63,9 +73,9 @@ void dl_p(dl_p_input_t *input, dl_p_output_t *output)
         output->Ldsph50[1] = dl_delta_bull_output.Ldsph[1];
 
         // Compute the interpolation factor Fi
-        double Fi;
+        real_t Fi;
         if (input->p > input->b0)
-            Fi = inv_cum_norm(input->p / 100) / inv_cum_norm(input->b0 / 100); // eq (40a)
+            Fi = input->inv_cum_norm_p / inv_cum_norm(input->b0 / 100); // eq (40a)
         else
             Fi = 1; // eq (40a)
 
@@ -14,15 +14,18 @@ void dl_se(dl_se_input_t *input, dl_se_output_t *output)
     dl_se_ft_input.lambda = input->lambda;
     dl_se_ft_input.omega = input->omega;
 
+    dl_se_ft_func_t ft = (input->ft != NULL) ? input->ft : dl_se_ft;
+
     // Calculate the marginal LoS distance for a smooth path
-    double dlos = c_sqrt(2 * input->ap) * (c_sqrt(0.001 * input->hte) + c_sqrt(0.001 * input->hre)); // Eq (22)
+    real_t dlos = c_sqrt(2 * input->ap) * (c_sqrt(0.001 * input->hte) + c_sqrt(0.001 * input->hre)); // Eq (22)
 
     if (input->d >= dlos)
     {
         // calculate diffraction loss Ldft using the method in Sec. 4.3.3 for
         // adft = ap and set Ldsph to Ldft
         dl_se_ft_input.ap = input->ap;
-        dl_se_ft(&dl_se_ft_input, &dl_se_ft_output);
+        dl_se_ft_input.prepared = input->prepared;
+        ft(&dl_se_ft_input, &dl_se_ft_output);
         output->Ldsph[0] = dl_se_ft_output.Ldft[0];
         output->Ldsph[1] = dl_se_ft_output.Ldft[1];
         return;
@@ -30,19 +33,19 @@ void dl_se(dl_se_input_t *input, dl_se_output_t *output)
 
     // calculate the smallest clearance between the curved-Earth path and
     // the ray between the antennas, hse
-    double c = (input->hte - input->hre) / (input->hte + input->hre);               // Eq (24d)
-    double m = 250 * input->d * input->d / (input->ap * (input->hte + input->hre)); // Eq (24e)
+    real_t c = (input->hte - input->hre) / (input->hte + input->hre);               // Eq (24d)
+    real_t m = 250 * input->d * input->d / (input->ap * (input->hte + input->hre)); // Eq (24e)
 
-    double b = 2 * c_sqrt((m + 1) / (3 * m)) * c_cos(PI / 3 + 1.0 / 3.0 * c_acos(3 * c / 2 * c_sqrt(3 * m / c_pow((m + 1), 3)))); // Eq (24c)
+    real_t b = 2 * c_sqrt((m + 1) / (3 * m)) * c_cos(PI / 3 + 1.0 / 3.0 * c_acos(3 * c / 2 * c_sqrt(3 * m / c_pow((m + 1), 3)))); // Eq (24c)
 
-    double dse1 = input->d / 2 * (1 + b); // Eq (24a)
-    double dse2 = input->d - dse1;        // Eq (24b)
+    real_t dse1 = input->d / 2 * (1 + b); // Eq (24a)
+    real_t dse2 = input->d - dse1;        // Eq (24b)
 
-    double hse = (input->hte - 500 * dse1 * dse1 / input->ap) * dse2 + (input->hre - 500 * dse2 * dse2 / input->ap) * dse1;
+    real_t hse = (input->hte - 500 * dse1 * dse1 / input->ap) * dse2 + (input->hre - 500 * dse2 * dse2 / input->ap) * dse1;
     hse = hse / input->d; // Eq (23)
 
     // Calculate the required clearance for zero diffraction loss
-    double hreq = 17.456 * c_sqrt(dse1 * dse2 * input->lambda / input->d); // Eq (26)
+    real_t hreq = 17.456 * c_sqrt(dse1 * dse2 * input->lambda / input->d); // Eq (26)
     if (hse > hreq)
     {
         output->Ldsph[0] = 0;
@@ -52,14 +55,17 @@ void dl_se(dl_se_input_t *input, dl_se_output_t *output)
 
     // calculate the modified effective Earth radius aem, which gives
     // marginal LoS at distance d
-    double aem = 500 * c_pow(input->d / (c_sqrt(input->hte) + c_sqrt(input->hre)), 2); // Eq (26)
+    real_t aem = 500 * c_pow(input->d / (c_sqrt(input->hte) + c_sqrt(input->hre)), 2); // Eq (26)
     
-    // Use the method in Sec. 4.3.3 for adft = aem to obtain Ldft
+    // Use the method in Sec. 4.3.3 for adft = aem to obtain Ldft. The prepared terms are
+    // for ap, ft prepares those of aem for the polarizations it evaluates
     dl_se_ft_input.ap = aem;
-    dl_se_ft(&dl_se_ft_input, &dl_se_ft_output);
+    dl_se_ft_input.prepared = NULL;
+    ft(&dl_se_ft_input, &dl_se_ft_output);
 
-    dl_se_ft_output.Ldft[0] = c_max(dl_se_ft_output.Ldft[0], 0);
-    dl_se_ft_output.Ldft[1] = c_max(dl_se_ft_output.Ldft[1], 0);
+    // A polarization the specialization skipped stays NAN
+    dl_se_ft_output.Ldft[0] = c_isnan(dl_se_ft_output.Ldft[0]) ? dl_se_ft_output.Ldft[0] : c_max(dl_se_ft_output.Ldft[0], 0);
+    dl_se_ft_output.Ldft[1] = c_isnan(dl_se_ft_output.Ldft[1]) ? dl_se_ft_output.Ldft[1] : c_max(dl_se_ft_output.Ldft[1], 0);
 
     output->Ldsph[0] = (1 - hse / hreq) * dl_se_ft_output.Ldft[0];
     output->Ldsph[1] = (1 - hse / hreq) * dl_se_ft_output.Ldft[1];
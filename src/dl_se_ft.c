@@ -1,7 +1,23 @@
 #include "dl_se_ft.h"
 #include "dl_se_ft_inner.h"
+#include <stdlib.h>
 
-void dl_se_ft(dl_se_ft_input_t *input, dl_se_ft_output_t *output)
+// Electrical characteristics of land and sea
+#define EPSR_LAND 22
+#define SIGMA_LAND 0.003
+#define EPSR_SEA 80
+#define SIGMA_SEA 5
+
+void dl_se_ft_prepare(real_t adft, real_t f, dl_se_ft_prepared_t *prepared)
+{
+    dl_se_ft_inner_prepare(EPSR_LAND, SIGMA_LAND, adft, f, &prepared->land);
+    dl_se_ft_inner_prepare(EPSR_SEA, SIGMA_SEA, adft, f, &prepared->sea);
+}
+
+typedef void (*dl_se_ft_inner_func_t)(dl_se_ft_inner_input_t *input, dl_se_ft_inner_output_t *output);
+
+// First-term part of the spherical-Earth diffraction loss over one type of surface
+static inline void _dl_se_ft_surface(dl_se_ft_input_t *input, dl_se_ft_inner_func_t inner, real_t epsr, real_t sigma, const dl_se_ft_inner_prepared_t *prepared, real_t *Ldft)
 {
     dl_se_ft_inner_output_t dl_se_ft_inner_output;
     dl_se_ft_inner_input_t dl_se_ft_inner_input;
@@ -10,24 +26,62 @@ void dl_se_ft(dl_se_ft_input_t *input, dl_se_ft_output_t *output)
     dl_se_ft_inner_input.hre = input->hre;
     dl_se_ft_inner_input.adft = input->ap;
     dl_se_ft_inner_input.f = input->f;
+    dl_se_ft_inner_input.epsr = epsr;
+    dl_se_ft_inner_input.sigma = sigma;
+    dl_se_ft_inner_input.prepared = prepared;
+    inner(&dl_se_ft_inner_input, &dl_se_ft_inner_output);
+    Ldft[0] = dl_se_ft_inner_output.Ldft[0];
+    Ldft[1] = dl_se_ft_inner_output.Ldft[1];
+}
+
+// Instance for the given inner routine, LAND and SEA select the surfaces that are evaluated,
+// with only one of them the path is taken to lie entirely over it
+#define DL_SE_FT_VARIANT(name, INNER, LAND, SEA)                                                                                  \
+    void name(dl_se_ft_input_t *input, dl_se_ft_output_t *output)                                                                 \
+    {                                                                                                                             \
+        real_t Ldft_land[2];                                                                                                      \
+        if (LAND)                                                                                                                 \
+            _dl_se_ft_surface(input, INNER, EPSR_LAND, SIGMA_LAND, (input->prepared != NULL) ? &input->prepared->land : NULL, Ldft_land); \
+                                                                                                                                  \
+        real_t Ldft_sea[2];                                                                                                       \
+        if (SEA)                                                                                                                  \
+            _dl_se_ft_surface(input, INNER, EPSR_SEA, SIGMA_SEA, (input->prepared != NULL) ? &input->prepared->sea : NULL, Ldft_sea); \
+                                                                                                                                  \
+        /* First-term spherical diffraction loss, Eq (28) */                                                                      \
+        for (int ii = 0; ii < 2; ii++)                                                                                            \
+        {                                                                                                                         \
+            if (LAND && SEA)                                                                                                      \
+                output->Ldft[ii] = input->omega * Ldft_sea[ii] + (1 - input->omega) * Ldft_land[ii];                              \
+            else if (LAND)                                                                                                        \
+                output->Ldft[ii] = Ldft_land[ii];                                                                                 \
+            else                                                                                                                  \
+                output->Ldft[ii] = Ldft_sea[ii];                                                                                  \
+        }                                                                                                                         \
+    }
+
+DL_SE_FT_VARIANT(dl_se_ft, dl_se_ft_inner, 1, 1)
+
+DL_SE_FT_VARIANT(_dl_se_ft_h, dl_se_ft_inner_h, 1, 1)
+DL_SE_FT_VARIANT(_dl_se_ft_h_land, dl_se_ft_inner_h, 1, 0)
+DL_SE_FT_VARIANT(_dl_se_ft_h_sea, dl_se_ft_inner_h, 0, 1)
+DL_SE_FT_VARIANT(_dl_se_ft_v, dl_se_ft_inner_v, 1, 1)
+DL_SE_FT_VARIANT(_dl_se_ft_v_land, dl_se_ft_inner_v, 1, 0)
+DL_SE_FT_VARIANT(_dl_se_ft_v_sea, dl_se_ft_inner_v, 0, 1)
+
+dl_se_ft_func_t dl_se_ft_select(int pol, real_t omega)
+{
+    if (pol == 0)
+    {
+        if (omega == 0.0)
+            return _dl_se_ft_h_land;
+        if (omega == 1.0)
+            return _dl_se_ft_h_sea;
+        return _dl_se_ft_h;
+    }
 
-    // First-term part of the spherical-Earth diffraction loss over land
-    dl_se_ft_inner_input.epsr = 22;
-    dl_se_ft_inner_input.sigma = 0.003;
-    dl_se_ft_inner(&dl_se_ft_inner_input, &dl_se_ft_inner_output);
-    double Ldft_land[2];
-    Ldft_land[0] = dl_se_ft_inner_output.Ldft[0];
-    Ldft_land[1] = dl_se_ft_inner_output.Ldft[1];
-
-    // First-term part of the spherical-Earth diffraction loss over sea
-    dl_se_ft_inner_input.epsr = 80;
-    dl_se_ft_inner_input.sigma = 5;
-    dl_se_ft_inner(&dl_se_ft_inner_input, &dl_se_ft_inner_output);
-    double Ldft_sea[2];
-    Ldft_sea[0] = dl_se_ft_inner_output.Ldft[0];
-    Ldft_sea[1] = dl_se_ft_inner_output.Ldft[1];
-
-    // First-term spherical diffraction loss, Eq (28)
-    output->Ldft[0] = input->omega * Ldft_sea[0] + (1 - input->omega) * Ldft_land[0];
-    output->Ldft[1] = input->omega * Ldft_sea[1] + (1 - input->omega) * Ldft_land[1];
+    if (omega == 0.0)
+        return _dl_se_ft_v_land;
+    if (omega == 1.0)
+        return _dl_se_ft_v_sea;
+    return _dl_se_ft_v;
 }
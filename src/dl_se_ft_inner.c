@@ -1,78 +1,117 @@
 #include "dl_se_ft_inner.h"
 #include "custom_math.h"
+#include <stdlib.h>
 
 // Eq (30)
 #define BETA_DFT_FORMULA(k) ((1 + k * k * (1.6 + 0.67 * k * k)) / (1 + k * k * (4.5 + 1.53 * k * k)))
 
-// Eq (31)
-#define X_FORMULA(beta_dft, adft, f, d) (21.88 * beta_dft * c_cbrt(f / (adft * adft)) * d)
+// Eq (31) without the distance
+#define X_FACTOR_FORMULA(beta_dft, adft, f) (21.88 * beta_dft * c_cbrt(f / (adft * adft)))
 
-// Eq (32ab)
-#define Y_FORMULA(beta_dft, adft, f, h) (0.9575 * beta_dft * c_cbrt(f * f / adft) * h)
+// Eq (32ab) without the height
+#define Y_FACTOR_FORMULA(beta_dft, adft, f) (0.9575 * beta_dft * c_cbrt(f * f / adft))
 
-void dl_se_ft_inner(dl_se_ft_inner_input_t *input, dl_se_ft_inner_output_t *output)
+// Normalized factor for surface admittance, Eq (29a) for horizontal (0) and, when last is 1,
+// Eq (29b) for vertical (1) polarization
+static inline void _dl_se_ft_inner_K(real_t epsr, real_t sigma, real_t adft, real_t f, int last, real_t *K)
+{
+    K[0] = 0.036 * c_pow(adft * f, -1.0 / 3);
+    K[0] *= c_pow(c_pow(epsr - 1, 2) + c_pow(18 * sigma / f, 2), -1.0 / 4); // Eq (29a)
+    if (last == 1)
+        K[1] = K[0] * c_sqrt(epsr * epsr + c_pow(18.0 * sigma / f, 2)); // Eq (29b)
+}
+
+// Terms of polarization ii from K[ii]
+static inline void _dl_se_ft_inner_prepare_pol(real_t adft, real_t f, int ii, dl_se_ft_inner_prepared_t *prepared)
 {
-    // Normalized factor for surface admittance for horizontal (0) and vertical (1) polarizations
-    double K[2];
+    // Earth ground/polarization parameter
+    prepared->beta_dft[ii] = BETA_DFT_FORMULA(prepared->K[ii]);
 
-    K[0] = 0.036 * c_pow(input->adft * input->f, -1.0 / 3);
-    K[0] *= c_pow(c_pow(input->epsr - 1, 2) + c_pow(18 * input->sigma / input->f, 2), -1.0 / 4); // Eq (29a)
-    K[1] = K[0] * c_sqrt(input->epsr * input->epsr + c_pow(18.0 * input->sigma / input->f, 2));  // Eq (29b)
+    prepared->X_factor[ii] = X_FACTOR_FORMULA(prepared->beta_dft[ii], adft, f);
+    prepared->Y_factor[ii] = Y_FACTOR_FORMULA(prepared->beta_dft[ii], adft, f);
+    prepared->GY_min[ii] = 2 + 20 * c_log10(prepared->K[ii]);
+}
 
-    // Earth ground/polarization parameter
-    double beta_dft[2];
-    beta_dft[0] = BETA_DFT_FORMULA(K[0]);
-    beta_dft[1] = BETA_DFT_FORMULA(K[1]);
+void dl_se_ft_inner_prepare(real_t epsr, real_t sigma, real_t adft, real_t f, dl_se_ft_inner_prepared_t *prepared)
+{
+    _dl_se_ft_inner_K(epsr, sigma, adft, f, 1, prepared->K);
+    for (int ii = 0; ii < 2; ii++)
+        _dl_se_ft_inner_prepare_pol(adft, f, ii, prepared);
+}
 
+// Eq (36) for polarization ii
+static inline real_t _dl_se_ft_inner_Ldft(dl_se_ft_inner_input_t *input, const dl_se_ft_inner_prepared_t *prepared, int ii)
+{
     // Normalized distance
-    double X[2];
-    X[0] = X_FORMULA(beta_dft[0], input->adft, input->f, input->d);
-    X[1] = X_FORMULA(beta_dft[1], input->adft, input->f, input->d);
+    real_t X = prepared->X_factor[ii] * input->d;
 
     // Normalized transmitter and receiver heights
-    double Yt[2];
-    double Yr[2];
-    Yt[0] = Y_FORMULA(beta_dft[0], input->adft, input->f, input->hte);
-    Yt[1] = Y_FORMULA(beta_dft[1], input->adft, input->f, input->hte);
-
-    Yr[0] = Y_FORMULA(beta_dft[0], input->adft, input->f, input->hre);
-    Yr[1] = Y_FORMULA(beta_dft[1], input->adft, input->f, input->hre);
-
-    double Fx[2] = {0, 0};
-    double GYt[2] = {0, 0};
-    double GYr[2] = {0, 0};
+    real_t Yt = prepared->Y_factor[ii] * input->hte;
+    real_t Yr = prepared->Y_factor[ii] * input->hre;
 
     // Calculate the distance term given by:
-    for (int ii = 0; ii < 2; ii++)
-    {
-        if (X[ii] >= 1.6)
-            Fx[ii] = 11 + 10 * c_log10(X[ii]) - 17.6 * X[ii];
-        else
-            Fx[ii] = -20 * c_log10(X[ii]) - 5.6488 * c_pow(X[ii], 1.425); // Eq (33)
-    }
+    real_t Fx;
+    if (X >= 1.6)
+        Fx = 11 + 10 * c_log10(X) - 17.6 * X;
+    else
+        Fx = -20 * c_log10(X) - 5.6488 * c_pow(X, 1.425); // Eq (33)
+
+    real_t Bt = prepared->beta_dft[ii] * Yt; // Eq (35)
+    real_t Br = prepared->beta_dft[ii] * Yr; // Eq (35)
+
+    real_t GYt, GYr;
+    if (Bt > 2)
+        GYt = 17.6 * c_sqrt(Bt - 1.1) - 5 * c_log10(Bt - 1.1) - 8;
+    else
+        GYt = 20 * c_log10(Bt + 0.1 * c_pow(Bt, 3));
+
+    if (Br > 2)
+        GYr = 17.6 * c_sqrt(Br - 1.1) - 5 * c_log10(Br - 1.1) - 8;
+    else
+        GYr = 20 * c_log10(Br + 0.1 * c_pow(Br, 3));
+
+    GYr = c_max(GYr, prepared->GY_min[ii]);
+    GYt = c_max(GYt, prepared->GY_min[ii]);
+
+    return -Fx - GYt - GYr;
+}
+
+// Terms of the input, or failing that local prepared for polarization pol, both for pol = -1
+static inline const dl_se_ft_inner_prepared_t *_dl_se_ft_inner_prepared(dl_se_ft_inner_input_t *input, dl_se_ft_inner_prepared_t *local, int pol)
+{
+    if (input->prepared != NULL)
+        return input->prepared;
 
-    double Bt[2];
-    double Br[2];
-    for (int ii = 0; ii < 2; ii++)
+    if (pol < 0)
     {
-        Bt[ii] = beta_dft[ii] * Yt[ii]; // Eq (35)
-        Br[ii] = beta_dft[ii] * Yr[ii]; // Eq (35)
-
-        if (Bt[ii] > 2)
-            GYt[ii] = 17.6 * c_sqrt(Bt[ii] - 1.1) - 5 * c_log10(Bt[ii] - 1.1) - 8;
-        else
-            GYt[ii] = 20 * c_log10(Bt[ii] + 0.1 * c_pow(Bt[ii], 3));
+        dl_se_ft_inner_prepare(input->epsr, input->sigma, input->adft, input->f, local);
+        return local;
+    }
 
-        if (Br[ii] > 2)
-            GYr[ii] = 17.6 * c_sqrt(Br[ii] - 1.1) - 5 * c_log10(Br[ii] - 1.1) - 8;
-        else
-            GYr[ii] = 20 * c_log10(Br[ii] + 0.1 * c_pow(Br[ii], 3));
+    _dl_se_ft_inner_K(input->epsr, input->sigma, input->adft, input->f, pol, local->K);
+    _dl_se_ft_inner_prepare_pol(input->adft, input->f, pol, local);
+    return local;
+}
 
-        GYr[ii] = c_max(GYr[ii], 2 + 20 * c_log10(K[ii]));
-        GYt[ii] = c_max(GYt[ii], 2 + 20 * c_log10(K[ii]));
+void dl_se_ft_inner(dl_se_ft_inner_input_t *input, dl_se_ft_inner_output_t *output)
+{
+    dl_se_ft_inner_prepared_t local;
+    const dl_se_ft_inner_prepared_t *prepared = _dl_se_ft_inner_prepared(input, &local, -1);
+
+    output->Ldft[0] = _dl_se_ft_inner_Ldft(input, prepared, 0);
+    output->Ldft[1] = _dl_se_ft_inner_Ldft(input, prepared, 1);
+}
+
+// Single-polarization instance, the entry of the other polarization is set to NAN and,
+// without prepared terms, only those of POL are computed
+#define DL_SE_FT_INNER_POL(name, POL)                                                             \
+    void name(dl_se_ft_inner_input_t *input, dl_se_ft_inner_output_t *output)                     \
+    {                                                                                             \
+        dl_se_ft_inner_prepared_t local;                                                          \
+        const dl_se_ft_inner_prepared_t *prepared = _dl_se_ft_inner_prepared(input, &local, POL); \
+        output->Ldft[POL] = _dl_se_ft_inner_Ldft(input, prepared, POL);                           \
+        output->Ldft[1 - POL] = NAN;                                                              \
     }
 
-    // Eq (36)
-    output->Ldft[0] = -Fx[0] - GYt[0] - GYr[0];
-    output->Ldft[1] = -Fx[1] - GYt[1] - GYr[1];
-}
\ No newline at end of file
+DL_SE_FT_INNER_POL(dl_se_ft_inner_h, 0)
+DL_SE_FT_INNER_POL(dl_se_ft_inner_v, 1)
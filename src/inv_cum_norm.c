@@ -1,23 +1,23 @@
 #include "inv_cum_norm.h"
 #include "custom_math.h"
 
-double T(double y)
+real_t T(real_t y)
 {
     return c_sqrt(-2 * c_log(y));
 }
 
-double C(double z)
+real_t C(real_t z)
 {
-    const double C0 = 2.515516698;
-    const double C1 = 0.802853;
-    const double C2 = 0.010328;
-    const double D1 = 1.432788;
-    const double D2 = 0.189269;
-    const double D3 = 0.001308;
+    const real_t C0 = 2.515516698;
+    const real_t C1 = 0.802853;
+    const real_t C2 = 0.010328;
+    const real_t D1 = 1.432788;
+    const real_t D2 = 0.189269;
+    const real_t D3 = 0.001308;
     return (((C2 * T(z) + C1) * T(z)) + C0) / (((D3 * T(z) + D2) * T(z) + D1) * T(z) + 1); // (97b)
 }
 
-double inv_cum_norm(double x)
+real_t inv_cum_norm(real_t x)
 {
     if (x < 0.000001)
         return 0.000001;
@@ -2,41 +2,41 @@
 #include "parameters.h"
 #include "parameters_validation.h"
 
-const double C1812_MIN_FREQUENCY = 0.03;
-const double C1812_MAX_FREQUENCY = 6.0;
+const real_t C1812_MIN_FREQUENCY = 0.03;
+const real_t C1812_MAX_FREQUENCY = 6.0;
 
-const double C1812_MIN_TIME_PERCENTAGE = 1.0;
-const double C1812_MAX_TIME_PERCENTAGE = 50.0;
+const real_t C1812_MIN_TIME_PERCENTAGE = 1.0;
+const real_t C1812_MAX_TIME_PERCENTAGE = 50.0;
 
-const double C1812_MIN_TRANSMITTER_HEIGHT = 1.0;
-const double C1812_MAX_TRANSMITTER_HEIGHT = 3000.0;
+const real_t C1812_MIN_TRANSMITTER_HEIGHT = 1.0;
+const real_t C1812_MAX_TRANSMITTER_HEIGHT = 3000.0;
 
-const double C1812_MIN_RECEIVER_HEIGHT = 1.0;
-const double C1812_MAX_RECEIVER_HEIGHT = 3000.0;
+const real_t C1812_MIN_RECEIVER_HEIGHT = 1.0;
+const real_t C1812_MAX_RECEIVER_HEIGHT = 3000.0;
 
-const double C1812_MIN_STREET_WIDTH = 1.0;
-const double C1812_MAX_STREET_WIDTH = 100.0;
+const real_t C1812_MIN_STREET_WIDTH = 1.0;
+const real_t C1812_MAX_STREET_WIDTH = 100.0;
 
 const int C1812_MIN_NUMBER_OF_POINTS = 2;
 
-const double C1812_MIN_TERRAIN_HEIGHT = -500.0; // Less than the lowest point on Earth
-const double C1812_MAX_TERRAIN_HEIGHT = 9000.0; // More than the highest point on Earth
+const real_t C1812_MIN_TERRAIN_HEIGHT = -500.0; // Less than the lowest point on Earth
+const real_t C1812_MAX_TERRAIN_HEIGHT = 9000.0; // More than the highest point on Earth
 
-const double C1812_MIN_CLUTTER_HEIGHT = 0.0;	// No clutter
-const double C1812_MAX_CLUTTER_HEIGHT = 1000.0; // More than the highest building in the world
+const real_t C1812_MIN_CLUTTER_HEIGHT = 0.0;	// No clutter
+const real_t C1812_MAX_CLUTTER_HEIGHT = 1000.0; // More than the highest building in the world
 
 // +-80 degrees according to ITU-R P.1812-6 Table 1
-const double C1812_MIN_LATITUDE = -80.0;
-const double C1812_MAX_LATITUDE = 80.0;
+const real_t C1812_MIN_LATITUDE = -80.0;
+const real_t C1812_MAX_LATITUDE = 80.0;
 
-const double C1812_MIN_LONGITUDE = -180.0;
-const double C1812_MAX_LONGITUDE = 180.0;
+const real_t C1812_MIN_LONGITUDE = -180.0;
+const real_t C1812_MAX_LONGITUDE = 180.0;
 
-const double C1812_MIN_SURFACE_REFRACTIVITY = 250.0;
-const double C1812_MAX_SURFACE_REFRACTIVITY = 450.0;
+const real_t C1812_MIN_SURFACE_REFRACTIVITY = 250.0;
+const real_t C1812_MAX_SURFACE_REFRACTIVITY = 450.0;
 
-const double C1812_MIN_REFRACTIVITY_LAPSE_RATE = 0.0;
-const double C1812_MAX_REFRACTIVITY_LAPSE_RATE = 100.0;
+const real_t C1812_MIN_REFRACTIVITY_LAPSE_RATE = 0.0;
+const real_t C1812_MAX_REFRACTIVITY_LAPSE_RATE = 100.0;
 
 c1812_parameters_error_t c1812_validate_scalar_data(c1812_parameters_t *parameters)
 {
@@ -97,6 +97,11 @@ c1812_parameters_error_t c1812_validate_vector_data(c1812_parameters_t *paramete
 	{
 		return PARAM_ERR_INVALID_DISTANCE_FROM_TRANSMITTER;
 	}
+	// The profile starts at the transmitter
+	if (parameters->d[0] != 0)
+	{
+		return PARAM_ERR_INVALID_DISTANCE_FROM_TRANSMITTER;
+	}
 	// Validate distance from transmitter is non-negative and increasing
 	for (int i = 0; i < parameters->n; i++)
 	{
@@ -3,7 +3,7 @@
 
 void pl_los(pl_los_input_t *input, pl_los_output_t *output)
 {
-    double dfs, Esp, Esb;
+    real_t dfs, Esp, Esb;
 
     // Basic transmission loss due to free-space propagation
     dfs = c_sqrt(c_pow(input->d, 2) + c_pow((input->hts - input->hrs) / 1000.0, 2)); // (8a)
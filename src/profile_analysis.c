@@ -0,0 +1,152 @@
+#include "profile_analysis.h"
+#include "custom_math.h"
+#include <stdlib.h>
+
+#define KM 1000.0
+
+// Running maxima of one Bullington pass
+typedef struct
+{
+    real_t k; // 500 * Ce
+    real_t Stim;
+    real_t Srim;
+    real_t numax;
+} _profile_analysis_bull_t;
+
+static inline void _profile_analysis_bull_init(_profile_analysis_bull_t *bull, real_t ap)
+{
+    real_t Ce = 1 / ap;
+    bull->k = 500 * Ce;
+    bull->Stim = NEGATIVE_INFINITY;
+    bull->Srim = NEGATIVE_INFINITY;
+    bull->numax = NEGATIVE_INFINITY;
+}
+
+// One intermediate point of dl_bull_profile(). numax is taken over every point: it is only
+// used when the final Stim is below Str, and then so was every running Stim
+static inline void _profile_analysis_bull_point(_profile_analysis_bull_t *bull, real_t d, real_t dtot_min_d, real_t g,
+                                                real_t hts, real_t hrs, real_t chord, real_t nu_factor)
+{
+    real_t tmp = g + bull->k * d * dtot_min_d;
+
+    real_t Sti = (tmp - hts) / d;
+    if (Sti > bull->Stim)
+        bull->Stim = Sti;
+
+    real_t nu = (tmp - chord) * nu_factor;
+    if (nu > bull->numax)
+        bull->numax = nu;
+
+    real_t Sri = (tmp - hrs) / dtot_min_d;
+    if (Sri > bull->Srim)
+        bull->Srim = Sri;
+}
+
+static inline void _profile_analysis_bull_store(_profile_analysis_bull_t *bull, dl_bull_profile_t *profile)
+{
+    profile->Stim = bull->Stim;
+    profile->Srim = bull->Srim;
+    profile->numax = bull->numax;
+}
+
+void profile_analysis(profile_analysis_input_t *input, profile_analysis_output_t *output)
+{
+    int n = input->n;
+    real_t *d = input->d;
+    real_t *h = input->h;
+    real_t dtot = input->dtot;
+    real_t ae = input->ae;
+    real_t hts = h[0] + input->htg;
+    real_t hrs = h[n - 1] + input->hrg;
+    real_t Ce = 1.0 / ae;
+
+    real_t v1 = 0.0;
+    real_t v2 = 0.0;
+    real_t hobs = NEGATIVE_INFINITY;
+    real_t alpha_obt = NEGATIVE_INFINITY;
+    real_t alpha_obr = NEGATIVE_INFINITY;
+
+    // atan is increasing, so the angles are maximized over their arguments and converted once
+    real_t theta_t_arg = NEGATIVE_INFINITY;
+    real_t theta_r_arg = NEGATIVE_INFINITY;
+
+    real_t numax_trans = NEGATIVE_INFINITY;
+    real_t numax_los = NEGATIVE_INFINITY;
+    output->dlt_trans = NAN;
+    output->dlt_los = NAN;
+
+    _profile_analysis_bull_t bull_ae, bull_ab;
+    _profile_analysis_bull_init(&bull_ae, input->ae);
+    _profile_analysis_bull_init(&bull_ab, input->ab);
+
+    // Terms of the previous point, the transhorizon nu of point i is evaluated at d[i - 1]
+    real_t prev_d = d[0];
+    real_t prev_dtot_min_d = dtot - prev_d;
+    real_t prev_chord = (hts * prev_dtot_min_d + hrs * prev_d) / dtot;
+    real_t prev_nu_factor = c_sqrt(0.002 * dtot / (input->lambda * prev_d * prev_dtot_min_d));
+
+    for (int i = 1; i < n; i++)
+    {
+        real_t di = d[i];
+        real_t hi = h[i];
+
+        // Eq (161), (162), the segment ending at point i
+        real_t diff_d = di - prev_d;
+        v1 += diff_d * (hi + h[i - 1]);
+        v2 += diff_d * (hi * (2 * di + prev_d) + h[i - 1] * (di + 2 * prev_d));
+
+        if (i == n - 1)
+            break;
+
+        real_t dtot_min_d = dtot - di;
+        real_t chord = (hts * dtot_min_d + hrs * di) / dtot;
+        real_t nu_factor = c_sqrt(0.002 * dtot / (input->lambda * di * dtot_min_d));
+
+        // Obstruction heights above the line between the antennas
+        real_t HHi = hi - chord;
+        hobs = c_max(hobs, HHi);
+        alpha_obt = c_max(alpha_obt, HHi / di);
+        alpha_obr = c_max(alpha_obr, HHi / dtot_min_d);
+
+        // Horizon angles
+        theta_t_arg = c_max(theta_t_arg, (hi - hts) / (KM * di) - di / (2 * ae));
+        theta_r_arg = c_max(theta_r_arg, (hi - hrs) / (KM * dtot_min_d) - dtot_min_d / (2 * ae));
+
+        // Diffraction parameters of the smooth-Earth dlt search, transhorizon and LoS
+        real_t nu = hi + 500 * ae * (di * dtot_min_d - prev_d * prev_dtot_min_d) - prev_chord;
+        nu *= prev_nu_factor;
+        if (nu > numax_trans)
+        {
+            numax_trans = nu;
+            output->dlt_trans = d[i + 1];
+        }
+
+        nu = (hi + 500 * Ce * di * dtot_min_d - chord) * nu_factor;
+        if (nu > numax_los)
+        {
+            numax_los = nu;
+            output->dlt_los = di;
+        }
+
+        // Bullington passes over g
+        real_t g = hi + ((input->Ct != NULL) ? input->Ct[i] : 0.0);
+        _profile_analysis_bull_point(&bull_ae, di, dtot_min_d, g, hts, hrs, chord, nu_factor);
+        _profile_analysis_bull_point(&bull_ab, di, dtot_min_d, g, hts, hrs, chord, nu_factor);
+
+        prev_d = di;
+        prev_dtot_min_d = dtot_min_d;
+        prev_chord = chord;
+        prev_nu_factor = nu_factor;
+    }
+
+    output->v1 = v1;
+    output->v2 = v2;
+    output->hobs = hobs;
+    output->alpha_obt = alpha_obt;
+    output->alpha_obr = alpha_obr;
+    // Without intermediate points both stay at -inf, as in smooth_earth_heights()
+    output->theta_max = (n > 2) ? KM * c_atan(theta_t_arg) : NEGATIVE_INFINITY;
+    output->theta_r = (n > 2) ? KM * c_atan(theta_r_arg) : NEGATIVE_INFINITY;
+    _profile_analysis_bull_store(&bull_ae, &output->bull_ae);
+    _profile_analysis_bull_store(&bull_ab, &output->bull_ab);
+}
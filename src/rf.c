@@ -1,12 +1,12 @@
 #include "rf.h"
 #include "custom_math.h"
 
-double watts_to_dBm(double P)
+real_t watts_to_dBm(real_t P)
 {
 	return 10 * c_log10(P) + 30;
 }
 
-double link_budget(double P, double Gt, double Gr, double L)
+real_t link_budget(real_t P, real_t Gt, real_t Gr, real_t L)
 {
 	return watts_to_dBm(P) + Gt + Gr - L;
 }
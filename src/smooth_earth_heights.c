@@ -6,6 +6,152 @@
 
 #define KM 1000.0
 
+// Pruning margin for rounding in the hull bounds on nu
+#define NU_BOUND_SLACK 1e-3
+
+void seh_state_init(seh_state_t *state, real_t *storage, int n_max)
+{
+    state->n = 0;
+    state->hts = NAN;
+    state->v1 = 0.0;
+    state->v2 = 0.0;
+    state->theta_max = NEGATIVE_INFINITY;
+    state->alpha_t = NEGATIVE_INFINITY;
+    upper_hull_init(&state->hull_h, storage, storage + n_max);
+    upper_hull_init(&state->hull_z, storage + 2 * n_max, storage + 3 * n_max);
+}
+
+void seh_state_advance(seh_state_t *state, seh_input_t *input)
+{
+    if (state->n == 0)
+    {
+        state->hts = input->h[0] + input->htg;
+        state->n = 1;
+    }
+
+    for (int i = state->n; i < input->n; i++)
+    {
+        // Point i becomes the receiver, the segment leading to it joins v1 and v2
+        real_t diff_d = input->d[i] - input->d[i - 1];
+        real_t sum_h = input->h[i] + input->h[i - 1];
+        state->v1 += diff_d * sum_h;
+        state->v2 += diff_d * (input->h[i] * (2 * input->d[i] + input->d[i - 1]) + input->h[i - 1] * (input->d[i] + 2 * input->d[i - 1]));
+
+        // and the previous receiver becomes an intermediate point
+        if (i >= 2)
+        {
+            real_t d = input->d[i - 1];
+            real_t h = input->h[i - 1];
+            real_t theta = KM * c_atan((h - state->hts) / (KM * d) - d / (2 * input->ae));
+            state->theta_max = c_max(state->theta_max, theta);
+            state->alpha_t = c_max(state->alpha_t, (h - state->hts) / d);
+            upper_hull_push(&state->hull_h, d, h);
+            upper_hull_push(&state->hull_z, d, h - KM * d * d / (2 * input->ae));
+        }
+    }
+
+    state->n = input->n;
+}
+
+// Height term of the diffraction parameter of point i in the transhorizon dlt search
+real_t _seh_transhorizon_height(seh_input_t *input, seh_output_t *output, int i)
+{
+    real_t d = input->d[i];
+    real_t dtot_min_d = input->dtot - d;
+    real_t d_min_1 = input->d[i - 1];
+    real_t dtot_min_d_min_1 = input->dtot - d_min_1;
+    return input->h[i] + 500 * input->ae * (d * dtot_min_d - d_min_1 * dtot_min_d_min_1) - (output->hts * dtot_min_d_min_1 + output->hrs * d_min_1) / input->dtot;
+}
+
+// Diffraction parameter of point i in the transhorizon dlt search
+real_t _seh_transhorizon_nu(seh_input_t *input, seh_output_t *output, int i)
+{
+    real_t d_min_1 = input->d[i - 1];
+    real_t dtot_min_d_min_1 = input->dtot - d_min_1;
+    real_t nu = _seh_transhorizon_height(input, output, i);
+    nu *= c_sqrt(0.002 * input->dtot / (input->lambda * d_min_1 * dtot_min_d_min_1));
+    return nu;
+}
+
+// Diffraction parameter of point i in the line-of-sight dlt search
+real_t _seh_los_nu(seh_input_t *input, seh_output_t *output, int i)
+{
+    real_t Ce = 1.0 / input->ae;
+
+    real_t d = input->d[i];
+    real_t dtot_min_d = input->dtot - d;
+    real_t nu = input->h[i] + 500 * Ce * input->d[i] * dtot_min_d - (output->hts * dtot_min_d + output->hrs * d) / input->dtot;
+    nu *= c_sqrt(0.002 * input->dtot / (input->lambda * d * dtot_min_d));
+    return nu;
+}
+
+// Last intermediate point with d[i] <= target, or the first one if there is none
+int _seh_locate(seh_input_t *input, real_t target)
+{
+    int lo = 1, hi = input->n - 2;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (input->d[mid] <= target)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+// Line-of-sight dlt from the hull of the flattened profile zi = hi - KM * di^2 / (2 * ae).
+// The height of point i above the line between the antennas is zi - (hts + slope * di), so
+// the nu of the points between two vertices is bounded by their edge, and only the edges
+// whose bound reaches the best vertex are scanned. The scan runs in profile order and
+// keeps the first maximum, like the full scan
+real_t _seh_los_dlt(seh_state_t *state, seh_input_t *input, seh_output_t *output)
+{
+    upper_hull_t *hull = &state->hull_z;
+    real_t dtot = input->dtot;
+    real_t slope = (output->hrs - output->hts) / dtot - KM * dtot / (2 * input->ae);
+    real_t scale = c_sqrt(0.002 * dtot / input->lambda);
+    real_t w_min = 2 * scale / dtot;
+
+    // The height falls off the vertices either side of the supporting one, past first
+    // and last it cannot bring nu up to the best vertex
+    int s = upper_hull_support(hull, slope);
+    real_t limit = scale * upper_hull_edge_clearance(hull, output->hts, slope, dtot, s, s);
+    int first = s, last = s;
+    while (first > 0 && (hull->y[first - 1] - output->hts - slope * hull->x[first - 1]) * w_min > limit - NU_BOUND_SLACK)
+    {
+        first--;
+        limit = c_max(limit, scale * upper_hull_edge_clearance(hull, output->hts, slope, dtot, first, first));
+    }
+    while (last < hull->size - 1 && (hull->y[last + 1] - output->hts - slope * hull->x[last + 1]) * w_min > limit - NU_BOUND_SLACK)
+    {
+        last++;
+        limit = c_max(limit, scale * upper_hull_edge_clearance(hull, output->hts, slope, dtot, last, last));
+    }
+
+    real_t numax = NEGATIVE_INFINITY;
+    real_t dlt = input->d[_seh_locate(input, hull->x[s])];
+    first = (first > 0) ? first - 1 : first;
+    last = (last < hull->size - 1) ? last + 1 : last;
+    for (int k = first; k < last; k++)
+    {
+        if (scale * upper_hull_edge_clearance(hull, output->hts, slope, dtot, k, k + 1) <= limit - NU_BOUND_SLACK)
+            continue;
+
+        int end = _seh_locate(input, hull->x[k + 1]);
+        for (int i = _seh_locate(input, hull->x[k]); i <= end; i++)
+        {
+            real_t nu = _seh_los_nu(input, output, i);
+            if (nu > numax)
+            {
+                numax = nu;
+                dlt = input->d[i];
+            }
+        }
+    }
+    return dlt;
+}
+
 void smooth_earth_heights(seh_input_t *input, seh_output_t *output)
 {
     output->hts = input->h[0] + input->htg;
@@ -15,26 +161,42 @@ void smooth_earth_heights(seh_input_t *input, seh_output_t *output)
     output->htc = output->hts;
     output->hrc = output->hrs;
 
-    double v1 = 0.0;
-    double v2 = 0.0;
-    bool use_v1_v2_caches = (input->v1_cache != NULL) && (input->v2_cache != NULL);
-    if (use_v1_v2_caches && !c_isnan(input->v1_cache[input->n]) && !c_isnan(input->v2_cache[input->n]))
+    seh_state_t *state = input->state;
+    if (state != NULL)
+        seh_state_advance(state, input);
+
+    real_t v1 = 0.0;
+    real_t v2 = 0.0;
+    seh_cache_t *cache = input->cache;
+    const profile_analysis_output_t *analysis = (state == NULL) ? input->analysis : NULL;
+    if (state != NULL)
+    {
+        v1 = state->v1;
+        v2 = state->v2;
+    }
+    else if (analysis != NULL)
+    {
+        v1 = analysis->v1;
+        v2 = analysis->v2;
+    }
+    else if (cache != NULL && cache->v1_v2_stamp[input->n] == cache->generation)
     {
-        v1 = input->v1_cache[input->n];
-        v2 = input->v2_cache[input->n];
+        v1 = cache->v1[input->n];
+        v2 = cache->v2[input->n];
     }
     else
     {
         for (int i = 1; i < input->n; i++)
         {
-            double diff_d = input->d[i] - input->d[i - 1];
-            double sum_h = input->h[i] + input->h[i - 1];
+            real_t diff_d = input->d[i] - input->d[i - 1];
+            real_t sum_h = input->h[i] + input->h[i - 1];
             v1 += diff_d * sum_h;
             v2 += diff_d * (input->h[i] * (2 * input->d[i] + input->d[i - 1]) + input->h[i - 1] * (input->d[i] + 2 * input->d[i - 1]));
-            if (use_v1_v2_caches)
+            if (cache != NULL)
             {
-                input->v1_cache[i + 1] = v1;
-                input->v2_cache[i + 1] = v2;
+                cache->v1[i + 1] = v1;
+                cache->v2[i + 1] = v2;
+                cache->v1_v2_stamp[i + 1] = cache->generation;
             }
         }
     }
@@ -46,21 +208,46 @@ void smooth_earth_heights(seh_input_t *input, seh_output_t *output)
     output->hsr_n = output->hsr;
 
     // Section 5.6.2 Smooth-surface heights for the diffraction model
-    double hobs = NEGATIVE_INFINITY;
-    double alpha_obt = NEGATIVE_INFINITY;
-    double alpha_obr = NEGATIVE_INFINITY;
-    for (int i = 1; i < input->n - 1; i++)
+    real_t hobs = NEGATIVE_INFINITY;
+    real_t alpha_obt = NEGATIVE_INFINITY;
+    real_t alpha_obr = NEGATIVE_INFINITY;
+    if (state != NULL && state->hull_h.size > 0)
+    {
+        // HHi = hi - htc - s * di, with s the slope of the line between the antennas, so
+        // hobs is the hull vertex furthest above that line, HHi / di = (hi - htc) / di - s
+        // and HHi / (dtot - di) = (hi - hrc) / (dtot - di) + s
+        upper_hull_t *hull = &state->hull_h;
+        real_t s = (output->hrc - output->htc) / input->dtot;
+
+        int k = upper_hull_support(hull, s);
+        hobs = hull->y[k] - output->htc - s * hull->x[k];
+
+        alpha_obt = state->alpha_t - s;
+
+        k = upper_hull_tangent_right(hull, input->dtot, output->hrc);
+        alpha_obr = (hull->y[k] - output->hrc) / (input->dtot - hull->x[k]) + s;
+    }
+    else if (analysis != NULL)
+    {
+        hobs = analysis->hobs;
+        alpha_obt = analysis->alpha_obt;
+        alpha_obr = analysis->alpha_obr;
+    }
+    else
     {
-        double dtot_min_d = input->dtot - input->d[i];
-        double HHi = input->h[i] - (output->htc * dtot_min_d + output->hrc * input->d[i]) / input->dtot;
-        hobs = c_max(hobs, HHi);
-        alpha_obt = c_max(alpha_obt, HHi / input->d[i]);
-        alpha_obr = c_max(alpha_obr, HHi / dtot_min_d);
+        for (int i = 1; i < input->n - 1; i++)
+        {
+            real_t dtot_min_d = input->dtot - input->d[i];
+            real_t HHi = input->h[i] - (output->htc * dtot_min_d + output->hrc * input->d[i]) / input->dtot;
+            hobs = c_max(hobs, HHi);
+            alpha_obt = c_max(alpha_obt, HHi / input->d[i]);
+            alpha_obr = c_max(alpha_obr, HHi / dtot_min_d);
+        }
     }
 
     // Calculate provisional values for the Tx and Rx smooth surface heights
-    double gt = alpha_obt / (alpha_obt + alpha_obr);
-    double gr = alpha_obr / (alpha_obt + alpha_obr);
+    real_t gt = alpha_obt / (alpha_obt + alpha_obr);
+    real_t gr = alpha_obr / (alpha_obt + alpha_obr);
 
     if (hobs <= 0)
     {
@@ -85,12 +272,19 @@ void smooth_earth_heights(seh_input_t *input, seh_output_t *output)
         output->hsrd = output->hsrp;
 
     // Interfering antenna horizon elevation angle and distance
-    double theta;
-    double theta_max = NEGATIVE_INFINITY;
-    bool use_theta_max_cache = (input->theta_max_cache != NULL);
-    if (use_theta_max_cache && !c_isnan(input->theta_max_cache[input->n]))
+    real_t theta;
+    real_t theta_max = NEGATIVE_INFINITY;
+    if (state != NULL)
+    {
+        theta_max = state->theta_max;
+    }
+    else if (analysis != NULL)
+    {
+        theta_max = analysis->theta_max;
+    }
+    else if (cache != NULL && cache->theta_max_stamp[input->n] == cache->generation)
     {
-        theta_max = input->theta_max_cache[input->n];
+        theta_max = cache->theta_max[input->n];
     }
     else
     {
@@ -98,34 +292,55 @@ void smooth_earth_heights(seh_input_t *input, seh_output_t *output)
         {
             theta = KM * c_atan((input->h[i] - output->hts) / (KM * input->d[i]) - input->d[i] / (2 * input->ae));
             theta_max = c_max(theta_max, theta);
-            if (use_theta_max_cache)
+            if (cache != NULL)
             {
-                input->theta_max_cache[i + 1] = theta_max;
+                cache->theta_max[i + 2] = theta_max;
+                cache->theta_max_stamp[i + 2] = cache->generation;
             }
         }
     }
 
-    double theta_td = KM * c_atan((output->hrs - output->hts) / (KM * input->dtot) - input->dtot / (2 * input->ae));
-    double theta_rd = KM * c_atan((output->hts - output->hrs) / (KM * input->dtot) - input->dtot / (2 * input->ae));
-    double theta_t = c_max(theta_max, theta_td);
+    real_t theta_td = KM * c_atan((output->hrs - output->hts) / (KM * input->dtot) - input->dtot / (2 * input->ae));
+    real_t theta_rd = KM * c_atan((output->hts - output->hrs) / (KM * input->dtot) - input->dtot / (2 * input->ae));
+    real_t theta_t = c_max(theta_max, theta_td);
 
-    double theta_r;
+    real_t theta_r;
     if (theta_max > theta_td) // Transhorizon path
     {
         theta_r = NEGATIVE_INFINITY;
 
-        double numax = NEGATIVE_INFINITY;
-        for (int i = 1; i < input->n - 1; i++)
+        // For a path starting at d = 0 the first nu below divides by d[0] = 0, so a
+        // positive height term makes it +inf and the search cannot move dlt away from d[2]
+        bool scan = true;
+        if (state != NULL && state->hull_z.size > 0 && input->d[0] == 0 && _seh_transhorizon_height(input, output, 1) > 0)
+        {
+            output->dlt = input->d[2];
+
+            // theta_r in the Earth-curvature-flattened frame zi = hi - KM * di^2 / (2 * ae):
+            // (hi - hrs) / (dtot - di) - KM * (dtot - di) / (2 * ae) = (zi - zr) / (dtot - di) - KM * dtot / ae
+            upper_hull_t *hull = &state->hull_z;
+            real_t zr = output->hrs - KM * input->dtot * input->dtot / (2 * input->ae);
+            int k = upper_hull_tangent_right(hull, input->dtot, zr);
+            real_t slope = (hull->y[k] - zr) / (input->dtot - hull->x[k]) - KM * input->dtot / input->ae;
+            theta_r = KM * c_atan(slope / KM);
+            scan = false;
+        }
+        else if (analysis != NULL)
+        {
+            output->dlt = analysis->dlt_trans;
+            theta_r = analysis->theta_r;
+            scan = false;
+        }
+
+        real_t numax = NEGATIVE_INFINITY;
+        for (int i = 1; scan && i < input->n - 1; i++)
         {
-            double d = input->d[i];
-            double dtot_min_d = input->dtot - d;
+            real_t d = input->d[i];
+            real_t dtot_min_d = input->dtot - d;
             theta = KM * c_atan((input->h[i] - output->hrs) / (KM * dtot_min_d) - dtot_min_d / (2 * input->ae));
             theta_r = c_max(theta_r, theta);
 
-            double d_min_1 = input->d[i - 1];
-            double dtot_min_d_min_1 = input->dtot - d_min_1;
-            double nu = input->h[i] + 500 * input->ae * (d * dtot_min_d - d_min_1 * dtot_min_d_min_1) - (output->hts * dtot_min_d_min_1 + output->hrs * d_min_1) / input->dtot;
-            nu *= c_sqrt(0.002 * input->dtot / (input->lambda * d_min_1 * dtot_min_d_min_1));
+            real_t nu = _seh_transhorizon_nu(input, output, i);
             if (nu > numax)
             {
                 numax = nu;
@@ -137,19 +352,26 @@ void smooth_earth_heights(seh_input_t *input, seh_output_t *output)
     { // Line-of-sight path
         theta_r = theta_rd;
 
-        double numax = NEGATIVE_INFINITY;
-        for (int i = 1; i < input->n - 1; i++)
+        bool scan = true;
+        if (state != NULL && state->hull_z.size > 0)
+        {
+            output->dlt = _seh_los_dlt(state, input, output);
+            scan = false;
+        }
+        else if (analysis != NULL)
         {
-            double Ce = 1.0 / input->ae;
+            output->dlt = analysis->dlt_los;
+            scan = false;
+        }
 
-            double d = input->d[i];
-            double dtot_min_d = input->dtot - d;
-            double nu = input->h[i] + 500 * Ce * input->d[i] * dtot_min_d - (output->hts * dtot_min_d + output->hrs * d) / input->dtot;
-            nu *= c_sqrt(0.002 * input->dtot / (input->lambda * d * dtot_min_d));
+        real_t numax = NEGATIVE_INFINITY;
+        for (int i = 1; scan && i < input->n - 1; i++)
+        {
+            real_t nu = _seh_los_nu(input, output, i);
             if (nu > numax)
             {
                 numax = nu;
-                output->dlt = d;
+                output->dlt = input->d[i];
             }
         }
     }
@@ -157,7 +379,7 @@ void smooth_earth_heights(seh_input_t *input, seh_output_t *output)
     output->dlr = input->dtot - output->dlt;
 
     // Angular distance
-    double theta_tot = KM * input->dtot / input->ae + theta_t + theta_r;
+    real_t theta_tot = KM * input->dtot / input->ae + theta_t + theta_r;
     output->theta = theta_tot;
     output->theta_t = theta_t;
     output->theta_r = theta_r;
@@ -1,12 +1,24 @@
 #include "tl_tropo.h"
 #include "custom_math.h"
+#include <stdlib.h>
+
+void tl_tropo_prepare(real_t f, real_t p, tl_tropo_prepared_t *prepared)
+{
+	prepared->Lf = 25 * c_log10(f) - 2.5 * c_pow(c_log10(f / 2.0), 2); // eq (45)
+	prepared->Lp = 10.125 * c_pow(c_log10(50.0 / p), 0.7);
+}
 
 void tl_tropo(tl_tropo_input_t *input, tl_tropo_output_t *output)
 {
-	// Frequency dependent loss
-	double Lf = 25 * c_log10(input->f) - 2.5 * c_pow(c_log10(input->f / 2.0), 2); // eq (45)
+	tl_tropo_prepared_t local;
+	const tl_tropo_prepared_t *prepared = input->prepared;
+	if (prepared == NULL)
+	{
+		tl_tropo_prepare(input->f, input->p, &local);
+		prepared = &local;
+	}
 
 	// the basic transmission loss due to troposcatter not exceeded for any time
 	// percentage p, below 50# is given
-	output->Lbs = 190.1 + Lf + 20 * c_log10(input->dtot) + 0.573 * input->theta - 0.15 * input->N0 - 10.125 * c_pow(c_log10(50.0 / input->p), 0.7);
+	output->Lbs = 190.1 + prepared->Lf + 20 * c_log10(input->dtot) + 0.573 * input->theta - 0.15 * input->N0 - prepared->Lp;
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "upper_hull.h"
+#include "custom_math.h"
+
+// Cross product of (a - o) and (b - o), negative when o, a, b turn clockwise
+#define CROSS(ox, oy, ax, ay, bx, by) (((ax) - (ox)) * ((by) - (oy)) - ((ay) - (oy)) * ((bx) - (ox)))
+
+#define EDGE_CROSS(hull, j, qx, qy) CROSS(hull->x[j], hull->y[j], hull->x[j + 1], hull->y[j + 1], qx, qy)
+
+void upper_hull_init(upper_hull_t *hull, real_t *x, real_t *y)
+{
+    hull->size = 0;
+    hull->x = x;
+    hull->y = y;
+}
+
+void upper_hull_push(upper_hull_t *hull, real_t x, real_t y)
+{
+    // Drop vertices that are no longer strictly above the chain
+    while (hull->size >= 2 && EDGE_CROSS(hull, hull->size - 2, x, y) >= 0)
+        hull->size--;
+
+    hull->x[hull->size] = x;
+    hull->y[hull->size] = y;
+    hull->size++;
+}
+
+int upper_hull_tangent_left(upper_hull_t *hull, real_t qx, real_t qy)
+{
+    // Edge j leads to a steeper line from q while q lies above the edge's supporting line
+    int lo = 0, hi = hull->size - 1;
+    while (lo < hi)
+    {
+        int j = (lo + hi) / 2;
+        if (EDGE_CROSS(hull, j, qx, qy) > 0)
+            lo = j + 1;
+        else
+            hi = j;
+    }
+    return hi;
+}
+
+int upper_hull_tangent_right(upper_hull_t *hull, real_t qx, real_t qy)
+{
+    // Edge j leads to a steeper line from q while q lies below the edge's supporting line
+    int lo = 0, hi = hull->size - 1;
+    while (lo < hi)
+    {
+        int j = (lo + hi) / 2;
+        if (EDGE_CROSS(hull, j, qx, qy) < 0)
+            lo = j + 1;
+        else
+            hi = j;
+    }
+    return hi;
+}
+
+int upper_hull_support(upper_hull_t *hull, real_t slope)
+{
+    // Edge slopes decrease along the chain, walk up while the edge is steeper than the line
+    int lo = 0, hi = hull->size - 1;
+    while (lo < hi)
+    {
+        int j = (lo + hi) / 2;
+        if (hull->y[j + 1] - hull->y[j] > slope * (hull->x[j + 1] - hull->x[j]))
+            lo = j + 1;
+        else
+            hi = j;
+    }
+    return hi;
+}
+
+real_t upper_hull_edge_clearance(upper_hull_t *hull, real_t qy, real_t slope, real_t span, int a, int b)
+{
+    real_t xa = hull->x[a], xb = hull->x[b];
+    real_t ya = hull->y[a] - qy - slope * xa;
+    real_t yb = hull->y[b] - qy - slope * xb;
+    real_t value = c_max(ya / c_sqrt(xa * (span - xa)), yb / c_sqrt(xb * (span - xb)));
+    if (a == b)
+        return value;
+    if (ya >= 0 || yb >= 0)
+        return INFINITY;
+
+    // With the depth below the line alpha + beta * x along the edge, the derivative of
+    // (alpha + beta * x) / sqrt(x * (span - x)) vanishes only at x = alpha * span / (beta * span + 2 * alpha)
+    real_t beta = (ya - yb) / (xb - xa);
+    real_t alpha = -ya - beta * xa;
+    real_t denominator = beta * span + 2 * alpha;
+    if (denominator > 0)
+    {
+        real_t x = alpha * span / denominator;
+        if (x > xa && x < xb)
+            value = c_max(value, -(alpha + beta * x) / c_sqrt(x * (span - x)));
+    }
+    return value;
+}
@@ -0,0 +1,97 @@
+#include "calculate.h"
+#include "custom_math.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N 40
+
+static void _set_profile(c1812_parameters_t *parameters, real_t *d, real_t *h, real_t d0)
+{
+    memset(parameters, 0, sizeof(*parameters));
+    parameters->f = 0.145;
+    parameters->p = 50;
+    parameters->htg = 30;
+    parameters->hrg = 2;
+    parameters->pol = POLARIZATION_VERTICAL;
+    parameters->zone = RC_ZONE_INLAND;
+    parameters->ws = 27;
+    parameters->lon = 21;
+    parameters->lat = 52;
+    parameters->N0 = 300;
+    parameters->DN = 45;
+
+    for (int i = 0; i < N; i++)
+    {
+        d[i] = d0 + 0.1 * i;
+        h[i] = 100 + 40 * c_sin(i / 6.0);
+    }
+    parameters->n = N;
+    parameters->d = d;
+    parameters->h = h;
+}
+
+// Every entry point agrees on a profile starting at the transmitter and rejects one that does not
+int main(void)
+{
+    real_t d[N], h[N], Lb[N];
+    c1812_parameters_t parameters;
+    c1812_results_t results;
+    int failures = 0;
+
+    c1812_workspace_t *workspace = c1812_workspace_create(N);
+    if (workspace == NULL)
+    {
+        fprintf(stderr, "main: c1812_workspace_create()\n");
+        return EXIT_FAILURE;
+    }
+
+    _set_profile(&parameters, d, h, 0.0);
+    c1812_calculate_ray(&parameters, NULL, workspace, Lb, &results);
+    if (results.error != RESULTS_ERR_NONE)
+    {
+        fprintf(stderr, "c1812_calculate_ray: error %d for d[0] = 0\n", results.error);
+        failures++;
+    }
+    for (int n = 3; n <= N; n++)
+    {
+        parameters.n = n;
+        c1812_calculate(&parameters, &results);
+        real_t expected = results.Lb;
+        c1812_calculate_ws(&parameters, NULL, workspace, &results);
+        if (results.error != RESULTS_ERR_NONE || c_abs(results.Lb - expected) > 1e-3 || c_abs(Lb[n - 1] - expected) > 1e-3)
+        {
+            fprintf(stderr, "n = %d: c1812_calculate %g, c1812_calculate_ws %g, c1812_calculate_ray %g\n", n, (double)expected, (double)results.Lb, (double)Lb[n - 1]);
+            failures++;
+        }
+    }
+
+    _set_profile(&parameters, d, h, 0.5);
+    c1812_workspace_invalidate(workspace);
+    if (c1812_validate_parameters(&parameters) != PARAM_ERR_INVALID_DISTANCE_FROM_TRANSMITTER)
+    {
+        fprintf(stderr, "c1812_validate_parameters: accepted d[0] = 0.5\n");
+        failures++;
+    }
+    c1812_calculate(&parameters, &results);
+    if (results.error == RESULTS_ERR_NONE || results.parameters_error != PARAM_ERR_INVALID_DISTANCE_FROM_TRANSMITTER)
+    {
+        fprintf(stderr, "c1812_calculate: accepted d[0] = 0.5\n");
+        failures++;
+    }
+    c1812_calculate_ws(&parameters, NULL, workspace, &results);
+    if (results.error == RESULTS_ERR_NONE || results.parameters_error != PARAM_ERR_INVALID_DISTANCE_FROM_TRANSMITTER)
+    {
+        fprintf(stderr, "c1812_calculate_ws: accepted d[0] = 0.5\n");
+        failures++;
+    }
+    c1812_calculate_ray(&parameters, NULL, workspace, Lb, &results);
+    if (results.error == RESULTS_ERR_NONE || !c_isnan(Lb[N - 1]))
+    {
+        fprintf(stderr, "c1812_calculate_ray: accepted d[0] = 0.5\n");
+        failures++;
+    }
+
+    c1812_workspace_free(workspace);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,28 @@
+#include "custom_math.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Largest accepted difference to libm, the polynomial in c_atan is fitted to about 1e-5
+#define ATAN_TOLERANCE 1e-4
+
+// c_atan against libm on both sides of |x| = 1, where the polynomial alone diverges
+// (c_atan(-10) ~ 1e9 without the range reduction)
+int main(void)
+{
+    const real_t points[] = {-1e6, -40, -10, -1.5, -1, -0.5, 0, 0.5, 1, 1.5, 10, 40, 1e6};
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+    {
+        real_t x = points[i];
+        real_t expected = c_atan2_exact(x, 1.0);
+        real_t actual = c_atan(x);
+        if (!(c_abs(actual - expected) <= ATAN_TOLERANCE))
+        {
+            fprintf(stderr, "c_atan(%g) = %g, expected %g\n", (double)x, (double)actual, (double)expected);
+            failures++;
+        }
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
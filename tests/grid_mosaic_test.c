@@ -0,0 +1,138 @@
+#include "terrain_file.h"
+#include "grid_mosaic.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Ticks of the whole test grid along each axis, and between them [m]
+#define SIZE 24
+#define SPACING 30.0
+
+// Points sampled along each line
+#define POINTS 301
+
+// Height of tick xi, yi, smooth enough for the bicubic interpolation to matter
+static double _height(int xi, int yi)
+{
+    return 100.0 + 40.0 * sin(xi / 3.0) * cos(yi / 4.0) + 2.0 * xi;
+}
+
+// Writes ticks x_first .. x_last, y_first .. y_last as a text grid and stores it as a .tf
+static int _store(const char *directory, const char *name, int x_first, int x_last, int y_first, int y_last, char *path)
+{
+    char text[4096];
+    snprintf(text, sizeof(text), "%s/%s.txt", directory, name);
+    FILE *fp = fopen(text, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "_store: fopen(%s)\n", text);
+        return EXIT_FAILURE;
+    }
+    for (int yi = y_first; yi <= y_last; yi++)
+        for (int xi = x_first; xi <= x_last; xi++)
+            fprintf(fp, "%.1f %.1f %.17g\n", xi * SPACING, yi * SPACING, _height(xi, yi));
+    fclose(fp);
+
+    terrain_file_t tf;
+    snprintf(path, 4096, "%s/%s.tf", directory, name);
+    int status = tf_parse(&tf, text);
+    if (status == EXIT_SUCCESS)
+        status = tf_store(&tf, path, GRID_SAMPLE_F64);
+    tf_free(&tf);
+    unlink(text);
+    return status;
+}
+
+// Samples lines across the seams of a 2 x 2 mosaic and compares them with the whole grid.
+// overlap is the number of ticks the tiles share, 0 for abutting tiles
+static int _check(const char *directory, const char *label, terrain_file_t *whole, int overlap)
+{
+    int half = SIZE / 2;
+    char paths[4][4096];
+    char *tiles[4];
+    for (int t = 0; t < 4; t++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%s%d", label, t);
+        int x_first = (t % 2 == 0) ? 0 : half;
+        int x_last = (t % 2 == 0) ? half - 1 + overlap : SIZE - 1;
+        int y_first = (t / 2 == 0) ? 0 : half;
+        int y_last = (t / 2 == 0) ? half - 1 + overlap : SIZE - 1;
+        if (_store(directory, name, x_first, x_last, y_first, y_last, paths[t]) != EXIT_SUCCESS)
+            return 1;
+        tiles[t] = paths[t];
+    }
+
+    terrain_file_t mosaic;
+    if (tf_open_mosaic(&mosaic, tiles, 4, 4) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "%s: tf_open_mosaic()\n", label);
+        return 1;
+    }
+
+    // Lines clear of the edges of the whole grid, across both seams and along them
+    const double lines[][4] = {
+        {2.5, 3.2, 20.5, 19.7},
+        {2.5, 11.5, 20.5, 11.5},
+        {11.5, 2.5, 11.5, 20.5},
+        {11.9, 2.6, 12.1, 20.4},
+        {2.6, 20.4, 20.4, 2.6},
+    };
+
+    int failures = 0;
+    for (size_t l = 0; l < sizeof(lines) / sizeof(lines[0]); l++)
+    {
+        double x1 = lines[l][0] * SPACING, y1 = lines[l][1] * SPACING;
+        double x2 = lines[l][2] * SPACING, y2 = lines[l][3] * SPACING;
+        double expected[POINTS], actual[POINTS];
+        tf_sample_line(whole, x1, y1, x2, y2, POINTS, expected);
+        tf_sample_line(&mosaic, x1, y1, x2, y2, POINTS, actual);
+        for (int i = 0; i < POINTS; i++)
+        {
+            if (isnan(expected[i]) || !(fabs(actual[i] - expected[i]) <= 1e-9))
+            {
+                fprintf(stderr, "%s: line %zu point %d: %g, expected %g\n", label, l, i, actual[i], expected[i]);
+                failures++;
+                break;
+            }
+        }
+    }
+
+    tf_free(&mosaic);
+    for (int t = 0; t < 4; t++)
+        unlink(paths[t]);
+    return failures;
+}
+
+// Tiles that abut or share an edge sample like the grid they were cut from
+int main(void)
+{
+    char directory[] = "/tmp/grid_mosaic_test.XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "main: mkdtemp()\n");
+        return EXIT_FAILURE;
+    }
+
+    char path[4096];
+    terrain_file_t whole;
+    int failures = 0;
+    if (_store(directory, "whole", 0, SIZE - 1, 0, SIZE - 1, path) != EXIT_SUCCESS || tf_open(&whole, path, NULL) != EXIT_SUCCESS)
+    {
+        fprintf(stderr, "main: whole grid\n");
+        failures++;
+    }
+    else
+    {
+        failures += _check(directory, "abutting", &whole, 0);
+        failures += _check(directory, "shared", &whole, 1);
+        failures += _check(directory, "overlapping", &whole, 4);
+        tf_free(&whole);
+    }
+
+    unlink(path);
+    rmdir(directory);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}